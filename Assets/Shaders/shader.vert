@@ -10,11 +10,12 @@ ubo;
 
 layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec4 inColor;
+layout(location = 2) in mat4 inModel;
 
 layout(location = 0) out vec4 fragColor;
 
 void main()
 {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
+    gl_Position = ubo.proj * ubo.view * inModel * vec4(inPosition, 0.0, 1.0);
     fragColor = inColor;
 }
@@ -0,0 +1,95 @@
+#include "stdafx.hpp"
+#include "BenchHarness.hpp"
+
+#include <iomanip>
+
+zh::bench::BenchHarness::BenchHarness() : BenchHarness(Settings{})
+{
+}
+
+zh::bench::BenchHarness::BenchHarness(const Settings &settings) : settings(settings)
+{
+}
+
+void zh::bench::BenchHarness::run(const std::string &name, const uint32_t operations, const Function &function,
+                                  const Function &reset, const uint64_t bytes)
+{
+    assert(operations > 0 && "zh::bench::BenchHarness::run: A REPETITION MUST PERFORM AT LEAST ONE OPERATION");
+
+    if (!settings.filter.empty() && name.find(settings.filter) == std::string::npos)
+        return;
+
+    for (uint32_t i = 0; i < settings.warmupRepetitions; ++i)
+    {
+        function();
+        if (reset)
+            reset();
+    }
+
+    std::vector<double> samples;
+    double total_time = 0.0;
+
+    while (samples.size() < settings.maxRepetitions &&
+           (samples.size() < settings.minRepetitions || total_time < settings.minTime))
+    {
+        const auto start = Clock::now();
+        function();
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (reset)
+            reset();
+
+        samples.push_back(elapsed * 1e9 / operations);
+        total_time += elapsed;
+    }
+
+    results.push_back(Result{name, operations, bytes, Statistics::summarize(std::move(samples))});
+    printResult(results.back());
+}
+
+const std::vector<zh::bench::BenchHarness::Result> &zh::bench::BenchHarness::getResults() const
+{
+    return results;
+}
+
+const double zh::bench::BenchHarness::getBandwidth(const Result &result)
+{
+    if (result.bytes == 0 || result.time.p50 <= 0.0)
+        return 0.0;
+
+    return result.bytes / (result.time.p50 * 1e-9) / (1024.0 * 1024.0 * 1024.0);
+}
+
+void zh::bench::BenchHarness::printResult(const Result &result, std::ostream &stream) const
+{
+    stream << std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(1)
+           << " p50 " << std::setw(12) << result.time.p50 << " ns  p99 " << std::setw(12) << result.time.p99
+           << " ns  (" << result.time.count << " x " << result.operations << ")";
+
+    if (result.bytes != 0)
+        stream << std::setprecision(3) << "  " << getBandwidth(result) << " GiB/s";
+
+    stream << std::endl;
+}
+
+void zh::bench::BenchHarness::writeJson(const std::string &path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("zh::bench::BenchHarness::writeJson: COULD NOT OPEN " + path);
+
+    file << std::setprecision(3) << std::fixed;
+    file << "{\n  \"benchmarks\": [\n";
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &result = results[i];
+
+        file << "    {\"name\": \"" << result.name << "\", \"operations\": " << result.operations
+             << ", \"bytes\": " << result.bytes << ", \"bandwidth\": " << getBandwidth(result) << ", \"time\": ";
+        Statistics::writeJson(file, result.time);
+        file << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    file << "  ]\n}\n";
+}
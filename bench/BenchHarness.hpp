@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Statistics.hpp"
+
+namespace zh::bench
+{
+// Repetition harness for microbenchmarks. A benchmark function performs a fixed number of operations per call; it is
+// called for warmup repetitions first, then until both the minimum repetition count and the minimum time are reached,
+// and the time per operation of every repetition is summarized.
+class BenchHarness
+{
+  public:
+    struct Settings
+    {
+        uint32_t warmupRepetitions = 3;
+        uint32_t minRepetitions = 10;
+        uint32_t maxRepetitions = 10000;
+
+        // Seconds spent in timed repetitions before a benchmark may stop.
+        double minTime = 0.5;
+
+        // Only benchmarks whose name contains the filter run. Empty runs all of them.
+        std::string filter;
+    };
+
+    struct Result
+    {
+        std::string name;
+        uint32_t operations;
+
+        // Bytes processed by one operation, zero when the benchmark does not measure bandwidth.
+        uint64_t bytes;
+
+        // Nanoseconds per operation.
+        Statistics::Summary time;
+    };
+
+    using Function = std::function<void()>;
+
+    BenchHarness();
+
+    BenchHarness(const Settings &settings);
+
+    BenchHarness(const BenchHarness &) = delete;
+    BenchHarness &operator=(const BenchHarness &) = delete;
+
+    // Times function, which performs operations operations per call. reset, when given, runs untimed after every
+    // call to restore the state the next call expects, e.g. to reset a pool that function allocates from.
+    void run(const std::string &name, const uint32_t operations, const Function &function,
+             const Function &reset = nullptr, const uint64_t bytes = 0);
+
+    const std::vector<Result> &getResults() const;
+
+    // Median bandwidth in GiB/s, or zero when the result has no byte count.
+    static const double getBandwidth(const Result &result);
+
+    void printResult(const Result &result, std::ostream &stream = std::cout) const;
+
+    void writeJson(const std::string &path) const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    Settings settings;
+    std::vector<Result> results;
+};
+} // namespace zh::bench
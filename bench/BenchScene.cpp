@@ -0,0 +1,131 @@
+#include "stdafx.hpp"
+#include "BenchScene.hpp"
+
+#include <random>
+
+zh::bench::BenchScene::BenchScene(Device &device, const Settings &settings)
+    : device(device), settings(settings), triangleCount(0)
+{
+    if (settings.modelCount == 0)
+        throw std::runtime_error("zh::bench::BenchScene::BenchScene: A SCENE NEEDS AT LEAST ONE MODEL");
+
+    const float fraction = std::clamp(settings.dynamicFraction, 0.f, 1.f);
+    dynamicCount = static_cast<uint32_t>(std::round(fraction * settings.objectCount));
+
+    createModels();
+    createObjects();
+}
+
+void zh::bench::BenchScene::update(const float time)
+{
+    for (uint32_t i = 0; i < dynamicCount; ++i)
+    {
+        const float angle = time * speeds[i];
+        const glm::vec3 offset{std::cos(angle) * 0.05f, std::sin(angle) * 0.05f, 0.f};
+
+        objects[i]->setTranslation(origins[i] + offset);
+        objects[i]->setRotation(glm::vec3{0.f, 0.f, angle});
+    }
+}
+
+const zh::bench::BenchScene::Settings &zh::bench::BenchScene::getSettings() const
+{
+    return settings;
+}
+
+const std::vector<zh::Object *> &zh::bench::BenchScene::getObjects() const
+{
+    return objectPointers;
+}
+
+const uint64_t zh::bench::BenchScene::getTriangleCount() const
+{
+    return triangleCount;
+}
+
+void zh::bench::BenchScene::createModels()
+{
+    if (settings.useArena)
+    {
+        uint32_t vertex_count = 0, index_count = 0;
+        for (uint32_t i = 0; i < settings.modelCount; ++i)
+        {
+            vertex_count += getSideCount(i) + 1;
+            index_count += getSideCount(i) * 3;
+        }
+
+        arena = std::make_unique<GeometryArena>(device, vertex_count, index_count);
+    }
+
+    models.reserve(settings.modelCount);
+
+    // Regular polygons drawn as triangle fans around their center, each with its own colors.
+    for (uint32_t i = 0; i < settings.modelCount; ++i)
+    {
+        const uint32_t sides = getSideCount(i);
+        const float hue = 6.2831853f * i / settings.modelCount;
+        const glm::vec4 color{0.5f + 0.5f * std::cos(hue), 0.5f + 0.5f * std::cos(hue + 2.0943951f),
+                              0.5f + 0.5f * std::cos(hue + 4.1887902f), 1.f};
+
+        std::vector<Vertex> vertices;
+        std::vector<Index> indices;
+        vertices.reserve(sides + 1);
+        indices.reserve(sides * 3);
+
+        vertices.push_back(Vertex{{0.f, 0.f}, {1.f, 1.f, 1.f, 1.f}});
+        for (uint32_t side = 0; side < sides; ++side)
+        {
+            const float angle = 6.2831853f * side / sides;
+            vertices.push_back(Vertex{{std::cos(angle), std::sin(angle)}, color});
+
+            indices.push_back(0);
+            indices.push_back(side + 1);
+            indices.push_back((side + 1) % sides + 1);
+        }
+
+        if (arena != nullptr)
+            models.push_back(std::make_shared<Model>(device, *arena, vertices, indices));
+        else
+            models.push_back(std::make_shared<Model>(device, vertices, indices));
+    }
+}
+
+void zh::bench::BenchScene::createObjects()
+{
+    std::mt19937 random(settings.seed);
+    std::uniform_real_distribution<float> position(-1.f, 1.f);
+    std::uniform_real_distribution<float> speed(0.5f, 4.f);
+    std::uniform_int_distribution<uint32_t> model(0, settings.modelCount - 1);
+
+    // Objects shrink as the scene grows so that the covered area, and with it the fragment load, stays similar.
+    const float scale = std::clamp(0.5f / std::sqrt(static_cast<float>(std::max(settings.objectCount, 1u))), 0.002f,
+                                   0.1f);
+
+    objects.reserve(settings.objectCount);
+    objectPointers.reserve(settings.objectCount);
+    origins.reserve(settings.objectCount);
+    speeds.reserve(settings.objectCount);
+
+    for (uint32_t i = 0; i < settings.objectCount; ++i)
+    {
+        const uint32_t model_index = model(random);
+        const glm::vec3 origin{position(random), position(random), 0.f};
+
+        auto object = std::make_unique<Object>(device);
+        object->setModel(models[model_index]);
+        object->setTranslation(origin);
+        object->setScale(glm::vec3{scale, scale, 1.f});
+
+        triangleCount += getSideCount(model_index);
+
+        origins.push_back(origin);
+        speeds.push_back(speed(random));
+        objectPointers.push_back(object.get());
+        objects.push_back(std::move(object));
+    }
+}
+
+const uint32_t zh::bench::BenchScene::getSideCount(const uint32_t model_index)
+{
+    return MIN_SIDES + model_index % (MAX_SIDES - MIN_SIDES + 1);
+}
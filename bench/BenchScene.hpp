@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Graphics/Models/GeometryArena.hpp"
+#include "System/Scene/Object.hpp"
+
+namespace zh::bench
+{
+// Procedurally generated scene of flat polygons spread over the view. Objects share a fixed set of unique models,
+// and a fraction of them moves every frame while the rest stays put.
+class BenchScene
+{
+  public:
+    struct Settings
+    {
+        std::string name;
+        uint32_t objectCount = 1000;
+        uint32_t modelCount = 16;
+
+        // Fraction of the objects, in [0, 1], whose transform changes every frame.
+        float dynamicFraction = 0.f;
+
+        // Puts every model in one geometry arena so batches can be merged into indirect draws.
+        bool useArena = true;
+
+        uint32_t seed = 1;
+    };
+
+    BenchScene(Device &device, const Settings &settings);
+
+    BenchScene() = delete;
+    BenchScene(const BenchScene &) = delete;
+    BenchScene &operator=(const BenchScene &) = delete;
+
+    // Moves the dynamic objects to where they are at time, in seconds.
+    void update(const float time);
+
+    const Settings &getSettings() const;
+
+    const std::vector<Object *> &getObjects() const;
+
+    // Triangles drawn when every object is rendered once.
+    const uint64_t getTriangleCount() const;
+
+  private:
+    static constexpr uint32_t MIN_SIDES = 3;
+    static constexpr uint32_t MAX_SIDES = 24;
+
+    Device &device;
+    Settings settings;
+
+    std::unique_ptr<GeometryArena> arena;
+    std::vector<std::shared_ptr<Model>> models;
+    std::vector<std::unique_ptr<Object>> objects;
+    std::vector<Object *> objectPointers;
+
+    // Resting position and angular speed of each object.
+    std::vector<glm::vec3> origins;
+    std::vector<float> speeds;
+    uint32_t dynamicCount;
+
+    uint64_t triangleCount;
+
+    void createModels();
+
+    void createObjects();
+
+    static const uint32_t getSideCount(const uint32_t model_index);
+};
+} // namespace zh::bench
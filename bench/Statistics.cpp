@@ -0,0 +1,52 @@
+#include "stdafx.hpp"
+#include "Statistics.hpp"
+
+const zh::bench::Statistics::Summary zh::bench::Statistics::summarize(std::vector<double> samples)
+{
+    Summary summary;
+
+    if (samples.empty())
+        return summary;
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for (auto &sample : samples)
+        sum += sample;
+
+    summary.count = samples.size();
+    summary.mean = sum / samples.size();
+
+    double squared_deviations = 0.0;
+    for (auto &sample : samples)
+        squared_deviations += (sample - summary.mean) * (sample - summary.mean);
+
+    summary.stddev = samples.size() > 1 ? std::sqrt(squared_deviations / (samples.size() - 1)) : 0.0;
+    summary.min = samples.front();
+    summary.max = samples.back();
+    summary.p50 = percentile(samples, 50.0);
+    summary.p90 = percentile(samples, 90.0);
+    summary.p95 = percentile(samples, 95.0);
+    summary.p99 = percentile(samples, 99.0);
+
+    return summary;
+}
+
+const double zh::bench::Statistics::percentile(const std::vector<double> &sorted_samples, const double percent)
+{
+    if (sorted_samples.empty())
+        return 0.0;
+
+    const double rank = std::clamp(percent, 0.0, 100.0) / 100.0 * (sorted_samples.size() - 1);
+    const size_t lower = static_cast<size_t>(rank);
+    const size_t upper = std::min(lower + 1, sorted_samples.size() - 1);
+
+    return sorted_samples[lower] + (sorted_samples[upper] - sorted_samples[lower]) * (rank - lower);
+}
+
+void zh::bench::Statistics::writeJson(std::ostream &stream, const Summary &summary)
+{
+    stream << "{\"count\": " << summary.count << ", \"mean\": " << summary.mean << ", \"stddev\": " << summary.stddev
+           << ", \"min\": " << summary.min << ", \"max\": " << summary.max << ", \"p50\": " << summary.p50
+           << ", \"p90\": " << summary.p90 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99 << "}";
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "stdafx.hpp"
+
+namespace zh::bench
+{
+// Order statistics of a series of samples, for reporting timings that are rarely normally distributed.
+class Statistics
+{
+  public:
+    struct Summary
+    {
+        size_t count = 0;
+        double mean = 0.0;
+        double stddev = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+    };
+
+    static const Summary summarize(std::vector<double> samples);
+
+    // Linearly interpolated percentile in [0, 100] of samples sorted in ascending order.
+    static const double percentile(const std::vector<double> &sorted_samples, const double percent);
+
+    // Writes the summary as a JSON object, without a trailing newline.
+    static void writeJson(std::ostream &stream, const Summary &summary);
+};
+} // namespace zh::bench
@@ -0,0 +1,520 @@
+#include "stdafx.hpp"
+#include "BenchScene.hpp"
+#include "Statistics.hpp"
+#include "Graphics/Rendering/Renderer.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+// Renders procedural scenes headless for a fixed number of frames and reports frame time percentiles, draw counts
+// and memory use, on the console and as JSON so that a run can be compared against a baseline.
+//
+// Usage: azha_bench [--frames N] [--warmup N] [--width W] [--height H] [--scene NAME]... [--parallel]
+//                   [--pipeline-statistics] [--output PATH] [--list]
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    uint32_t frames = 600;
+    uint32_t warmup = 60;
+    VkExtent2D extent = {1280, 720};
+    bool parallel = false;
+
+    // Averages pipeline statistics and occlusion queries over the measured frames. Queries add GPU work, and do not
+    // see into the secondary command buffers of parallel recording.
+    bool pipelineStatistics = false;
+
+    std::string output = "azha_bench.json";
+
+    // Empty runs every scene.
+    std::vector<std::string> scenes;
+};
+
+struct SceneResult
+{
+    zh::bench::BenchScene::Settings settings;
+
+    // Milliseconds. The frame time spans a whole loop iteration, the CPU and GPU times come from the frame pacer.
+    zh::bench::Statistics::Summary frameTime;
+    zh::bench::Statistics::Summary cpuTime;
+    zh::bench::Statistics::Summary gpuTime;
+
+    // Per frame averages.
+    double draws = 0.0;
+    double batches = 0.0;
+    double instances = 0.0;
+    uint64_t triangles = 0;
+
+    // Per frame averages, when pipeline statistics are enabled and supported.
+    bool hasPipelineStatistics = false;
+    zh::PipelineStatistics::Counts pipelineStatistics{};
+
+    // Bytes.
+    uint64_t peakMemoryUsage = 0;
+    uint64_t memoryBudget = 0;
+    uint32_t allocationCount = 0;
+    uint64_t allocationBytes = 0;
+    uint64_t blockBytes = 0;
+};
+
+// Names are part of the JSON output, renaming a scene breaks comparisons with older baselines.
+const std::vector<zh::bench::BenchScene::Settings> SCENES = {
+    {"static_1k", 1000, 16, 0.f, true},
+    {"static_10k", 10000, 64, 0.f, true},
+    {"static_50k", 50000, 64, 0.f, true},
+    {"dynamic_10k", 10000, 64, 1.f, true},
+    {"mixed_10k", 10000, 64, 0.25f, true},
+    // Every object has its own model, nothing can be instanced.
+    {"unique_4k", 4096, 4096, 0.f, true},
+    // Separate vertex and index buffers per model, nothing can be merged into indirect draws.
+    {"no_arena_10k", 10000, 64, 0.25f, false},
+};
+
+void printUsage()
+{
+    std::cout << "Usage: azha_bench [--frames N] [--warmup N] [--width W] [--height H] [--scene NAME]... "
+                 "[--parallel] [--pipeline-statistics] [--output PATH] [--list]\n";
+}
+
+const uint32_t parseCount(const std::string &option, const std::string &value)
+{
+    try
+    {
+        const unsigned long count = std::stoul(value);
+        if (count > 0 && count <= std::numeric_limits<uint32_t>::max())
+            return static_cast<uint32_t>(count);
+    }
+    catch (const std::exception &)
+    {
+    }
+
+    throw std::runtime_error("azha_bench: INVALID VALUE FOR " + option + ": " + value);
+}
+
+const Options parseOptions(int argc, char **argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+
+        if (option == "--parallel")
+        {
+            options.parallel = true;
+            continue;
+        }
+
+        if (option == "--pipeline-statistics")
+        {
+            options.pipelineStatistics = true;
+            continue;
+        }
+
+        if (option == "--list")
+        {
+            for (auto &scene : SCENES)
+                std::cout << scene.name << "\n";
+            std::exit(EXIT_SUCCESS);
+        }
+
+        if (option == "--help" || option == "-h")
+        {
+            printUsage();
+            std::exit(EXIT_SUCCESS);
+        }
+
+        if (i + 1 >= argc)
+            throw std::runtime_error("azha_bench: MISSING VALUE FOR " + option);
+
+        const std::string value = argv[++i];
+
+        if (option == "--frames")
+            options.frames = parseCount(option, value);
+        else if (option == "--warmup")
+            options.warmup = parseCount(option, value);
+        else if (option == "--width")
+            options.extent.width = parseCount(option, value);
+        else if (option == "--height")
+            options.extent.height = parseCount(option, value);
+        else if (option == "--output")
+            options.output = value;
+        else if (option == "--scene")
+        {
+            auto it = std::find_if(SCENES.begin(), SCENES.end(), [&](auto &scene) { return scene.name == value; });
+            if (it == SCENES.end())
+                throw std::runtime_error("azha_bench: UNKNOWN SCENE: " + value);
+
+            options.scenes.push_back(value);
+        }
+        else
+            throw std::runtime_error("azha_bench: UNKNOWN OPTION: " + option);
+    }
+
+    if (options.parallel && options.pipelineStatistics)
+        throw std::runtime_error("azha_bench: --pipeline-statistics CANNOT BE COMBINED WITH --parallel");
+
+    return options;
+}
+
+// Usage and budget summed over every memory heap.
+void getMemoryBudget(zh::Device &device, uint64_t &usage, uint64_t &budget)
+{
+    const VkPhysicalDeviceMemoryProperties *memory_properties;
+    vmaGetMemoryProperties(device.getAllocator(), &memory_properties);
+
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(device.getAllocator(), budgets);
+
+    usage = 0;
+    budget = 0;
+
+    for (uint32_t i = 0; i < memory_properties->memoryHeapCount; ++i)
+    {
+        usage += budgets[i].usage;
+        budget += budgets[i].budget;
+    }
+}
+
+// Records one frame of the scene and adds its draw counts to result.
+void renderFrame(zh::Device &device, zh::Renderer &renderer, zh::Pipeline &pipeline,
+                 zh::DescriptorSetLayout &descriptor_set_layout, zh::bench::BenchScene &scene, const Camera &camera,
+                 const bool parallel, SceneResult *result)
+{
+    VkCommandBuffer command_buffer = renderer.beginFrame();
+    if (command_buffer == nullptr)
+        throw std::runtime_error("azha_bench: COULD NOT BEGIN FRAME");
+
+    zh::FrameContext &frame = renderer.getFrameContext();
+
+    UniformBufferObject ubo{glm::mat4{1.f}, camera.getView(), camera.getProjection()};
+
+    VkDeviceSize ubo_offset;
+    zh::Buffer &ubo_buffer = frame.allocateTransient(sizeof(ubo), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, ubo_offset);
+    ubo_buffer.write(&ubo, sizeof(ubo), ubo_offset);
+
+    VkDescriptorSet descriptor_set = frame.allocateDescriptorSet(descriptor_set_layout);
+    VkDescriptorBufferInfo buffer_info{ubo_buffer.getBuffer(), ubo_offset, sizeof(ubo)};
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptor_set;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    write.pBufferInfo = &buffer_info;
+    vkUpdateDescriptorSets(device.getLogicalDevice(), 1, &write, 0, nullptr);
+
+    renderer.queueObjects(scene.getObjects(), pipeline, descriptor_set, camera);
+
+    // Sorting here does not add work, the flush reuses the batches.
+    zh::RenderQueue &render_queue = renderer.getRenderQueue();
+    render_queue.sort();
+
+    if (result != nullptr)
+    {
+        result->draws += render_queue.getDraws().size();
+        result->batches += render_queue.getBatches().size();
+        result->instances += render_queue.getSize();
+    }
+
+    // Dropped, at no cost, while pipeline statistics are disabled.
+    zh::PipelineStatistics &pipeline_statistics = renderer.getPipelineStatistics();
+    pipeline_statistics.beginScope(command_buffer, "scene");
+
+    if (parallel)
+    {
+        renderer.beginSwapchainRenderPass(command_buffer, true, VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT);
+        renderer.flushRenderQueueParallel(command_buffer);
+    }
+    else
+    {
+        renderer.beginSwapchainRenderPass(command_buffer);
+        renderer.flushRenderQueue(command_buffer);
+    }
+
+    renderer.endSwapchainRenderPass(command_buffer);
+    pipeline_statistics.endScope(command_buffer);
+
+    renderer.endFrame();
+}
+
+const SceneResult runScene(zh::Device &device, zh::Renderer &renderer, zh::Pipeline &pipeline,
+                           zh::DescriptorSetLayout &descriptor_set_layout,
+                           const zh::bench::BenchScene::Settings &settings, const Options &options)
+{
+    SceneResult result;
+    result.settings = settings;
+
+    zh::bench::BenchScene scene(device, settings);
+    result.triangles = scene.getTriangleCount();
+
+    const float aspect = renderer.getAspectRatio();
+    Camera camera;
+    camera.setOrthographicProjection(-aspect, aspect, -1.f, 1.f, 0.1f, 10.f);
+    camera.setViewDirection(glm::vec3{0.f, 0.f, -1.f}, glm::vec3{0.f, 0.f, 1.f});
+
+    // Frame pacer timings are resolved a few frames late, they are matched to the measured frames by number.
+    zh::FramePacer &frame_pacer = renderer.getFramePacer();
+    const uint64_t first_frame = device.getFrameTimeline().getPendingFrame() + options.warmup;
+    const uint64_t end_frame = first_frame + options.frames;
+    uint64_t next_frame = first_frame;
+
+    std::vector<double> frame_times, cpu_times, gpu_times;
+    frame_times.reserve(options.frames);
+    cpu_times.reserve(options.frames);
+    gpu_times.reserve(options.frames);
+
+    auto collect_timings = [&]() {
+        for (auto &timings : frame_pacer.getTimings())
+        {
+            if (timings.frame < next_frame || timings.frame >= end_frame)
+                continue;
+
+            cpu_times.push_back(timings.cpuTime);
+            if (timings.gpuTime > 0.0)
+                gpu_times.push_back(timings.gpuTime);
+
+            next_frame = timings.frame + 1;
+        }
+    };
+
+    // Dynamic objects move by frame number rather than by elapsed time, so every run renders the same frames.
+    const uint32_t frame_count = options.warmup + options.frames;
+    for (uint32_t i = 0; i < frame_count; ++i)
+    {
+        const bool measured = i >= options.warmup;
+        const auto start = Clock::now();
+
+        if (i == options.warmup)
+            renderer.getPipelineStatistics().resetStatistics();
+
+        scene.update(i / 60.f);
+        renderFrame(device, renderer, pipeline, descriptor_set_layout, scene, camera, options.parallel,
+                    measured ? &result : nullptr);
+
+        if (measured)
+        {
+            frame_times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+            uint64_t usage, budget;
+            getMemoryBudget(device, usage, budget);
+            result.peakMemoryUsage = std::max(result.peakMemoryUsage, usage);
+            result.memoryBudget = budget;
+        }
+
+        collect_timings();
+    }
+
+    // A few more frames let the pacer resolve the timings of the last measured ones.
+    for (uint32_t i = 0; i < renderer.getFramesInFlight() + 2 && next_frame < end_frame; ++i)
+    {
+        scene.update((frame_count + i) / 60.f);
+        renderFrame(device, renderer, pipeline, descriptor_set_layout, scene, camera, options.parallel, nullptr);
+        collect_timings();
+    }
+
+    const zh::PipelineStatistics::Statistics *scene_statistics =
+        renderer.getPipelineStatistics().getStatistics("scene");
+
+    if (scene_statistics != nullptr && scene_statistics->sampleCount > 0)
+    {
+        const zh::PipelineStatistics::Counts &total = scene_statistics->total;
+        const uint64_t samples = scene_statistics->sampleCount;
+
+        result.hasPipelineStatistics = true;
+        result.pipelineStatistics = zh::PipelineStatistics::Counts{total.inputVertices / samples,
+                                                                   total.inputPrimitives / samples,
+                                                                   total.vertexInvocations / samples,
+                                                                   total.clippingInvocations / samples,
+                                                                   total.clippingPrimitives / samples,
+                                                                   total.fragmentInvocations / samples,
+                                                                   total.computeInvocations / samples,
+                                                                   total.samplesPassed / samples};
+    }
+
+    VmaTotalStatistics statistics;
+    vmaCalculateStatistics(device.getAllocator(), &statistics);
+    result.allocationCount = statistics.total.statistics.allocationCount;
+    result.allocationBytes = statistics.total.statistics.allocationBytes;
+    result.blockBytes = statistics.total.statistics.blockBytes;
+
+    result.frameTime = zh::bench::Statistics::summarize(std::move(frame_times));
+    result.cpuTime = zh::bench::Statistics::summarize(std::move(cpu_times));
+    result.gpuTime = zh::bench::Statistics::summarize(std::move(gpu_times));
+
+    result.draws /= options.frames;
+    result.batches /= options.frames;
+    result.instances /= options.frames;
+
+    // The scene's models must not be destroyed while frames still use them.
+    vkDeviceWaitIdle(device.getLogicalDevice());
+
+    return result;
+}
+
+void printResult(const SceneResult &result)
+{
+    std::cout << std::left << std::setw(14) << result.settings.name << std::right << std::fixed
+              << std::setprecision(3) << " frame p50 " << std::setw(8) << result.frameTime.p50 << " p99 "
+              << std::setw(8) << result.frameTime.p99 << " | cpu p50 " << std::setw(8) << result.cpuTime.p50
+              << " p99 " << std::setw(8) << result.cpuTime.p99 << " | gpu p50 " << std::setw(8)
+              << result.gpuTime.p50 << " p99 " << std::setw(8) << result.gpuTime.p99 << " ms | "
+              << std::setprecision(0) << result.draws << " draws, " << result.batches << " batches, "
+              << result.peakMemoryUsage / (1024 * 1024) << " MiB" << std::endl;
+}
+
+// Device and scene names end up in the results as JSON strings, so quotes, backslashes and control characters are
+// escaped.
+const std::string escapeJson(const std::string &text)
+{
+    std::ostringstream escaped;
+
+    for (const char character : text)
+    {
+        switch (character)
+        {
+        case '"':
+            escaped << "\\\"";
+            break;
+        case '\\':
+            escaped << "\\\\";
+            break;
+        case '\n':
+            escaped << "\\n";
+            break;
+        case '\r':
+            escaped << "\\r";
+            break;
+        case '\t':
+            escaped << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(character) < 0x20)
+                escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                        << static_cast<int>(static_cast<unsigned char>(character)) << std::dec << std::setfill(' ');
+            else
+                escaped << character;
+        }
+    }
+
+    return escaped.str();
+}
+
+void writeResults(zh::Device &device, const Options &options, const std::vector<SceneResult> &results)
+{
+    std::ofstream file(options.output);
+    if (!file.is_open())
+        throw std::runtime_error("azha_bench: COULD NOT OPEN " + options.output);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.getPhysicalDevice(), &properties);
+
+    file << std::setprecision(6) << std::fixed;
+    file << "{\n";
+    file << "  \"device\": \"" << escapeJson(properties.deviceName) << "\",\n";
+    file << "  \"vendorId\": " << properties.vendorID << ",\n";
+    file << "  \"driverVersion\": " << properties.driverVersion << ",\n";
+    file << "  \"width\": " << options.extent.width << ",\n";
+    file << "  \"height\": " << options.extent.height << ",\n";
+    file << "  \"frames\": " << options.frames << ",\n";
+    file << "  \"warmup\": " << options.warmup << ",\n";
+    file << "  \"parallel\": " << (options.parallel ? "true" : "false") << ",\n";
+    file << "  \"scenes\": [\n";
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const SceneResult &result = results[i];
+
+        file << "    {\n";
+        file << "      \"name\": \"" << escapeJson(result.settings.name) << "\",\n";
+        file << "      \"objects\": " << result.settings.objectCount << ",\n";
+        file << "      \"models\": " << result.settings.modelCount << ",\n";
+        file << "      \"dynamicFraction\": " << result.settings.dynamicFraction << ",\n";
+        file << "      \"arena\": " << (result.settings.useArena ? "true" : "false") << ",\n";
+        file << "      \"frameTime\": ";
+        zh::bench::Statistics::writeJson(file, result.frameTime);
+        file << ",\n      \"cpuTime\": ";
+        zh::bench::Statistics::writeJson(file, result.cpuTime);
+        file << ",\n      \"gpuTime\": ";
+        zh::bench::Statistics::writeJson(file, result.gpuTime);
+        file << ",\n";
+        file << "      \"draws\": " << result.draws << ",\n";
+        file << "      \"batches\": " << result.batches << ",\n";
+        file << "      \"instances\": " << result.instances << ",\n";
+        file << "      \"triangles\": " << result.triangles << ",\n";
+
+        if (result.hasPipelineStatistics)
+        {
+            const zh::PipelineStatistics::Counts &counts = result.pipelineStatistics;
+
+            file << "      \"pipelineStatistics\": {\"inputVertices\": " << counts.inputVertices
+                 << ", \"inputPrimitives\": " << counts.inputPrimitives
+                 << ", \"vertexInvocations\": " << counts.vertexInvocations
+                 << ", \"clippingInvocations\": " << counts.clippingInvocations
+                 << ", \"clippingPrimitives\": " << counts.clippingPrimitives
+                 << ", \"fragmentInvocations\": " << counts.fragmentInvocations
+                 << ", \"computeInvocations\": " << counts.computeInvocations
+                 << ", \"samplesPassed\": " << counts.samplesPassed << "},\n";
+        }
+        file << "      \"memory\": {\"peakUsage\": " << result.peakMemoryUsage
+             << ", \"budget\": " << result.memoryBudget << ", \"allocationCount\": " << result.allocationCount
+             << ", \"allocationBytes\": " << result.allocationBytes << ", \"blockBytes\": " << result.blockBytes
+             << "}\n";
+        file << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    file << "  ]\n";
+    file << "}\n";
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const Options options = parseOptions(argc, argv);
+
+        zh::Device device;
+
+        zh::OffscreenTarget::Settings target_settings;
+        target_settings.extent = options.extent;
+        zh::Renderer renderer(device, target_settings);
+
+        renderer.getPipelineStatistics().setEnabled(options.pipelineStatistics);
+        if (options.pipelineStatistics && !renderer.getPipelineStatistics().isSupported())
+            std::cerr << "azha_bench: pipeline statistics queries are not supported by this device" << std::endl;
+
+        auto descriptor_set_layout = zh::DescriptorSetLayout::Builder(device)
+                                         .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                                         .build();
+
+        zh::Pipeline pipeline(device, renderer.getRenderTarget(), "Assets/Shaders/vert.spv",
+                              "Assets/Shaders/frag.spv", {descriptor_set_layout->getDescriptorSetLayout()});
+
+        std::vector<SceneResult> results;
+
+        for (auto &scene : SCENES)
+        {
+            if (!options.scenes.empty() &&
+                std::find(options.scenes.begin(), options.scenes.end(), scene.name) == options.scenes.end())
+                continue;
+
+            results.push_back(runScene(device, renderer, pipeline, *descriptor_set_layout, scene, options));
+            printResult(results.back());
+        }
+
+        writeResults(device, options, results);
+        std::cout << "Results written to " << options.output << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
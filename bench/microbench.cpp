@@ -0,0 +1,402 @@
+#include "stdafx.hpp"
+#include "BenchHarness.hpp"
+#include "Graphics/Rendering/RenderGraph.hpp"
+#include "System/Memory/Buffer.hpp"
+#include "System/Rendering/Descriptors.hpp"
+#include "System/Rendering/OffscreenTarget.hpp"
+#include "System/Rendering/Pipeline.hpp"
+#include "System/Scene/Camera.hpp"
+#include "System/Scene/OcclusionRasterizer.hpp"
+
+// Microbenchmarks of the low level wrappers: buffer creation, uploads through Buffer::copy, descriptor allocation and
+// writes, pipeline creation and render graph compilation, plus the CPU occlusion rasteriser. Runs on any Vulkan
+// device without a window, including lavapipe, so regressions in the wrappers can be caught on machines without a GPU.
+//
+// Usage: azha_microbench [--filter TEXT] [--min-time SECONDS] [--repetitions N] [--quick] [--output PATH]
+
+namespace
+{
+struct Options
+{
+    zh::bench::BenchHarness::Settings settings;
+    std::string output = "azha_microbench.json";
+};
+
+const Options parseOptions(int argc, char **argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+
+        // Short runs for CI, where software rasterizers make every operation slow and only large changes matter.
+        if (option == "--quick")
+        {
+            options.settings.warmupRepetitions = 1;
+            options.settings.minRepetitions = 5;
+            options.settings.minTime = 0.05;
+            continue;
+        }
+
+        if (option == "--help" || option == "-h")
+        {
+            std::cout << "Usage: azha_microbench [--filter TEXT] [--min-time SECONDS] [--repetitions N] [--quick] "
+                         "[--output PATH]\n";
+            std::exit(EXIT_SUCCESS);
+        }
+
+        if (i + 1 >= argc)
+            throw std::runtime_error("azha_microbench: MISSING VALUE FOR " + option);
+
+        const std::string value = argv[++i];
+
+        try
+        {
+            if (option == "--filter")
+                options.settings.filter = value;
+            else if (option == "--min-time")
+                options.settings.minTime = std::stod(value);
+            else if (option == "--repetitions")
+                options.settings.minRepetitions = static_cast<uint32_t>(std::stoul(value));
+            else if (option == "--output")
+                options.output = value;
+            else
+                throw std::runtime_error("azha_microbench: UNKNOWN OPTION: " + option);
+        }
+        catch (const std::logic_error &)
+        {
+            throw std::runtime_error("azha_microbench: INVALID VALUE FOR " + option + ": " + value);
+        }
+    }
+
+    return options;
+}
+
+const std::string formatSize(const VkDeviceSize size)
+{
+    if (size >= 1024 * 1024)
+        return std::to_string(size / (1024 * 1024)) + "m";
+
+    return std::to_string(size / 1024) + "k";
+}
+
+void benchmarkBufferCreation(zh::Device &device, zh::bench::BenchHarness &microbench)
+{
+    struct Kind
+    {
+        std::string name;
+        VkBufferUsageFlags usage;
+        VkMemoryPropertyFlags properties;
+        VmaAllocationCreateFlags flags;
+    };
+
+    const std::vector<Kind> kinds = {
+        {"host", VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+         VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT},
+        {"device", VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0},
+    };
+
+    constexpr uint32_t BUFFERS = 64;
+
+    for (auto &kind : kinds)
+    {
+        for (const VkDeviceSize size : {VkDeviceSize(4 * 1024), VkDeviceSize(1024 * 1024)})
+        {
+            microbench.run("buffer/create_destroy/" + kind.name + "_" + formatSize(size), BUFFERS, [&]() {
+                for (uint32_t i = 0; i < BUFFERS; ++i)
+                {
+                    zh::Buffer buffer(device.getAllocator(), size, kind.usage, kind.properties,
+                                      VMA_MEMORY_USAGE_AUTO, kind.flags);
+                }
+            });
+        }
+    }
+}
+
+// Staging to device local copies the way models and geometry arenas upload, each one waiting on its own fence.
+void benchmarkBufferCopy(zh::Device &device, zh::bench::BenchHarness &microbench)
+{
+    for (const VkDeviceSize size : {VkDeviceSize(4 * 1024), VkDeviceSize(64 * 1024), VkDeviceSize(1024 * 1024),
+                                    VkDeviceSize(16 * 1024 * 1024)})
+    {
+        zh::Buffer staging_buffer(device.getAllocator(), size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                  VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                  VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+        zh::Buffer device_buffer(device.getAllocator(), size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
+
+        std::vector<uint8_t> data(size, 0xAB);
+        staging_buffer.map();
+        staging_buffer.write(data.data(), data.size());
+
+        microbench.run(
+            "buffer/copy/" + formatSize(size), 1,
+            [&]() {
+                zh::Buffer::copy(device.getLogicalDevice(), device.getTransientCommandPool(), device.getTransferQueue(),
+                                 staging_buffer, device_buffer);
+            },
+            nullptr, size);
+    }
+}
+
+void benchmarkDescriptors(zh::Device &device, zh::bench::BenchHarness &microbench)
+{
+    constexpr uint32_t SETS = 256;
+
+    auto descriptor_set_layout = zh::DescriptorSetLayout::Builder(device)
+                                     .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                                     .build();
+
+    VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SETS};
+    zh::DescriptorPool descriptor_pool(device, SETS, 0, {pool_size});
+
+    zh::Buffer uniform_buffer(device.getAllocator(), sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                              VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+    VkDescriptorBufferInfo buffer_info{uniform_buffer.getBuffer(), 0, sizeof(UniformBufferObject)};
+
+    const auto reset_pool = [&]() { descriptor_pool.resetPool(); };
+
+    microbench.run(
+        "descriptor_pool/allocate", SETS,
+        [&]() {
+            VkDescriptorSet descriptor_set;
+            for (uint32_t i = 0; i < SETS; ++i)
+                descriptor_pool.allocateDescriptor(descriptor_set_layout->getDescriptorSetLayout(), descriptor_set);
+        },
+        reset_pool);
+
+    microbench.run(
+        "descriptor_writer/build", SETS,
+        [&]() {
+            VkDescriptorSet descriptor_set;
+            for (uint32_t i = 0; i < SETS; ++i)
+                zh::DescriptorWriter(device, *descriptor_set_layout, descriptor_pool)
+                    .writeBuffer(0, &buffer_info)
+                    .build(descriptor_set);
+        },
+        reset_pool);
+
+    // The write alone, without the allocation build() includes.
+    VkDescriptorSet descriptor_set;
+    descriptor_pool.allocateDescriptor(descriptor_set_layout->getDescriptorSetLayout(), descriptor_set);
+
+    microbench.run("descriptor_writer/overwrite", SETS, [&]() {
+        for (uint32_t i = 0; i < SETS; ++i)
+            zh::DescriptorWriter(device, *descriptor_set_layout, descriptor_pool)
+                .writeBuffer(0, &buffer_info)
+                .overwrite(descriptor_set);
+    });
+}
+
+// Pipelines are created through the device's pipeline cache, and drivers may cache compiled shaders internally, so
+// after the warmup this mostly measures pipeline creation on a warm cache. Destroyed pipelines wait in the deletion
+// queue, which is flushed untimed since no frame ever completes here.
+void benchmarkPipelines(zh::Device &device, zh::bench::BenchHarness &microbench)
+{
+    zh::OffscreenTarget::Settings target_settings;
+    target_settings.extent = {64, 64};
+    zh::OffscreenTarget target(device, target_settings);
+
+    auto descriptor_set_layout = zh::DescriptorSetLayout::Builder(device)
+                                     .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                                     .build();
+    const std::vector<VkDescriptorSetLayout> layouts = {descriptor_set_layout->getDescriptorSetLayout()};
+
+    const auto flush_deletions = [&]() { device.getDeletionQueue().flush(); };
+
+    microbench.run(
+        "pipeline/create", 1,
+        [&]() {
+            zh::Pipeline pipeline(device, target, "Assets/Shaders/vert.spv", "Assets/Shaders/frag.spv", layouts);
+        },
+        flush_deletions);
+}
+
+// A deferred shading frame with a pass nothing reads, so compiling it culls that pass, aliases transient images whose
+// lifetimes do not overlap and plans the barriers between the rest. What the compiler decided is checked and printed
+// before compilation is timed, so changes to culling, aliasing or barrier placement show up here too.
+void benchmarkRenderGraph(zh::Device &device, zh::bench::BenchHarness &microbench)
+{
+    using Graph = zh::RenderGraph;
+
+    zh::OffscreenTarget::Settings target_settings;
+    target_settings.extent = {1280, 720};
+    zh::OffscreenTarget target(device, target_settings);
+
+    const VkExtent2D extent = target.getExtent();
+    const Graph::ExecuteFunction execute = [](VkCommandBuffer &, Graph &) {};
+
+    Graph graph(device);
+
+    const Graph::Resource backbuffer =
+        graph.importImage("backbuffer", target.getImage(0), target.getImageView(0), target.getImageFormat(), extent,
+                          Graph::ResourceState{}, Graph::ResourceState{VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+                                                                       target.getFinalLayout()});
+
+    const Graph::Resource depth = graph.createImage("depth", {VK_FORMAT_D32_SFLOAT, extent});
+    const Graph::Resource occlusion = graph.createImage("occlusion", {VK_FORMAT_R8G8B8A8_UNORM, extent});
+    const Graph::Resource albedo = graph.createImage("albedo", {VK_FORMAT_R8G8B8A8_UNORM, extent});
+    const Graph::Resource hdr = graph.createImage("hdr", {VK_FORMAT_R16G16B16A16_SFLOAT, extent});
+    const Graph::Resource bloom = graph.createImage("bloom", {VK_FORMAT_R8G8B8A8_UNORM, extent});
+    const Graph::Resource debug = graph.createImage("debug", {VK_FORMAT_R8G8B8A8_UNORM, extent});
+
+    VkClearValue clear_depth{};
+    clear_depth.depthStencil = {1.0f, 0};
+
+    graph.addPass("depth_prepass", Graph::PassType::Graphics, execute)
+        .write(depth, Graph::Usage::DepthAttachment)
+        .clear(depth, clear_depth);
+    graph.addPass("occlusion", Graph::PassType::Graphics, execute)
+        .read(depth, Graph::Usage::Sampled)
+        .write(occlusion, Graph::Usage::ColorAttachment);
+    graph.addPass("gbuffer", Graph::PassType::Graphics, execute)
+        .read(depth, Graph::Usage::DepthRead)
+        .write(albedo, Graph::Usage::ColorAttachment);
+    graph.addPass("lighting", Graph::PassType::Graphics, execute)
+        .read(albedo, Graph::Usage::Sampled)
+        .read(occlusion, Graph::Usage::Sampled)
+        .write(hdr, Graph::Usage::ColorAttachment);
+    graph.addPass("debug", Graph::PassType::Graphics, execute).write(debug, Graph::Usage::ColorAttachment);
+    graph.addPass("bloom", Graph::PassType::Graphics, execute)
+        .read(hdr, Graph::Usage::Sampled)
+        .write(bloom, Graph::Usage::ColorAttachment);
+    graph.addPass("tonemap", Graph::PassType::Graphics, execute)
+        .read(hdr, Graph::Usage::Sampled)
+        .read(bloom, Graph::Usage::Sampled)
+        .write(backbuffer, Graph::Usage::ColorAttachment);
+
+    graph.compile();
+
+    // occlusion and albedo are dead once lighting ends, so bloom can take the memory of either.
+    constexpr size_t LIVE_TRANSIENT_IMAGES = 5;
+
+    if (!graph.isPassCulled("debug") || graph.isPassCulled("bloom"))
+        throw std::runtime_error("azha_microbench: RENDER GRAPH CULLED THE WRONG PASSES");
+
+    if (graph.getTransientAllocationCount() >= LIVE_TRANSIENT_IMAGES)
+        throw std::runtime_error("azha_microbench: RENDER GRAPH DID NOT ALIAS ANY TRANSIENT IMAGE");
+
+    std::cout << "render_graph: " << LIVE_TRANSIENT_IMAGES << " transient images in "
+              << graph.getTransientAllocationCount() << " allocations, " << graph.getBarrierCount() << " barriers"
+              << std::endl;
+
+    // Every compilation retires the previous transient images; nothing completes a frame here, so flush them.
+    const auto flush_deletions = [&]() { device.getDeletionQueue().flush(); };
+
+    microbench.run("render_graph/compile", 1, [&]() { graph.compile(); }, flush_deletions);
+}
+
+// Rows of box occluders in front of the camera and a grid of small bounds behind and beside them, rasterised on the
+// calling thread and across a thread pool, then tested. Like the render graph, the result is checked before timing, so
+// a rasteriser that stops covering pixels, or covers all of them, fails instead of getting faster.
+void benchmarkOcclusion(zh::bench::BenchHarness &microbench)
+{
+    constexpr uint32_t OCCLUDER_COLUMNS = 8;
+    constexpr uint32_t OCCLUDER_ROWS = 8;
+    constexpr uint32_t BOUNDS_COLUMNS = 64;
+    constexpr uint32_t BOUNDS_ROWS = 16;
+
+    const std::vector<glm::vec3> box_vertices = {
+        {-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, -0.5f}, {-0.5f, 0.5f, -0.5f},
+        {-0.5f, -0.5f, 0.5f},  {0.5f, -0.5f, 0.5f},  {0.5f, 0.5f, 0.5f},  {-0.5f, 0.5f, 0.5f},
+    };
+    const std::vector<uint32_t> box_indices = {0, 1, 2, 0, 2, 3, 4, 6, 5, 4, 7, 6, 0, 4, 5, 0, 5, 1,
+                                               3, 2, 6, 3, 6, 7, 0, 3, 7, 0, 7, 4, 1, 5, 6, 1, 6, 2};
+
+    zh::OcclusionRasterizer rasterizer(320, 180);
+
+    for (uint32_t row = 0; row < OCCLUDER_ROWS; ++row)
+    {
+        for (uint32_t column = 0; column < OCCLUDER_COLUMNS; ++column)
+        {
+            const glm::vec3 position(-14.f + 4.f * column, 0.f, 12.f + 4.f * row);
+            const glm::mat4 transform =
+                glm::scale(glm::translate(glm::mat4(1.f), position), glm::vec3(3.f, 6.f, 0.5f));
+
+            rasterizer.addOccluder(box_vertices, box_indices, transform);
+        }
+    }
+
+    std::vector<zh::AABB> bounds;
+
+    for (uint32_t row = 0; row < BOUNDS_ROWS; ++row)
+    {
+        for (uint32_t column = 0; column < BOUNDS_COLUMNS; ++column)
+        {
+            const glm::vec3 center(-32.f + 1.f * column, 0.f, 14.f + 3.f * row);
+            bounds.push_back({center - glm::vec3(0.25f), center + glm::vec3(0.25f)});
+        }
+    }
+
+    Camera camera;
+    camera.setPerspectiveProjection(glm::radians(60.f), 16.f / 9.f, 0.1f, 100.f);
+    camera.setViewDirection(glm::vec3(0.f), glm::vec3(0.f, 0.f, 1.f));
+
+    const glm::mat4 view_projection = camera.getProjection() * camera.getView();
+
+    zh::ThreadPool thread_pool;
+    rasterizer.rasterize(view_projection, &thread_pool);
+
+    size_t visible_count = 0;
+
+    for (auto &bound : bounds)
+        visible_count += rasterizer.isVisible(bound) ? 1 : 0;
+
+    if (visible_count == 0 || visible_count == bounds.size())
+        throw std::runtime_error("azha_microbench: OCCLUSION RASTERIZER CULLED ALL OR NONE OF THE BOUNDS");
+
+    std::cout << "occlusion: " << rasterizer.getTriangleCount() << " occluder triangles, " << visible_count << " of "
+              << bounds.size() << " bounds visible" << std::endl;
+
+    microbench.run("occlusion/rasterize/serial", 1, [&]() { rasterizer.rasterize(view_projection); });
+
+    microbench.run("occlusion/rasterize/thread_pool", 1,
+                   [&]() { rasterizer.rasterize(view_projection, &thread_pool); });
+
+    microbench.run("occlusion/is_visible", static_cast<uint32_t>(bounds.size()), [&]() {
+        visible_count = 0;
+        for (auto &bound : bounds)
+            visible_count += rasterizer.isVisible(bound) ? 1 : 0;
+    });
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const Options options = parseOptions(argc, argv);
+
+        zh::Device device;
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device.getPhysicalDevice(), &properties);
+        std::cout << "Device: " << properties.deviceName << std::endl;
+
+        zh::bench::BenchHarness microbench(options.settings);
+
+        benchmarkBufferCreation(device, microbench);
+        benchmarkBufferCopy(device, microbench);
+        benchmarkDescriptors(device, microbench);
+        benchmarkPipelines(device, microbench);
+        benchmarkRenderGraph(device, microbench);
+        benchmarkOcclusion(microbench);
+
+        vkDeviceWaitIdle(device.getLogicalDevice());
+
+        microbench.writeJson(options.output);
+        std::cout << "Results written to " << options.output << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
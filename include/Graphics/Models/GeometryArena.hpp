@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Graphics/Vertex/Vertex.hpp"
+#include "System/Core/Device.hpp"
+#include "System/Memory/Buffer.hpp"
+#include "System/Memory/StagingBuffer.hpp"
+
+namespace zh
+{
+// Shared vertex and index buffers that many models sub-allocate from, so their draws can be merged into a single
+// indirect call. Allocation is linear and ranges live as long as the arena.
+class GeometryArena
+{
+  public:
+    struct Range
+    {
+        int32_t vertexOffset;
+        uint32_t firstIndex;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+    };
+
+    GeometryArena(Device &device, const uint32_t vertex_capacity, const uint32_t index_capacity);
+
+    GeometryArena() = delete;
+    GeometryArena(const GeometryArena &) = delete;
+    GeometryArena &operator=(const GeometryArena &) = delete;
+
+    ~GeometryArena();
+
+    const Range allocate(const std::vector<Vertex> &vertices, const std::vector<Index> &indices);
+
+    void bind(VkCommandBuffer &command_buffer);
+
+    Buffer &getVertexBuffer();
+
+    Buffer &getIndexBuffer();
+
+    const uint32_t getId() const;
+
+  private:
+    inline static uint32_t idCounter = 0;
+
+    Device &device;
+    uint32_t id;
+
+    std::unique_ptr<Buffer> vertexBuffer;
+    std::unique_ptr<Buffer> indexBuffer;
+
+    uint32_t vertexCapacity;
+    uint32_t indexCapacity;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+
+    void upload(const void *data, const VkDeviceSize size, Buffer &dst, const VkDeviceSize dst_offset);
+};
+} // namespace zh
@@ -2,10 +2,12 @@
 
 #include <vk_mem_alloc.h>
 
+#include "Graphics/Models/GeometryArena.hpp"
 #include "Graphics/Vertex/Vertex.hpp"
 #include "System/Core/Device.hpp"
 #include "System/Memory/Buffer.hpp"
 #include "System/Memory/StagingBuffer.hpp"
+#include "System/Scene/Bounds.hpp"
 
 namespace zh
 {
@@ -20,6 +22,8 @@ class Model
 
     Model(Device &device, std::vector<Vertex> vertices, std::vector<Index> indices);
 
+    Model(Device &device, GeometryArena &arena, const std::vector<Vertex> &vertices, const std::vector<Index> &indices);
+
     ~Model();
 
     Model(const Model &) = delete;
@@ -29,23 +33,48 @@ class Model
 
     void draw(VkCommandBuffer &command_buffer);
 
+    void draw(VkCommandBuffer &command_buffer, const uint32_t instance_count, const uint32_t first_instance);
+
     void bind(VkCommandBuffer &command_buffer);
 
+    const AABB &getBounds() const;
+
+    const uint32_t getId() const;
+
+    // Null when the model owns its buffers.
+    GeometryArena *getArena() const;
+
+    const bool isIndexed() const;
+
+    const VkDrawIndexedIndirectCommand getIndirectCommand(const uint32_t instance_count,
+                                                          const uint32_t first_instance) const;
+
   private:
+    inline static uint32_t idCounter = 0;
+
     Device &device;
+    uint32_t id;
 
     std::unique_ptr<Buffer> vertexBuffer;
     std::unique_ptr<Buffer> indexBuffer;
 
+    GeometryArena *arena;
+
     uint32_t vertexCount;
     uint32_t indexCount;
+    int32_t vertexOffset;
+    uint32_t firstIndex;
 
     bool hasIndexBuffer;
     bool loaded;
 
-    void createVertexBuffer(std::vector<Vertex> &vertices);
+    AABB bounds;
+
+    void createVertexBuffer(const std::vector<Vertex> &vertices);
+
+    void createIndexBuffer(const std::vector<Index> &indices);
 
-    void createIndexBuffer(std::vector<Index> &indices);
+    void computeBounds(const std::vector<Vertex> &vertices);
 };
 
 } // namespace zh
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "System/Core/Device.hpp"
+
+namespace zh
+{
+// Secondary command buffers recorded once and replayed every frame until what they depend on changes. There is one
+// buffer per frame in flight, so a slot is only re-recorded once the GPU is done with it. Anything that changes per
+// frame must be read from buffers by the recorded commands rather than baked into them.
+class CachedPass
+{
+  public:
+    using RecordFunction = std::function<void(VkCommandBuffer &command_buffer, const int frame_index)>;
+
+    // Everything the recorded commands depend on. version belongs to the caller and should change with the
+    // scene contents drawn by the pass.
+    struct State
+    {
+        uint64_t version;
+        uint64_t pipelineGeneration;
+        uint64_t swapchainGeneration;
+        VkFormat colorFormat;
+        VkFormat depthFormat;
+
+        inline const bool operator==(const State &other) const
+        {
+            return version == other.version && pipelineGeneration == other.pipelineGeneration &&
+                   swapchainGeneration == other.swapchainGeneration && colorFormat == other.colorFormat &&
+                   depthFormat == other.depthFormat;
+        }
+    };
+
+    CachedPass(Device &device, const uint32_t frame_count);
+
+    CachedPass() = delete;
+    CachedPass(const CachedPass &) = delete;
+    CachedPass &operator=(const CachedPass &) = delete;
+
+    ~CachedPass();
+
+    // Returns the commands for frame_index, recording them again with record first if they were recorded for a
+    // different state. Rendering must have been begun with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT.
+    VkCommandBuffer &get(const int frame_index, const State &state, const RecordFunction &record);
+
+    // Forces every slot to be recorded again on its next use.
+    void invalidate();
+
+    // Number of times a slot was recorded, to check that unchanged frames replay.
+    const uint64_t getRecordCount() const;
+
+  private:
+    struct Slot
+    {
+        VkCommandPool commandPool;
+        VkCommandBuffer commandBuffer;
+        State state;
+        bool isRecorded = false;
+    };
+
+    Device &device;
+    std::vector<Slot> slots;
+    uint64_t recordCount;
+};
+} // namespace zh
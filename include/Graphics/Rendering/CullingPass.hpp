@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Graphics/Models/GeometryArena.hpp"
+#include "Graphics/Rendering/HiZPyramid.hpp"
+#include "Graphics/Vertex/InstanceData.hpp"
+#include "System/Rendering/ComputePipeline.hpp"
+#include "System/Rendering/Descriptors.hpp"
+#include "System/Rendering/Pipeline.hpp"
+#include "System/Scene/Camera.hpp"
+#include "System/Scene/Object.hpp"
+
+namespace zh
+{
+// GPU driven culling. Objects live in a persistent storage buffer; every frame a compute shader tests them against
+// the camera frustum and appends the survivors to an indirect buffer drawn with vkCmdDrawIndexedIndirectCount.
+// All objects must use models allocated from the same geometry arena.
+//
+// With occlusion culling a frame runs in two phases: cullEarly() and draw() render what was visible last frame,
+// the depth pyramid is built from that depth, then cullLate() tests every object against it and drawLate() renders
+// the ones that just became visible. The late phase also records the visibility read by the next early phase.
+class CullingPass
+{
+  public:
+    // Mirrors the std430 layout in cull.comp.
+    struct GPUObject
+    {
+        glm::mat4 transform;
+        glm::vec4 sphere;
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t flags;
+    };
+
+    // Mirrors the std140 layout in cull.comp.
+    struct CullData
+    {
+        glm::mat4 viewProjection;
+        glm::vec4 planes[6];
+        glm::vec2 pyramidSize;
+        uint32_t objectCount;
+        uint32_t padding;
+    };
+
+    enum class Phase : uint32_t
+    {
+        All = 0,
+        Early = 1,
+        Late = 2
+    };
+
+    struct PushConstants
+    {
+        Phase phase;
+    };
+
+    // frame_count should match the renderer's frames in flight.
+    CullingPass(Device &device, GeometryArena &arena, const uint32_t max_objects, const uint32_t frame_count);
+
+    CullingPass() = delete;
+    CullingPass(const CullingPass &) = delete;
+    CullingPass &operator=(const CullingPass &) = delete;
+
+    ~CullingPass();
+
+    // Every frame in flight has its own copy of the object buffer. Changes are kept on the CPU and written into a
+    // frame's copy when that frame next culls, never into a copy an earlier submission may still be reading.
+    const uint32_t addObject(Object &object);
+
+    void updateObject(const uint32_t slot, Object &object);
+
+    void removeObject(const uint32_t slot);
+
+    // Records a frustum only culling dispatch. Must be called outside a render pass.
+    void cull(VkCommandBuffer &command_buffer, const Camera &camera, const int frame_index);
+
+    // Frustum culls the objects that were visible last frame. Must be called outside a render pass.
+    void cullEarly(VkCommandBuffer &command_buffer, const Camera &camera, const int frame_index);
+
+    // Frustum and occlusion culls every object against a pyramid built this frame, keeping only the ones the early
+    // phase did not draw. Must be called outside a render pass.
+    void cullLate(VkCommandBuffer &command_buffer, const Camera &camera, HiZPyramid &pyramid, const int frame_index);
+
+    // Draws the objects that survived cull() or cullEarly(). Must be called inside a render pass.
+    void draw(VkCommandBuffer &command_buffer, Pipeline &pipeline, VkDescriptorSet descriptor_set,
+              const int frame_index);
+
+    // Draws the objects that survived cullLate(). Must be called inside a render pass.
+    void drawLate(VkCommandBuffer &command_buffer, Pipeline &pipeline, VkDescriptorSet descriptor_set,
+                  const int frame_index);
+
+    const uint32_t getObjectCount() const;
+
+  private:
+    struct PhaseResources
+    {
+        std::unique_ptr<Buffer> commandBuffer;
+        std::unique_ptr<Buffer> countBuffer;
+        std::unique_ptr<Buffer> instanceBuffer;
+        VkDescriptorSet descriptorSet;
+    };
+
+    struct FrameResources
+    {
+        PhaseResources primary;
+        PhaseResources late;
+        std::unique_ptr<Buffer> uniformBuffer;
+        VkDescriptorSet pyramidDescriptorSet;
+
+        // Slots changed since this frame's object buffer was last written.
+        std::unique_ptr<Buffer> objectBuffer;
+        std::vector<uint32_t> dirtySlots;
+        std::vector<bool> isSlotDirty;
+    };
+
+    Device &device;
+    GeometryArena &arena;
+
+    uint32_t maxObjects;
+    uint32_t objectCount;
+    std::vector<uint32_t> freeSlots;
+
+    // What every frame's object buffer converges to.
+    std::vector<GPUObject> objects;
+
+    std::unique_ptr<Buffer> visibilityBuffer;
+    bool isVisibilityCleared;
+    std::vector<FrameResources> frames;
+
+    std::unique_ptr<DescriptorSetLayout> descriptorSetLayout;
+    std::unique_ptr<DescriptorSetLayout> pyramidDescriptorSetLayout;
+    std::unique_ptr<DescriptorPool> descriptorPool;
+    std::unique_ptr<ComputePipeline> pipeline;
+    std::unique_ptr<ComputePipeline> latePipeline;
+
+    void createBuffers();
+
+    void createPhaseBuffers(PhaseResources &phase);
+
+    void createDescriptorSets();
+
+    void writePhaseDescriptorSet(PhaseResources &phase, FrameResources &frame);
+
+    void dispatch(VkCommandBuffer &command_buffer, const Camera &camera, const Phase phase, const int frame_index,
+                  const VkExtent2D pyramid_extent = {0, 0});
+
+    void drawPhase(VkCommandBuffer &command_buffer, Pipeline &pipeline, VkDescriptorSet descriptor_set,
+                   PhaseResources &phase);
+
+    void writeObject(const uint32_t slot, const GPUObject &gpu_object);
+
+    void flushObjects(FrameResources &frame);
+};
+} // namespace zh
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "System/Core/Device.hpp"
+#include "System/Memory/Buffer.hpp"
+#include "System/Rendering/Descriptors.hpp"
+
+namespace zh
+{
+// Everything one frame in flight records into or allocates from. Once the frame's fence has signaled, reset()
+// returns all of it at once: one vkResetCommandPool per pool, one descriptor pool reset, and the transient buffers
+// rewound, instead of tracking every command buffer and allocation separately.
+class FrameContext
+{
+  public:
+    FrameContext(Device &device, const uint32_t worker_count);
+
+    FrameContext() = delete;
+    FrameContext(const FrameContext &) = delete;
+    FrameContext &operator=(const FrameContext &) = delete;
+
+    ~FrameContext();
+
+    // Must only be called once the GPU is done with this frame.
+    void reset();
+
+    VkCommandBuffer &getCommandBuffer();
+
+    // Returns a secondary command buffer from the pool owned by worker. A worker must only be used by one thread
+    // at a time.
+    VkCommandBuffer acquireSecondaryCommandBuffer(const uint32_t worker);
+
+    const uint32_t getWorkerCount() const;
+
+    // Descriptor sets that only live for this frame.
+    VkDescriptorSet allocateDescriptorSet(const DescriptorSetLayout &descriptor_set_layout);
+
+    // Host visible sub-allocation valid until the next reset. Buffers with different usage flags are kept apart.
+    Buffer &allocateTransient(const VkDeviceSize size, const VkBufferUsageFlags usage, VkDeviceSize &offset);
+
+  private:
+    // Buffers outgrown mid frame are kept alive until the frame ends.
+    struct TransientBuffer
+    {
+        std::unique_ptr<Buffer> buffer;
+        VkDeviceSize offset = 0;
+        std::vector<std::unique_ptr<Buffer>> retired;
+    };
+
+    struct WorkerCommands
+    {
+        VkCommandPool commandPool;
+        std::vector<VkCommandBuffer> commandBuffers;
+        uint32_t usedCount = 0;
+    };
+
+    static constexpr uint32_t MAX_DESCRIPTOR_SETS = 256;
+
+    Device &device;
+
+    VkCommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    std::vector<WorkerCommands> workers;
+
+    std::unique_ptr<DescriptorPool> descriptorPool;
+
+    std::unordered_map<VkBufferUsageFlags, TransientBuffer> transientBuffers;
+
+    VkCommandPool createCommandPool();
+};
+} // namespace zh
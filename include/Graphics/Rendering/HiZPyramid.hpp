@@ -0,0 +1,69 @@
+#pragma once
+
+#include "System/Rendering/ComputePipeline.hpp"
+#include "System/Rendering/Descriptors.hpp"
+
+namespace zh
+{
+// Hierarchical depth pyramid built from the swapchain depth buffer. Every texel keeps the farthest depth of the
+// texels it covers one level below, so a bounding box whose nearest depth is behind it is fully occluded.
+// The pyramid is sized after the depth images, so it must be recreated whenever the swapchain extent changes.
+class HiZPyramid
+{
+  public:
+    // Mirrors the push constants in hiz.comp.
+    struct PushConstants
+    {
+        glm::ivec2 sourceSize;
+        glm::ivec2 destinationSize;
+    };
+
+    HiZPyramid(Device &device, const VkExtent2D extent, const VkFormat depth_format,
+               const std::vector<VkImageView> &depth_views);
+
+    HiZPyramid() = delete;
+    HiZPyramid(const HiZPyramid &) = delete;
+    HiZPyramid &operator=(const HiZPyramid &) = delete;
+
+    ~HiZPyramid();
+
+    // Reduces the depth image into every pyramid level. Must be called outside a render pass; the depth image is
+    // handed back in the depth attachment layout so the frame can keep rendering into it.
+    void build(VkCommandBuffer &command_buffer, VkImage depth_image, const uint32_t depth_index);
+
+    VkImageView &getView();
+
+    VkSampler &getSampler();
+
+    const VkExtent2D getExtent() const;
+
+    const uint32_t getLevelCount() const;
+
+  private:
+    Device &device;
+
+    VkExtent2D extent;
+    VkFormat depthFormat;
+    uint32_t levelCount;
+
+    VkImage image;
+    VmaAllocation imageMemory;
+    VkImageView view;
+    std::vector<VkImageView> levelViews;
+    VkSampler sampler;
+
+    std::unique_ptr<DescriptorSetLayout> descriptorSetLayout;
+    std::unique_ptr<DescriptorPool> descriptorPool;
+    std::vector<VkDescriptorSet> depthDescriptorSets;
+    std::vector<VkDescriptorSet> levelDescriptorSets;
+    std::unique_ptr<ComputePipeline> pipeline;
+
+    void createImage();
+
+    void createSampler();
+
+    void createDescriptorSets(const std::vector<VkImageView> &depth_views);
+
+    const VkExtent2D getLevelExtent(const uint32_t level) const;
+};
+} // namespace zh
@@ -0,0 +1,245 @@
+#pragma once
+
+#include "System/Core/Device.hpp"
+#include "System/Profiling/GpuProfiler.hpp"
+#include "System/Profiling/PipelineStatistics.hpp"
+
+namespace zh
+{
+// Passes declare the images and buffers they read and write; compile() culls passes nothing depends on, plans the
+// synchronization2 barriers and layout transitions between the remaining ones and allocates transient images, letting
+// those whose lifetimes do not overlap share memory. The compiled graph is executed every frame until it is cleared.
+// Passes run in the order they were added. Imported resources that change every frame, like the swapchain image,
+// are updated with setImportedImage() before execute().
+class RenderGraph
+{
+  public:
+    using Resource = uint32_t;
+    using ExecuteFunction = std::function<void(VkCommandBuffer &command_buffer, RenderGraph &graph)>;
+
+    enum class PassType
+    {
+        // Passes that write attachments are wrapped in dynamic rendering over those attachments.
+        Graphics,
+        Compute,
+        Transfer
+    };
+
+    enum class Usage
+    {
+        ColorAttachment,
+        DepthAttachment,
+        // Depth testing without depth writes.
+        DepthRead,
+        Sampled,
+        StorageRead,
+        StorageWrite,
+        TransferSource,
+        TransferDestination,
+        Uniform,
+        Vertex,
+        Index,
+        Indirect
+    };
+
+    // Stages, access and layout a resource is used with.
+    struct ResourceState
+    {
+        VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 access = VK_ACCESS_2_NONE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    struct ImageDescription
+    {
+        VkFormat format;
+        VkExtent2D extent;
+    };
+
+    class PassBuilder
+    {
+      public:
+        PassBuilder(RenderGraph &graph, const uint32_t pass);
+
+        PassBuilder &read(const Resource resource, const Usage usage);
+
+        PassBuilder &write(const Resource resource, const Usage usage);
+
+        // Clears an attachment when the pass begins instead of loading it.
+        PassBuilder &clear(const Resource resource, const VkClearValue clear_value);
+
+        // Keeps the pass even if nothing reads what it writes.
+        PassBuilder &setSideEffects();
+
+      private:
+        RenderGraph &graph;
+        uint32_t pass;
+    };
+
+    RenderGraph(Device &device);
+
+    RenderGraph() = delete;
+    RenderGraph(const RenderGraph &) = delete;
+    RenderGraph &operator=(const RenderGraph &) = delete;
+
+    ~RenderGraph();
+
+    // The graph moves the image from initial_state when it first uses it, and to final_state after the last pass.
+    // Writes to imported resources are never culled.
+    Resource importImage(const std::string &name, VkImage image, VkImageView view, const VkFormat format,
+                         const VkExtent2D extent, const ResourceState &initial_state,
+                         const ResourceState &final_state);
+
+    Resource importBuffer(const std::string &name, VkBuffer buffer, const ResourceState &initial_state);
+
+    // Allocated by compile(); its contents do not survive between frames.
+    Resource createImage(const std::string &name, const ImageDescription &description);
+
+    PassBuilder addPass(const std::string &name, const PassType type, const ExecuteFunction &execute);
+
+    void setImportedImage(const Resource resource, VkImage image, VkImageView view);
+
+    void setImportedBuffer(const Resource resource, VkBuffer buffer);
+
+    // Times every executed pass under its name. nullptr stops timing.
+    void setProfiler(GpuProfiler *profiler);
+
+    // Collects pipeline statistics of every executed pass under its name. nullptr stops collecting.
+    void setPipelineStatistics(PipelineStatistics *statistics);
+
+    void compile();
+
+    void execute(VkCommandBuffer &command_buffer);
+
+    // Drops every pass and resource. Transient images are retired through the device deletion queue.
+    void clear();
+
+    VkImage &getImage(const Resource resource);
+
+    VkImageView &getImageView(const Resource resource);
+
+    VkBuffer &getBuffer(const Resource resource);
+
+    const bool isCompiled() const;
+
+    const bool isPassCulled(const std::string &name) const;
+
+    // Number of memory allocations backing the transient images, at most one per transient image.
+    const size_t getTransientAllocationCount() const;
+
+    const size_t getBarrierCount() const;
+
+  private:
+    struct ResourceNode
+    {
+        std::string name;
+        bool isImage;
+        bool isImported;
+
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent = {0, 0};
+        VkImageUsageFlags usage = 0;
+
+        ResourceState initialState;
+        ResourceState finalState;
+
+        // Transient images only: memory slot and first and last live pass using it.
+        int memorySlot = -1;
+        int firstPass = -1;
+        int lastPass = -1;
+    };
+
+    struct ResourceAccess
+    {
+        Resource resource;
+        Usage usage;
+        bool isWrite;
+    };
+
+    struct PassNode
+    {
+        std::string name;
+        PassType type;
+        ExecuteFunction execute;
+        std::vector<ResourceAccess> accesses;
+        std::unordered_map<Resource, VkClearValue> clearValues;
+        bool hasSideEffects = false;
+        bool isCulled = false;
+    };
+
+    struct Barrier
+    {
+        Resource resource;
+        ResourceState source;
+        ResourceState destination;
+    };
+
+    struct Attachment
+    {
+        Resource resource;
+        VkImageLayout layout;
+        VkAttachmentLoadOp loadOp;
+        VkAttachmentStoreOp storeOp;
+        VkClearValue clearValue;
+    };
+
+    // One live pass of the compiled graph.
+    struct Step
+    {
+        uint32_t pass;
+        std::vector<Barrier> barriers;
+        std::vector<Attachment> colorAttachments;
+        std::optional<Attachment> depthAttachment;
+        VkExtent2D renderArea = {0, 0};
+    };
+
+    struct MemorySlot
+    {
+        VkMemoryRequirements requirements;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        std::vector<Resource> resources;
+    };
+
+    Device &device;
+    GpuProfiler *profiler;
+    PipelineStatistics *statistics;
+
+    std::vector<ResourceNode> resources;
+    std::vector<PassNode> passes;
+
+    std::vector<Step> steps;
+    std::vector<Barrier> finalBarriers;
+    std::vector<MemorySlot> memorySlots;
+    bool compiled;
+
+    void cullPasses();
+
+    void computeLifetimes();
+
+    void allocateTransientImages();
+
+    void planBarriers();
+
+    void planAttachments(Step &step);
+
+    void recordBarriers(VkCommandBuffer &command_buffer, const std::vector<Barrier> &barriers);
+
+    void destroyTransientImages();
+
+    const ResourceState getState(const PassType type, const Usage usage) const;
+
+    static const bool isWriteUsage(const Usage usage);
+
+    static const VkImageUsageFlags getImageUsage(const Usage usage);
+
+    // Every aspect of the format, for barriers.
+    static const VkImageAspectFlags getAspect(const VkFormat format);
+
+    // Depth only for depth stencil formats: a view that is sampled may select a single aspect only.
+    static const VkImageAspectFlags getViewAspect(const VkFormat format);
+};
+} // namespace zh
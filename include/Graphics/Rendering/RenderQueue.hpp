@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Graphics/Models/Model.hpp"
+#include "Graphics/Vertex/InstanceData.hpp"
+#include "System/Rendering/Pipeline.hpp"
+
+namespace zh
+{
+// Collects draws for a frame, orders them by a 64 bit sort key and records them with redundant binds removed.
+// Key layout, from the most significant bit: pass (4), pipeline (12), descriptor set (12), model (16), depth (20).
+// Transparent draws must blend back to front whatever their state, so their depth comes right after the pass:
+// pass (4), depth (20), pipeline (12), descriptor set (12), model (16).
+class RenderQueue
+{
+  public:
+    enum class Pass : uint8_t
+    {
+        Opaque = 0,
+        Transparent = 1,
+        Overlay = 2,
+    };
+
+    struct DrawItem
+    {
+        Pipeline *pipeline;
+        VkDescriptorSet descriptorSet;
+        Model *model;
+        glm::mat4 transform;
+    };
+
+    // A run of sorted draws sharing pipeline, descriptor set and model, drawn as one instanced draw. Transparent
+    // draws are never merged, instancing would blend them out of order.
+    struct Batch
+    {
+        Pipeline *pipeline;
+        VkDescriptorSet descriptorSet;
+        Model *model;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    // Consecutive batches sharing pipeline, descriptor set and geometry arena, submitted as one indirect draw whose
+    // commands start at firstBatch in the indirect command array. Other batches are drawn directly, one per draw.
+    struct Draw
+    {
+        Pipeline *pipeline;
+        VkDescriptorSet descriptorSet;
+        Model *model;
+        GeometryArena *arena;
+        uint32_t firstBatch;
+        uint32_t batchCount;
+    };
+
+    RenderQueue(Device &device);
+
+    RenderQueue() = delete;
+    RenderQueue(const RenderQueue &) = delete;
+    RenderQueue &operator=(const RenderQueue &) = delete;
+
+    // Depth is the view space distance, opaque draws are ordered front to back and transparent ones back to front.
+    void push(const Pass pass, Pipeline &pipeline, VkDescriptorSet descriptor_set, Model &model,
+              const glm::mat4 &transform, const float depth);
+
+    // Radix sorts the keys and builds the batches, draws, instance data and indirect commands. Does nothing when
+    // nothing was pushed since the last sort, so the batches can be inspected before the queue is flushed.
+    void sort();
+
+    // Records the draws in [first_draw, first_draw + draw_count). The instance data must be bound at binding 1 and
+    // the indirect commands written at indirect_offset. Without an indirect buffer every batch is drawn directly.
+    void record(VkCommandBuffer &command_buffer, const size_t first_draw, const size_t draw_count,
+                VkBuffer indirect_buffer = VK_NULL_HANDLE, const VkDeviceSize indirect_offset = 0) const;
+
+    void record(VkCommandBuffer &command_buffer, VkBuffer indirect_buffer = VK_NULL_HANDLE,
+                const VkDeviceSize indirect_offset = 0) const;
+
+    void clear();
+
+    const size_t getSize() const;
+
+    const std::vector<Batch> &getBatches() const;
+
+    const std::vector<Draw> &getDraws() const;
+
+    const std::vector<InstanceData> &getInstances() const;
+
+    const std::vector<VkDrawIndexedIndirectCommand> &getIndirectCommands() const;
+
+    static const uint64_t makeKey(const Pass pass, const uint32_t pipeline_id, const uint32_t descriptor_set_id,
+                                  const uint32_t model_id, const float depth);
+
+  private:
+    Device &device;
+
+    std::vector<DrawItem> items;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order;
+
+    std::vector<uint64_t> keysScratch;
+    std::vector<uint32_t> orderScratch;
+
+    std::unordered_map<VkDescriptorSet, uint32_t> descriptorSetIds;
+
+    std::vector<Batch> batches;
+    std::vector<Draw> draws;
+    std::vector<InstanceData> instances;
+    std::vector<VkDrawIndexedIndirectCommand> indirectCommands;
+
+    bool isSorted;
+
+    void radixSort();
+
+    void buildBatches();
+
+    void buildDraws();
+};
+} // namespace zh
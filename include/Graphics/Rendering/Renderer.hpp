@@ -1,22 +1,51 @@
 #pragma once
 
+#include "Graphics/Rendering/CachedPass.hpp"
+#include "Graphics/Rendering/FrameContext.hpp"
+#include "Graphics/Rendering/RenderQueue.hpp"
 #include "System/Core/Device.hpp"
+#include "System/Core/ThreadPool.hpp"
+#include "System/Profiling/GpuProfiler.hpp"
+#include "System/Profiling/PipelineStatistics.hpp"
+#include "System/Rendering/OffscreenTarget.hpp"
 #include "System/Rendering/Pipeline.hpp"
+#include "System/Rendering/Swapchain.hpp"
 #include "System/Rendering/Descriptors.hpp"
+#include "System/Scene/Camera.hpp"
+#include "System/Scene/Object.hpp"
 
 namespace zh
 {
 class Renderer
 {
   public:
-    Renderer(Device &device, Window &window);
+    Renderer(Device &device, Window &window, const Swapchain::Settings &settings = Swapchain::Settings{});
+
+    // Headless: frames are rendered into an offscreen target instead of a swapchain.
+    Renderer(Device &device, const OffscreenTarget::Settings &settings);
 
     ~Renderer();
 
     Renderer(const Renderer &) = delete;
     Renderer &operator=(const Renderer &) = delete;
 
-    VkRenderPass &getSwapchainRenderPass() const;
+    // Throws when headless.
+    Swapchain &getSwapchain();
+
+    // Throws unless headless.
+    OffscreenTarget &getOffscreenTarget();
+
+    // The swapchain, or the offscreen target when headless.
+    RenderTarget &getRenderTarget();
+
+    const bool isHeadless() const;
+
+    const VkExtent2D getExtent() const;
+
+    const uint32_t getImageIndex() const;
+
+    // Incremented every time the swapchain, and with it the attachments and extent, is recreated.
+    const uint64_t getSwapchainGeneration() const;
 
     const float getAspectRatio() const;
 
@@ -26,27 +55,101 @@ class Renderer
 
     const int getFrameIndex() const;
 
+    // Number of frame slots; per frame resources owned outside the renderer should be sized after it.
+    const uint32_t getFramesInFlight() const;
+
+    // Frame pacing policy and per frame CPU, GPU and latency measurements.
+    FramePacer &getFramePacer();
+
+    // GPU timings of the scopes recorded into frame command buffers; beginFrame() starts the profiler frame.
+    GpuProfiler &getGpuProfiler();
+
+    // Pipeline statistics and occlusion queries of scopes recorded into frame command buffers, disabled until
+    // enabled; beginFrame() starts their frame.
+    PipelineStatistics &getPipelineStatistics();
+
+    // Per frame command pools, descriptor sets and transient buffers of the frame in progress.
+    FrameContext &getFrameContext();
+
     VkCommandBuffer beginFrame();
 
     void endFrame();
 
-    void beginSwapchainRenderPass(VkCommandBuffer &command_buffer);
+    // Transitions the current target image and its depth image to attachment layouts and begins dynamic rendering
+    // into them. When clear is false the attachments keep what earlier passes of this frame rendered. Passes begun
+    // with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT may only be drawn into with flushRenderQueueParallel()
+    // and executeCachedPass().
+    void beginSwapchainRenderPass(VkCommandBuffer &command_buffer, const bool clear = true,
+                                  const VkRenderingFlags flags = 0);
 
+    // Ends rendering. The attachments stay in their attachment layouts for later passes of the frame; endFrame()
+    // hands the target image over for presentation, or for reading back when headless.
     void endSwapchainRenderPass(VkCommandBuffer &command_buffer);
 
+    RenderQueue &getRenderQueue();
+
+    // Pushes the objects to the render queue, keyed by their view space depth.
+    void queueObjects(const std::vector<Object *> &objects, Pipeline &pipeline, VkDescriptorSet descriptor_set,
+                      const Camera &camera, const RenderQueue::Pass pass = RenderQueue::Pass::Opaque);
+
+    // Sorts the render queue, uploads its instance data and records it, then clears it.
+    void flushRenderQueue(VkCommandBuffer &command_buffer);
+
+    // Same as flushRenderQueue(), but the draws are split across worker threads that each record a secondary
+    // command buffer, executed in order by the primary one.
+    void flushRenderQueueParallel(VkCommandBuffer &command_buffer);
+
+    // Replays the cached commands of pass, recording them first if version, any pipeline or the swapchain changed
+    // since this frame slot last recorded them. The viewport and scissor are set before record runs. The render
+    // pass must have been begun with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT.
+    void executeCachedPass(VkCommandBuffer &command_buffer, CachedPass &pass, const uint64_t version,
+                           const CachedPass::RecordFunction &record);
+
   private:
+    // Below this many draws per worker, recording is cheaper than handing the work over.
+    static constexpr size_t MIN_DRAWS_PER_WORKER = 64;
+
     Device &device;
-    Window &window;
+    // Null when headless.
+    Window *window;
+    Swapchain::Settings settings;
     std::unique_ptr<Swapchain> swapchain;
-    std::vector<VkCommandBuffer> commandBuffers;
+    // Replaced swapchains, kept until an image has been acquired from the current one.
+    std::vector<std::unique_ptr<Swapchain>> retiredSwapchains;
+    std::unique_ptr<OffscreenTarget> offscreenTarget;
+    RenderTarget *target;
+    std::unique_ptr<FramePacer> framePacer;
+    std::unique_ptr<GpuProfiler> gpuProfiler;
+    std::unique_ptr<PipelineStatistics> pipelineStatistics;
 
+    std::unique_ptr<ThreadPool> threadPool;
+    std::vector<std::unique_ptr<FrameContext>> frames;
+
+    RenderQueue renderQueue;
+
+    uint64_t swapchainGeneration;
     uint32_t currentImageIndex;
     int currentFrameIndex;
     bool isFrameStarted;
+    // Whether a pass of the current frame has rendered to the target image, which then stays in the color attachment
+    // layout until endFrame().
+    bool isImageRendered;
+    // Stats pass to restore when the swapchain render pass ends.
+    uint32_t previousStatsPass;
+
+    void createFrameContexts();
+
+    void setViewportAndScissor(VkCommandBuffer &command_buffer);
+
+    // Aspects of the target depth format; the stencil aspect is only transitioned, never attached.
+    const VkImageAspectFlags getDepthAspect() const;
 
-    void createCommandBuffers();
+    // Sorts the render queue and writes its instances and indirect commands into this frame's transient buffers.
+    void uploadRenderQueue(VkBuffer &instance_buffer, VkDeviceSize &instance_offset, VkBuffer &indirect_buffer,
+                           VkDeviceSize &indirect_offset);
 
-    void freeCommandBuffers();
+    // Null when headless.
+    VkSwapchainKHR getSwapchainHandle() const;
 
     void recreateSwapchain();
 };
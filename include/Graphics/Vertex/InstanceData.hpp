@@ -0,0 +1,35 @@
+#pragma once
+
+#include "stdafx.hpp"
+
+// Per-instance data, streamed through the second vertex binding.
+struct InstanceData
+{
+    glm::mat4 model;
+
+    inline static VkVertexInputBindingDescription getBindingDescription()
+    {
+        VkVertexInputBindingDescription binding_description{};
+        binding_description.binding = 1;
+        binding_description.stride = sizeof(InstanceData);
+        binding_description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return binding_description;
+    }
+
+    inline static const std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, 4> attribute_descriptions{};
+
+        // A mat4 attribute takes one location per column.
+        for (uint32_t i = 0; i < attribute_descriptions.size(); ++i)
+        {
+            attribute_descriptions[i].binding = 1;
+            attribute_descriptions[i].location = 2 + i;
+            attribute_descriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attribute_descriptions[i].offset = offsetof(InstanceData, model) + sizeof(glm::vec4) * i;
+        }
+
+        return attribute_descriptions;
+    }
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vk_mem_alloc.h>
+
+#include "System/Core/FrameTimeline.hpp"
+#include "System/Memory/Buffer.hpp"
+
+namespace zh
+{
+// Holds GPU resources until the frame that may still use them has completed on the frame timeline, then destroys
+// them in bulk. Resources pushed while a frame is being recorded are tied to that frame; anything pushed between
+// frames is tied to the next one, which is conservative. Safe to push from several threads.
+class DeletionQueue
+{
+  public:
+    DeletionQueue(VkDevice &device, VmaAllocator &allocator, FrameTimeline &timeline);
+
+    DeletionQueue() = delete;
+    DeletionQueue(const DeletionQueue &) = delete;
+    DeletionQueue &operator=(const DeletionQueue &) = delete;
+
+    // The device must be idle.
+    ~DeletionQueue();
+
+    void push(std::unique_ptr<Buffer> buffer);
+
+    void push(VkBuffer buffer, VmaAllocation allocation);
+
+    void push(VkImage image, VmaAllocation allocation);
+
+    void push(VkImageView image_view);
+
+    void push(VkSampler sampler);
+
+    void push(VkFramebuffer framebuffer);
+
+    void push(VkRenderPass render_pass);
+
+    void push(VkPipeline pipeline);
+
+    void push(VkPipelineLayout pipeline_layout);
+
+    void push(VkDescriptorSetLayout descriptor_set_layout);
+
+    // Frees the sets allocated from the pool along with it.
+    void push(VkDescriptorPool descriptor_pool);
+
+    // The pool must have been created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT.
+    void push(VkDescriptorPool descriptor_pool, VkDescriptorSet descriptor_set);
+
+    void push(VkSemaphore semaphore);
+
+    void push(VkSwapchainKHR swapchain);
+
+    // For anything without a dedicated overload.
+    void push(std::function<void()> deleter);
+
+    // Destroys everything whose frame has completed. Called once per frame.
+    void collect();
+
+    // Destroys everything regardless of frame. The device must be idle.
+    void flush();
+
+    const size_t getPendingCount() const;
+
+  private:
+    struct Batch
+    {
+        uint64_t frame;
+        std::vector<std::unique_ptr<Buffer>> ownedBuffers;
+        std::vector<std::pair<VkBuffer, VmaAllocation>> buffers;
+        std::vector<std::pair<VkImage, VmaAllocation>> images;
+        std::vector<VkImageView> imageViews;
+        std::vector<VkSampler> samplers;
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<VkRenderPass> renderPasses;
+        std::vector<VkPipeline> pipelines;
+        std::vector<VkPipelineLayout> pipelineLayouts;
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+        std::vector<VkDescriptorPool> descriptorPools;
+        std::vector<std::pair<VkDescriptorPool, VkDescriptorSet>> descriptorSets;
+        std::vector<VkSemaphore> semaphores;
+        std::vector<VkSwapchainKHR> swapchains;
+        std::vector<std::function<void()>> deleters;
+        size_t size = 0;
+    };
+
+    VkDevice &device;
+    VmaAllocator &allocator;
+    FrameTimeline &timeline;
+
+    mutable std::mutex mutex;
+    std::deque<Batch> batches;
+
+    // Returns the batch for the pending frame. The mutex must be held.
+    Batch &getBatch();
+
+    void destroy(Batch &batch);
+};
+} // namespace zh
@@ -4,7 +4,10 @@
 
 #include "System/Memory/Buffer.hpp"
 #include "System/Memory/StagingBuffer.hpp"
+#include "System/Core/DeletionQueue.hpp"
+#include "System/Core/FrameTimeline.hpp"
 #include "System/Core/Window.hpp"
+#include "System/Rendering/PipelineCache.hpp"
 
 namespace zh
 {
@@ -12,8 +15,15 @@ class Device
 {
   public:
     inline static const std::vector<const char *> VALIDATION_LAYERS = {"VK_LAYER_KHRONOS_validation"};
-    inline static const std::vector<const char *> DEVICE_EXTENSIONS = {VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-                                                                       VK_EXT_MEMORY_BUDGET_EXTENSION_NAME};
+    // Not required by headless devices.
+    inline static const std::vector<const char *> DEVICE_EXTENSIONS = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    // Enabled when available, so the allocator can stay within budget. Software drivers may lack it.
+    inline static const char *MEMORY_BUDGET_EXTENSION = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+    // Enabled together when available, for frame pacing.
+    inline static const std::vector<const char *> PRESENT_WAIT_EXTENSIONS = {VK_KHR_PRESENT_ID_EXTENSION_NAME,
+                                                                             VK_KHR_PRESENT_WAIT_EXTENSION_NAME};
+    // Relative to the working directory, like the assets.
+    inline static const std::string PIPELINE_CACHE_PATH = "pipeline_cache.bin";
 
     struct QueueFamilyIndices
     {
@@ -39,7 +49,9 @@ class Device
 
     Device(Window &window);
 
-    Device() = delete;
+    // Headless: no window, surface or swapchain, so nothing can be presented. Renders into offscreen targets, and
+    // works on drivers without any window system integration.
+    Device();
 
     Device(const Device &) = delete;
 
@@ -62,16 +74,36 @@ class Device
 
     VkQueue &getTransferQueue();
 
-    VkCommandPool &getCommandPool();
-
     VkCommandPool &getTransientCommandPool();
 
+    const VkPhysicalDeviceFeatures &getEnabledFeatures() const;
+
+    const VkPhysicalDeviceVulkan12Features &getEnabledVulkan12Features() const;
+
+    const VkPhysicalDeviceVulkan13Features &getEnabledVulkan13Features() const;
+
+    // True when presents can carry an id and be waited on with vkWaitForPresentKHR.
+    const bool isPresentWaitEnabled() const;
+
+    const bool isMemoryBudgetEnabled() const;
+
+    const bool isHeadless() const;
+
+    FrameTimeline &getFrameTimeline();
+
+    DeletionQueue &getDeletionQueue();
+
+    // Shared by every pipeline created on this device, and saved to PIPELINE_CACHE_PATH when the device is destroyed.
+    PipelineCache &getPipelineCache();
+
     const bool checkValidationLayerSupport();
 
     std::vector<const char *> getRequiredExtensions();
 
+    // Headless devices present nowhere; their present family is the graphics family.
     const QueueFamilyIndices findQueueFamilies(VkPhysicalDevice &physical_device);
 
+    // Empty when headless.
     const SwapchainSupportDetails querySwapchainSupport(VkPhysicalDevice &physical_device) const;
 
     VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling,
@@ -82,21 +114,30 @@ class Device
     std::vector<char *>          validationLayers;
     std::vector<char *>          deviceExtensions;
 
-    Window                       &window;
+    // Null when headless.
+    Window                       *window;
 
     VkInstance                   instance;
     VkDebugUtilsMessengerEXT     debugMessenger;
 
     VkPhysicalDevice             physicalDevice;
     VkDevice                     device;
+    VkPhysicalDeviceFeatures     enabledFeatures;
+    VkPhysicalDeviceVulkan12Features enabledVulkan12Features;
+    VkPhysicalDeviceVulkan13Features enabledVulkan13Features;
+    bool                         presentWaitEnabled;
+    bool                         memoryBudgetEnabled;
 
     VmaAllocator                 allocator;
 
     VkQueue                      graphicsQueue;
     VkQueue                      presentQueue;
 
-    VkCommandPool                commandPool;
     VkCommandPool                transientCommandPool;
+
+    std::unique_ptr<FrameTimeline> frameTimeline;
+    std::unique_ptr<DeletionQueue> deletionQueue;
+    std::unique_ptr<PipelineCache> pipelineCache;
     std::vector<VkCommandBuffer> commandBuffers;
 
     VkBuffer                     vertexBuffer;
@@ -112,6 +153,8 @@ class Device
     std::vector<VkDescriptorSet> descriptorSets;
     // clang-format on
 
+    void init();
+
     void nullifyHandles();
 
     void initVulkanInstance();
@@ -126,7 +169,7 @@ class Device
 
     void initMemoryAllocator();
 
-    void createCommandPools();
+    void createTransientCommandPool();
 
     // void createUniformBuffers(VkDeviceSize buffer_size);
 
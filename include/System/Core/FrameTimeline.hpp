@@ -0,0 +1,42 @@
+#pragma once
+
+namespace zh
+{
+// Timeline semaphore counting frames. Submitting frame N signals the value N, so "frame N is complete" is a plain
+// counter comparison any subsystem can query or wait on without fences of its own. Frames are numbered from 1.
+class FrameTimeline
+{
+  public:
+    FrameTimeline(VkDevice &device);
+
+    FrameTimeline() = delete;
+    FrameTimeline(const FrameTimeline &) = delete;
+    FrameTimeline &operator=(const FrameTimeline &) = delete;
+
+    ~FrameTimeline();
+
+    VkSemaphore &getSemaphore();
+
+    // The frame the next submission will signal.
+    const uint64_t getPendingFrame() const;
+
+    // The last frame handed to the queue.
+    const uint64_t getSubmittedFrame() const;
+
+    // The last frame the GPU finished.
+    const uint64_t getCompletedFrame() const;
+
+    const bool isComplete(const uint64_t frame) const;
+
+    // Returns false on timeout.
+    const bool wait(const uint64_t frame, const uint64_t timeout = std::numeric_limits<uint64_t>::max()) const;
+
+    // Must be called right after the submission signaling frame.
+    void markSubmitted(const uint64_t frame);
+
+  private:
+    VkDevice &device;
+    VkSemaphore semaphore;
+    std::atomic<uint64_t> submittedFrame;
+};
+} // namespace zh
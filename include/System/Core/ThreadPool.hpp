@@ -0,0 +1,40 @@
+#pragma once
+
+namespace zh
+{
+// Fixed set of worker threads consuming a shared task queue.
+class ThreadPool
+{
+  public:
+    ThreadPool(const uint32_t thread_count = std::max(1u, std::thread::hardware_concurrency()));
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool();
+
+    void submit(std::function<void()> task);
+
+    // Splits [0, count) into contiguous ranges of at least min_range items, runs them on the workers and waits for
+    // all of them. Must not be called from a worker thread.
+    void parallelFor(const uint32_t count, const std::function<void(uint32_t begin, uint32_t end)> &task,
+                     const uint32_t min_range = 1);
+
+    // Blocks until every submitted task has finished.
+    void wait();
+
+    const uint32_t getThreadCount() const;
+
+  private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable tasksFinished;
+    uint32_t pendingTasks;
+    bool isStopping;
+
+    void work();
+};
+} // namespace zh
@@ -4,12 +4,20 @@
 
 namespace zh
 {
+class Device;
+class DeletionQueue;
+
 class Buffer
 {
   public:
+    // Destroyed immediately; for buffers the GPU is done with by the time they go away, e.g. staging buffers.
     Buffer(VmaAllocator &allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
            VmaMemoryUsage memory_usage, VmaAllocationCreateFlags allocation_flags);
 
+    // Destroyed through the device deletion queue, so frames in flight may still use the buffer after it goes away.
+    Buffer(Device &device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+           VmaMemoryUsage memory_usage, VmaAllocationCreateFlags allocation_flags);
+
     ~Buffer();
 
     // No default constructor, not copyable or movable.
@@ -25,15 +33,19 @@ class Buffer
 
     const bool isMappable() const;
 
+    // True when the destructor hands the buffer to a deletion queue instead of destroying it.
+    const bool isDeferred() const;
+
     void map();
 
     void map(void *&mmem);
 
-    void write(void *data, const size_t size);
+    void write(void *data, const size_t size, const size_t offset = 0);
 
     void unmap();
 
-    static void copy(VkDevice &device, VkCommandPool &command_pool, VkQueue &queue, Buffer &src, Buffer &dst);
+    static void copy(VkDevice &device, VkCommandPool &command_pool, VkQueue &queue, Buffer &src, Buffer &dst,
+                     const VkDeviceSize dst_offset = 0);
 
   protected:
     VmaAllocator &allocator;
@@ -47,6 +59,8 @@ class Buffer
 
     void *mmem;
 
+    DeletionQueue *deletionQueue;
+
     void create(VmaAllocator &allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
                 VmaMemoryUsage memory_usage, VmaAllocationCreateFlags allocation_flags, VkBuffer &buffer,
                 VmaAllocation &buffer_memory);
@@ -0,0 +1,151 @@
+#pragma once
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define ZH_PROFILE_USE_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ZH_PROFILE_USE_TSC
+#endif
+
+// Zone names must outlive the profiler, so pass string literals. Without AZHA_ENABLE_PROFILING the macros expand to
+// nothing and the profiler is never referenced.
+#ifdef AZHA_ENABLE_PROFILING
+#define ZH_PROFILE_CONCAT_INNER(a, b) a##b
+#define ZH_PROFILE_CONCAT(a, b) ZH_PROFILE_CONCAT_INNER(a, b)
+#define ZH_PROFILE_SCOPE(name) const zh::CpuProfiler::Zone ZH_PROFILE_CONCAT(zh_profile_zone_, __LINE__)(name)
+#define ZH_PROFILE_THREAD(name) zh::CpuProfiler::setThreadName(name)
+#else
+#define ZH_PROFILE_SCOPE(name) ((void)0)
+#define ZH_PROFILE_THREAD(name) ((void)0)
+#endif
+
+namespace zh
+{
+// Records CPU zones into a ring buffer owned by the recording thread. Only that thread writes to it, so recording a
+// zone takes two clock reads and a few stores, with no locks or read-modify-write atomics. The oldest events of a
+// thread are overwritten once its buffer is full.
+class CpuProfiler
+{
+  public:
+    // In ticks of now().
+    struct Event
+    {
+        const char *name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    class Zone
+    {
+      public:
+        Zone(const char *name) : name(name), start(now())
+        {
+        }
+
+        ~Zone()
+        {
+            record(name, start, now());
+        }
+
+        Zone() = delete;
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+
+      private:
+        const char *name;
+        uint64_t start;
+    };
+
+    CpuProfiler() = delete;
+
+    static void setEnabled(const bool enabled);
+
+    static const bool isEnabled();
+
+    // Shown as the thread's name in traces.
+    static void setThreadName(const std::string &name);
+
+    // Writes the events still held by every thread's buffer as Chrome trace JSON, loadable in chrome://tracing or
+    // Perfetto. Threads may keep recording meanwhile; events overwritten during the export are left out.
+    static void writeChromeTrace(const std::string &path);
+
+    // Drops every recorded event.
+    static void clear();
+
+    // The time stamp counter on x86, which reads faster than the steady clock, and steady clock
+    // nanoseconds elsewhere. Ticks are converted to time when exported.
+    static uint64_t now()
+    {
+#ifdef ZH_PROFILE_USE_TSC
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    static void record(const char *name, const uint64_t start, const uint64_t end)
+    {
+        if (!enabled.load(std::memory_order_relaxed))
+            return;
+
+        ThreadBuffer *buffer = threadBuffer != nullptr ? threadBuffer : registerThread();
+
+        const uint64_t index = buffer->writeIndex.load(std::memory_order_relaxed);
+        Slot &slot = buffer->slots[index & (BUFFER_CAPACITY - 1)];
+        slot.name.store(name, std::memory_order_release);
+        slot.start.store(start, std::memory_order_release);
+        slot.end.store(end, std::memory_order_release);
+        buffer->writeIndex.store(index + 1, std::memory_order_release);
+    }
+
+  private:
+    // Must be a power of two.
+    static constexpr uint64_t BUFFER_CAPACITY = 1 << 14;
+
+    // An event whose fields the export may read while the owning thread overwrites them. A field read from a newer
+    // write also makes the index stored before that write visible, which is how the export detects the overwrite.
+    // Release stores and acquire loads are plain moves on x86.
+    struct Slot
+    {
+        std::atomic<const char *> name{nullptr};
+        std::atomic<uint64_t> start{0};
+        std::atomic<uint64_t> end{0};
+    };
+
+    struct ThreadBuffer
+    {
+        std::array<Slot, BUFFER_CAPACITY> slots;
+        std::atomic<uint64_t> writeIndex{0};
+
+        // Events before it were cleared.
+        std::atomic<uint64_t> clearIndex{0};
+
+        uint32_t id = 0;
+        std::string name;
+    };
+
+    struct Calibration
+    {
+        uint64_t ticks;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    inline static std::atomic<bool> enabled{true};
+    inline static const Calibration calibration{now(), std::chrono::steady_clock::now()};
+    inline static thread_local ThreadBuffer *threadBuffer = nullptr;
+
+    // Buffers outlive their threads, so events of finished threads can still be exported.
+    inline static std::mutex mutex;
+    inline static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    static ThreadBuffer *registerThread();
+
+    // Measured against the steady clock since startup.
+    static const double getNanosecondsPerTick();
+
+    static const std::string escape(const std::string &text);
+};
+} // namespace zh
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "System/Core/Device.hpp"
+
+namespace zh
+{
+// One query pool per frame slot, shared by the GPU profiler, the pipeline statistics and the frame pacer. A slot is
+// reset at the start of its frame and read back when the slot comes around again, once the frame that recorded it
+// has completed, so reading never waits on the GPU.
+class FrameQueryPools
+{
+  public:
+    // Timestamp support of the graphics queue. mask is zero when it has none.
+    struct TimestampProperties
+    {
+        double period = 0.0;
+        uint64_t mask = 0;
+    };
+
+    // Creates frame_count pools from pool_info. what names the pools in the error thrown when one cannot be created.
+    FrameQueryPools(Device &device, const uint32_t frame_count, const VkQueryPoolCreateInfo &pool_info,
+                    const std::string &what);
+
+    FrameQueryPools() = delete;
+    FrameQueryPools(const FrameQueryPools &) = delete;
+    FrameQueryPools &operator=(const FrameQueryPools &) = delete;
+
+    ~FrameQueryPools();
+
+    VkQueryPool getPool(const int frame_index) const;
+
+    const uint32_t getQueryCount() const;
+
+    // Resets every query of the slot. Must be recorded outside rendering.
+    void reset(VkCommandBuffer &command_buffer, const int frame_index);
+
+    // Reads the 64 bit results of the first query_count queries of the slot, stride bytes apart. Returns false rather
+    // than waiting when any of them is not available.
+    const bool readResults(const int frame_index, const uint32_t query_count, const size_t stride,
+                           uint64_t *results) const;
+
+    static const TimestampProperties getTimestampProperties(Device &device);
+
+  private:
+    Device &device;
+    uint32_t queryCount;
+    std::vector<VkQueryPool> pools;
+};
+} // namespace zh
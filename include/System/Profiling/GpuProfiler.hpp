@@ -0,0 +1,110 @@
+#pragma once
+
+#include "System/Core/Device.hpp"
+#include "System/Profiling/FrameQueryPools.hpp"
+
+namespace zh
+{
+// Measures GPU time of scopes recorded into the frame's primary command buffer with timestamp queries. Every frame
+// slot has its own query pool, read back when the slot comes around again, so results lag frame_count frames behind
+// and reading them never waits on the GPU. Scopes with the same name are summed within a frame.
+class GpuProfiler
+{
+  public:
+    // In milliseconds.
+    struct Timing
+    {
+        std::string name;
+        double lastTime = 0.0;
+        double averageTime = 0.0;
+        double minTime = std::numeric_limits<double>::max();
+        double maxTime = 0.0;
+        uint64_t sampleCount = 0;
+    };
+
+    // Ends the scope when it goes out of scope.
+    class Scope
+    {
+      public:
+        Scope(GpuProfiler &profiler, VkCommandBuffer &command_buffer, const std::string &name);
+
+        ~Scope();
+
+        Scope() = delete;
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        GpuProfiler &profiler;
+        VkCommandBuffer &commandBuffer;
+    };
+
+    GpuProfiler(Device &device, const uint32_t frame_count, const uint32_t max_scopes = 256);
+
+    GpuProfiler() = delete;
+    GpuProfiler(const GpuProfiler &) = delete;
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+    ~GpuProfiler();
+
+    // Reads back what the slot recorded last time and resets its queries. Must be called at the start of the frame's
+    // command buffer, once the frame that last used the slot has completed, and outside rendering.
+    void beginFrame(VkCommandBuffer &command_buffer, const int frame_index);
+
+    // Scopes nest. Scopes past max_scopes in a frame are dropped.
+    void beginScope(VkCommandBuffer &command_buffer, const std::string &name);
+
+    void endScope(VkCommandBuffer &command_buffer);
+
+    // False when the graphics queue has no timestamp support; every call is then a no-op.
+    const bool isSupported() const;
+
+    // In the order the scopes were first seen.
+    const std::vector<Timing> &getTimings() const;
+
+    // Returns nullptr if no scope with that name was read back yet.
+    const Timing *getTiming(const std::string &name) const;
+
+    void printTimings(std::ostream &stream = std::cout) const;
+
+    void writeCsv(const std::string &path) const;
+
+    void resetTimings();
+
+  private:
+    static constexpr double SMOOTHING = 0.1;
+
+    struct ScopeRecord
+    {
+        std::string name;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+
+    struct FrameQueries
+    {
+        std::vector<ScopeRecord> scopes;
+        uint32_t queryCount = 0;
+        bool isRecorded = false;
+    };
+
+    Device &device;
+    uint32_t maxScopes;
+
+    double timestampPeriod;
+    uint64_t timestampMask;
+
+    // Null when timestamps are unsupported.
+    std::unique_ptr<FrameQueryPools> queryPools;
+    std::vector<FrameQueries> frames;
+    int currentFrame;
+    std::vector<size_t> openScopes;
+
+    std::vector<Timing> timings;
+    std::unordered_map<std::string, size_t> timingIndices;
+
+    void createQueryPools(const uint32_t frame_count);
+
+    void readResults(const int frame_index);
+};
+} // namespace zh
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "System/Core/Device.hpp"
+#include "System/Profiling/FrameQueryPools.hpp"
+
+namespace zh
+{
+// Counts what the GPU did in scopes of the frame's primary command buffer with pipeline statistics and occlusion
+// queries: vertices and primitives assembled, shader invocations, primitives left after clipping and samples that
+// passed the depth test. Fragment invocations against passed samples and screen size give overdraw; clipped against
+// assembled primitives shows what culling let through. Like GpuProfiler, every frame slot has its own query pools,
+// read back when the slot comes around again, so reading never waits on the GPU. Disabled by default.
+class PipelineStatistics
+{
+  public:
+    struct Counts
+    {
+        uint64_t inputVertices;
+        uint64_t inputPrimitives;
+        uint64_t vertexInvocations;
+        uint64_t clippingInvocations;
+        uint64_t clippingPrimitives;
+        uint64_t fragmentInvocations;
+        uint64_t computeInvocations;
+
+        // Exact when the device has precise occlusion queries, otherwise only zero or non zero is meaningful.
+        uint64_t samplesPassed;
+    };
+
+    struct Statistics
+    {
+        std::string name;
+        Counts last;
+
+        // Summed over every frame read back, divide by sampleCount for averages.
+        Counts total;
+        uint64_t sampleCount;
+    };
+
+    // Ends the scope when it goes out of scope.
+    class Scope
+    {
+      public:
+        Scope(PipelineStatistics &statistics, VkCommandBuffer &command_buffer, const std::string &name);
+
+        ~Scope();
+
+        Scope() = delete;
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        PipelineStatistics &statistics;
+        VkCommandBuffer &commandBuffer;
+    };
+
+    PipelineStatistics(Device &device, const uint32_t frame_count, const uint32_t max_scopes = 64);
+
+    PipelineStatistics() = delete;
+    PipelineStatistics(const PipelineStatistics &) = delete;
+    PipelineStatistics &operator=(const PipelineStatistics &) = delete;
+
+    ~PipelineStatistics();
+
+    // Takes effect at the next beginFrame().
+    void setEnabled(const bool enabled);
+
+    const bool isEnabled() const;
+
+    // Reads back what the slot recorded last time and, when enabled, resets its queries. Must be called at the start
+    // of the frame's command buffer, once the frame that last used the slot has completed, and outside rendering.
+    void beginFrame(VkCommandBuffer &command_buffer, const int frame_index);
+
+    // Queries of one type cannot be active twice, so scopes do not nest: a scope begun inside another, or past
+    // max_scopes in a frame, is dropped. Scopes must begin and end outside rendering, and only count commands of
+    // the primary command buffer, not of secondary ones it executes.
+    void beginScope(VkCommandBuffer &command_buffer, const std::string &name);
+
+    void endScope(VkCommandBuffer &command_buffer);
+
+    // False when the device has no pipeline statistics queries; every call is then a no-op.
+    const bool isSupported() const;
+
+    // In the order the scopes were first seen.
+    const std::vector<Statistics> &getStatistics() const;
+
+    // Returns nullptr if no scope with that name was read back yet.
+    const Statistics *getStatistics(const std::string &name) const;
+
+    void printStatistics(std::ostream &stream = std::cout) const;
+
+    void resetStatistics();
+
+  private:
+    static constexpr uint32_t COUNTER_COUNT = 7;
+
+    struct FrameQueries
+    {
+        std::vector<std::string> scopes;
+        bool isRecorded = false;
+    };
+
+    Device &device;
+    uint32_t maxScopes;
+    bool supported;
+    bool enabled;
+
+    // Null when unsupported.
+    std::unique_ptr<FrameQueryPools> statisticsPools;
+    std::unique_ptr<FrameQueryPools> occlusionPools;
+    std::vector<FrameQueries> frames;
+    int currentFrame;
+
+    // Index of the open scope, SIZE_MAX for dropped scopes.
+    std::vector<size_t> openScopes;
+
+    std::vector<Statistics> statistics;
+    std::unordered_map<std::string, size_t> statisticsIndices;
+
+    void createQueryPools(const uint32_t frame_count);
+
+    void readResults(const int frame_index);
+};
+} // namespace zh
@@ -0,0 +1,126 @@
+#pragma once
+
+// Counter names are RenderStats::Counter values, e.g. ZH_STAT_ADD(Triangles, count). Passes spanning several calls
+// keep what ZH_STAT_BEGIN_PASS returns and hand it to ZH_STAT_END_PASS. Without AZHA_ENABLE_RENDER_STATS the macros
+// expand to nothing, ZH_STAT_BEGIN_PASS to zero, and the counters are never referenced.
+#ifdef AZHA_ENABLE_RENDER_STATS
+#define ZH_STAT_ADD(counter, value) zh::RenderStats::add(zh::RenderStats::Counter::counter, value)
+#define ZH_STAT_INCREMENT(counter) zh::RenderStats::add(zh::RenderStats::Counter::counter, 1)
+#define ZH_STAT_PASS_CONCAT_INNER(a, b) a##b
+#define ZH_STAT_PASS_CONCAT(a, b) ZH_STAT_PASS_CONCAT_INNER(a, b)
+#define ZH_STAT_PASS(name) const zh::RenderStats::PassScope ZH_STAT_PASS_CONCAT(zh_stat_pass_, __LINE__)(name)
+#define ZH_STAT_BEGIN_PASS(name) zh::RenderStats::beginPass(name)
+#define ZH_STAT_END_PASS(previous) zh::RenderStats::endPass(previous)
+#define ZH_STAT_END_FRAME(frame) zh::RenderStats::endFrame(frame)
+#else
+#define ZH_STAT_ADD(counter, value) ((void)0)
+#define ZH_STAT_INCREMENT(counter) ((void)0)
+#define ZH_STAT_PASS(name) ((void)0)
+#define ZH_STAT_BEGIN_PASS(name) uint32_t(0)
+#define ZH_STAT_END_PASS(previous) ((void)0)
+#define ZH_STAT_END_FRAME(frame) ((void)0)
+#endif
+
+namespace zh
+{
+// Counts what the frames recorded: draws, binds, barriers, uploads and allocations, in total and per pass. Counters
+// are relaxed atomics so worker threads recording secondary command buffers can add to them. Passes are begun and
+// ended on the thread driving the frame; anything counted meanwhile, on any thread, goes to the pass.
+class RenderStats
+{
+  public:
+    enum class Counter : uint32_t
+    {
+        DrawCalls,
+        Instances,
+        Triangles,
+        PipelineBinds,
+        DescriptorBinds,
+        BufferBinds,
+        BytesUploaded,
+        Allocations,
+        Barriers,
+        Count,
+    };
+
+    static constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+
+    using Counters = std::array<uint64_t, COUNTER_COUNT>;
+
+    struct PassStats
+    {
+        std::string name;
+        Counters counters{};
+    };
+
+    struct FrameStats
+    {
+        uint64_t frame;
+
+        // Including what was counted outside of any pass, e.g. uploads between frames.
+        Counters total;
+        std::vector<PassStats> passes;
+    };
+
+    // Attributes counts to a pass until it goes out of scope, then restores the enclosing pass.
+    class PassScope
+    {
+      public:
+        PassScope(const std::string &name) : previous(beginPass(name))
+        {
+        }
+
+        ~PassScope()
+        {
+            endPass(previous);
+        }
+
+        PassScope() = delete;
+        PassScope(const PassScope &) = delete;
+        PassScope &operator=(const PassScope &) = delete;
+
+      private:
+        uint32_t previous;
+    };
+
+    RenderStats() = delete;
+
+    static void add(const Counter counter, const uint64_t value)
+    {
+        const uint32_t pass = currentPass.load(std::memory_order_relaxed);
+        counters[pass][static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Passes of the same name within a frame are summed. Returns the pass to restore with endPass().
+    static const uint32_t beginPass(const std::string &name);
+
+    static void endPass(const uint32_t previous);
+
+    // Closes the frame: its counts become the last frame's stats, and are logged if the log interval is due.
+    static void endFrame(const uint64_t frame);
+
+    static const FrameStats &getLastFrame();
+
+    static const uint64_t getLastFrame(const Counter counter);
+
+    // Prints the last frame's stats every interval frames. Zero, the default, disables logging.
+    static void setLogInterval(const uint32_t interval);
+
+    static void print(const FrameStats &stats, std::ostream &stream = std::cout);
+
+    static const char *getCounterName(const Counter counter);
+
+  private:
+    // Passes beyond this many per frame are counted as the last one.
+    static constexpr uint32_t MAX_PASSES = 63;
+
+    // Slot zero holds what is counted outside of any pass.
+    inline static std::array<std::array<std::atomic<uint64_t>, COUNTER_COUNT>, MAX_PASSES + 1> counters{};
+    inline static std::atomic<uint32_t> currentPass{0};
+
+    // Only touched by the thread driving the frame.
+    inline static std::vector<std::string> passNames;
+    inline static FrameStats lastFrame{};
+    inline static uint32_t logInterval = 0;
+};
+} // namespace zh
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "System/Core/Device.hpp"
+
+namespace zh
+{
+class ComputePipeline
+{
+  public:
+    ComputePipeline(Device &device, const std::string &compute_shader_path,
+                    const std::vector<VkDescriptorSetLayout> &descriptor_set_layouts,
+                    const uint32_t push_constant_size = 0);
+
+    ComputePipeline() = delete;
+
+    ComputePipeline(const ComputePipeline &) = delete;
+
+    ComputePipeline operator=(const ComputePipeline &) = delete;
+
+    ~ComputePipeline();
+
+    void bind(VkCommandBuffer &command_buffer);
+
+    VkPipeline &getHandle();
+
+    VkPipelineLayout &getLayout();
+
+  private:
+    Device &device;
+
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+
+    void createPipeline(const std::string &compute_shader_path,
+                        const std::vector<VkDescriptorSetLayout> &descriptor_set_layouts,
+                        const uint32_t push_constant_size);
+};
+} // namespace zh
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "System/Core/Device.hpp"
+#include "System/Profiling/FrameQueryPools.hpp"
+
+namespace zh
+{
+// Decides which present mode the swapchain asks for and when the CPU may start a frame. GPU time is measured with
+// timestamps at the start and end of every frame's command buffer; presentation is tracked with present wait when
+// the device supports it, and with the frame timeline otherwise.
+class FramePacer
+{
+  public:
+    enum class Policy
+    {
+        // Renders as fast as possible without tearing. Prefers mailbox, falls back to FIFO.
+        Throughput,
+        // Keeps at most one frame queued for presentation and starts each frame as late as the measured CPU and GPU
+        // times allow, so input is sampled close to when the GPU picks the frame up. Prefers mailbox, never tears.
+        LowLatency,
+        // FIFO presentation, and a frame only starts once the previous one reached the display.
+        PowerSaver
+    };
+
+    // Timings of one frame, in milliseconds.
+    struct FrameTimings
+    {
+        uint64_t frame = 0;
+
+        // How long the pacer held the frame back before it started.
+        double pacingDelay = 0.0;
+
+        // From the frame start to its submission.
+        double cpuTime = 0.0;
+
+        // Between the timestamps at the start and end of the command buffer. Zero when timestamps are unsupported.
+        double gpuTime = 0.0;
+
+        // From the frame start until it was seen presented, or completed on the GPU when isPresented is false. It is
+        // polled when later frames start, so it is an upper bound.
+        double latency = 0.0;
+        bool isPresented = false;
+    };
+
+    FramePacer(Device &device, const Policy policy, const uint32_t frame_count);
+
+    FramePacer() = delete;
+    FramePacer(const FramePacer &) = delete;
+    FramePacer &operator=(const FramePacer &) = delete;
+
+    ~FramePacer();
+
+    static VkPresentModeKHR choosePresentMode(const Policy policy,
+                                              const std::vector<VkPresentModeKHR> &available_modes);
+
+    // Blocks until the pending frame may start according to the policy. swapchain is the one the previous frames
+    // were presented to. Must be called before the swapchain image is acquired.
+    void waitForFrameStart(VkSwapchainKHR swapchain);
+
+    // Writes the starting timestamp. Must be called first in the frame's command buffer.
+    void beginFrame(VkCommandBuffer &command_buffer, const int frame_index);
+
+    // Writes the ending timestamp. Must be called last in the frame's command buffer.
+    void endFrame(VkCommandBuffer &command_buffer, const int frame_index);
+
+    // Must be called right after the frame was submitted and presented to swapchain.
+    void markSubmitted(VkSwapchainKHR swapchain);
+
+    const Policy getPolicy() const;
+
+    // Smoothed over the last frames.
+    const double getAverageCpuTime() const;
+
+    const double getAverageGpuTime() const;
+
+    // Frames whose latency is known, oldest first.
+    const std::deque<FrameTimings> &getTimings() const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t HISTORY_SIZE = 128;
+    static constexpr double SMOOTHING = 0.1;
+
+    // Never wait on presentation longer than this, so a hidden or minimized window cannot stall the frame loop.
+    static constexpr uint64_t PRESENT_WAIT_TIMEOUT = 100'000'000;
+
+    // Margin kept between the predicted end of GPU work and the arrival of the next frame, in milliseconds.
+    static constexpr double LOW_LATENCY_MARGIN = 0.5;
+
+    struct PendingFrame
+    {
+        FrameTimings timings;
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+        Clock::time_point start;
+        Clock::time_point submission;
+        int frameIndex = 0;
+        bool isTimed = false;
+        bool hasGpuTime = false;
+    };
+
+    Device &device;
+    Policy policy;
+    uint32_t frameCount;
+
+    // Null when timestamps are unsupported.
+    std::unique_ptr<FrameQueryPools> queryPools;
+    double timestampPeriod;
+    uint64_t timestampMask;
+
+    PFN_vkWaitForPresentKHR waitForPresent;
+
+    PendingFrame current;
+    std::deque<PendingFrame> pending;
+    std::deque<FrameTimings> history;
+
+    double averageCpuTime;
+    double averageGpuTime;
+
+    void createQueryPool();
+
+    // Resolves the GPU time and latency of every pending frame that has completed or been presented.
+    void collect(VkSwapchainKHR swapchain);
+
+    // Waits until frame was presented to swapchain, or completed when presentation cannot be observed.
+    void waitForPresentation(const uint64_t frame, VkSwapchainKHR swapchain);
+
+    void readGpuTime(PendingFrame &pending_frame);
+
+    static const double elapsed(const Clock::time_point &from, const Clock::time_point &to);
+};
+} // namespace zh
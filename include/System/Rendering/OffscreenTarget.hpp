@@ -0,0 +1,102 @@
+#pragma once
+
+#include "System/Core/Device.hpp"
+#include "System/Rendering/RenderTarget.hpp"
+
+namespace zh
+{
+// Render target made of plain device images, for rendering without a window or surface. Images are handed out in
+// turn; after a frame the color image is left in the transfer source layout, ready to be read back or copied.
+class OffscreenTarget : public RenderTarget
+{
+  public:
+    struct Settings
+    {
+        VkExtent2D extent = {1280, 720};
+        VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+
+        // Frames the CPU may record ahead of the GPU.
+        uint32_t framesInFlight = 2;
+
+        // Zero uses one image per frame in flight.
+        uint32_t imageCount = 0;
+    };
+
+    OffscreenTarget(Device &device);
+
+    OffscreenTarget(Device &device, const Settings &settings);
+
+    ~OffscreenTarget() override;
+
+    OffscreenTarget() = delete;
+    OffscreenTarget(const OffscreenTarget &) = delete;
+    OffscreenTarget &operator=(const OffscreenTarget &) = delete;
+
+    VkResult acquireNextImage(uint32_t *image_index) override;
+
+    // Submits the frame pending on the device frame timeline. Nothing is presented.
+    VkResult submitCommandBuffers(const VkCommandBuffer &buffers, uint32_t &image_index) override;
+
+    const int getFrameIndex() const override;
+
+    const uint32_t getFramesInFlight() const override;
+
+    const VkImageLayout getFinalLayout() const override;
+
+    VkExtent2D &getExtent() override;
+
+    const VkFormat &getDepthFormat() const override;
+
+    const VkFormat &getImageFormat() const override;
+
+    const float getAspectRatio() const override;
+
+    const size_t getImageCount() const override;
+
+    VkImage &getImage(const int index) override;
+
+    VkImageView &getImageView(const int index) override;
+
+    VkImage &getDepthImage(const int index) override;
+
+    VkImageView &getDepthImageView(const int index) override;
+
+    const std::vector<VkImageView> &getDepthImageViews() const override;
+
+    const Settings &getSettings() const;
+
+    // Image the last submitted frame rendered to.
+    const uint32_t getLastImageIndex() const;
+
+    // Waits for the last frame that rendered to the image and copies its pixels, tightly packed rows of the image
+    // format, into pixels.
+    void readPixels(const uint32_t image_index, std::vector<uint8_t> &pixels);
+
+  private:
+    Device &device;
+    Settings settings;
+
+    VkFormat depthFormat;
+
+    std::vector<VkImage> images;
+    std::vector<VmaAllocation> imagesMemory;
+    std::vector<VkImageView> imageViews;
+
+    std::vector<VkImage> depthImages;
+    std::vector<VmaAllocation> depthImagesMemory;
+    std::vector<VkImageView> depthImageViews;
+
+    // Frame that last rendered to each image.
+    std::vector<uint64_t> imageFrames;
+    uint32_t nextImage;
+    uint32_t lastImage;
+
+    void createImages();
+
+    void createDepthResources();
+
+    VkImageView createImageView(VkImage image, const VkFormat format, const VkImageAspectFlags aspect);
+
+    static const uint32_t getFormatSize(const VkFormat format);
+};
+} // namespace zh
@@ -1,16 +1,19 @@
 #pragma once
 
 #include "Graphics/Vertex/Vertex.hpp"
+#include "Graphics/Vertex/InstanceData.hpp"
 #include "Graphics/Uniform/UniformBufferObject.hpp"
-#include "System/Rendering/Swapchain.hpp"
+#include "System/Rendering/RenderTarget.hpp"
 
 namespace zh
 {
 class Pipeline
 {
   public:
-    Pipeline(Device &device, Swapchain &swapchain, const std::string &vertex_shader_path,
-             const std::string &fragment_shader_path);
+    // Renders to attachments of the target's color and depth formats.
+    Pipeline(Device &device, RenderTarget &target, const std::string &vertex_shader_path,
+             const std::string &fragment_shader_path,
+             const std::vector<VkDescriptorSetLayout> &descriptor_set_layouts = {});
 
     Pipeline() = delete;
 
@@ -20,18 +23,33 @@ class Pipeline
 
     ~Pipeline();
 
+    void bind(VkCommandBuffer &command_buffer);
+
+    VkPipeline &getHandle();
+
+    VkPipelineLayout &getLayout();
+
+    const uint32_t getId() const;
+
+    // Changes whenever any pipeline is created or destroyed, so recorded commands can tell they may be stale.
+    static const uint64_t getGeneration();
+
+    static const std::vector<uint8_t> readFile(const std::string &path);
+
+    static VkShaderModule createShaderModule(Device &device, std::vector<uint8_t> &code);
+
   private:
+    inline static uint32_t idCounter = 0;
+    inline static uint64_t generation = 0;
+
     Device &device;
-    Swapchain &swapchain;
+    RenderTarget &target;
+    uint32_t id;
 
-    VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout;
     VkPipeline pipeline;
 
-    void createPipeline(const std::string &vertex_shader_path, const std::string &fragment_shader_path);
-
-    const std::vector<uint8_t> readFile(const std::string &path);
-
-    VkShaderModule createShaderModule(std::vector<uint8_t> &code);
+    void createPipeline(const std::string &vertex_shader_path, const std::string &fragment_shader_path,
+                        const std::vector<VkDescriptorSetLayout> &descriptor_set_layouts);
 };
 } // namespace zh
@@ -0,0 +1,58 @@
+#pragma once
+
+namespace zh
+{
+// Device wide VkPipelineCache persisted between runs, so pipelines compiled by the driver once are not compiled again
+// at the next startup. The file is only used when its header matches this vendor, device and driver build, and its
+// checksum matches its data; anything else is discarded and the cache starts out empty. Saving merges in what
+// another process may have written since the load, and replaces the file atomically, so a crash mid write leaves the
+// previous file intact.
+class PipelineCache
+{
+  public:
+    PipelineCache(VkDevice &device, VkPhysicalDevice &physical_device, const std::string &path);
+
+    PipelineCache() = delete;
+    PipelineCache(const PipelineCache &) = delete;
+    PipelineCache &operator=(const PipelineCache &) = delete;
+
+    // Saves the cache before destroying it.
+    ~PipelineCache();
+
+    VkPipelineCache &getHandle();
+
+    // Returns false if the file could not be written; the cache itself is left untouched.
+    const bool save();
+
+    // True when the file was valid and its data was loaded.
+    const bool isLoaded() const;
+
+    const std::string &getPath() const;
+
+  private:
+    // Precedes the driver's data in the file: Vulkan's own header carries no driver version and nothing to detect a
+    // truncated or corrupted file with, which some drivers do not check for.
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t driverVersion;
+        uint64_t dataSize;
+        uint64_t checksum;
+    };
+
+    static constexpr uint32_t MAGIC = 0x5A485043; // "ZHPC"
+
+    VkDevice &device;
+    VkPhysicalDeviceProperties properties;
+    std::string path;
+    VkPipelineCache cache;
+    bool loaded;
+
+    // Empty if the file is missing or invalid.
+    const std::vector<uint8_t> readData() const;
+
+    const bool isCompatible(const std::vector<uint8_t> &data) const;
+
+    static const uint64_t computeChecksum(const uint8_t *data, const size_t size);
+};
+} // namespace zh
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "System/Core/Device.hpp"
+
+namespace zh
+{
+// Color and depth images the renderer draws frames into, one pair per image, with the frame slots used to record
+// them. Implemented by the swapchain, and by offscreen targets for headless rendering.
+class RenderTarget
+{
+  public:
+    virtual ~RenderTarget() = default;
+
+    // Waits until the frame that last used this frame slot is complete, then picks the image to render to.
+    virtual VkResult acquireNextImage(uint32_t *image_index) = 0;
+
+    // Submits the frame pending on the device frame timeline, and presents it if the target is presentable.
+    virtual VkResult submitCommandBuffers(const VkCommandBuffer &buffers, uint32_t &image_index) = 0;
+
+    // Frame slot of the pending frame, in [0, getFramesInFlight()).
+    virtual const int getFrameIndex() const = 0;
+
+    virtual const uint32_t getFramesInFlight() const = 0;
+
+    // Layout color images must be in when a frame is submitted.
+    virtual const VkImageLayout getFinalLayout() const = 0;
+
+    virtual VkExtent2D &getExtent() = 0;
+
+    virtual const VkFormat &getDepthFormat() const = 0;
+
+    virtual const VkFormat &getImageFormat() const = 0;
+
+    virtual const float getAspectRatio() const = 0;
+
+    virtual const size_t getImageCount() const = 0;
+
+    virtual VkImage &getImage(const int index) = 0;
+
+    virtual VkImageView &getImageView(const int index) = 0;
+
+    virtual VkImage &getDepthImage(const int index) = 0;
+
+    virtual VkImageView &getDepthImageView(const int index) = 0;
+
+    virtual const std::vector<VkImageView> &getDepthImageViews() const = 0;
+};
+} // namespace zh
@@ -2,19 +2,34 @@
 
 #include "System/Core/Device.hpp"
 #include "System/Core/Window.hpp"
+#include "System/Rendering/FramePacer.hpp"
+#include "System/Rendering/RenderTarget.hpp"
 
 namespace zh
 {
-class Swapchain
+class Swapchain : public RenderTarget
 {
   public:
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+    // Fixed for the lifetime of the swapchain and carried over when it is recreated.
+    struct Settings
+    {
+        // Frames the CPU may record ahead of the GPU. One gives the lowest latency, more keep the GPU busier.
+        uint32_t framesInFlight = 2;
+
+        // Images to request, clamped to what the surface allows. Zero requests one more than the surface minimum.
+        uint32_t imageCount = 0;
+
+        // Picks the present mode, and how the renderer paces frame starts.
+        FramePacer::Policy pacingPolicy = FramePacer::Policy::Throughput;
+    };
 
     Swapchain(Device &device, Window &window);
 
-    Swapchain(Device &device, Window &window, VkSwapchainKHR old_swapchain);
+    Swapchain(Device &device, Window &window, const Settings &settings);
 
-    ~Swapchain();
+    Swapchain(Device &device, Window &window, const Settings &settings, VkSwapchainKHR old_swapchain);
+
+    ~Swapchain() override;
 
     Swapchain() = delete;
     Swapchain(const Swapchain &) = delete;
@@ -22,27 +37,46 @@ class Swapchain
 
     const bool compareSwapFormats(const Swapchain &swapchain) const;
 
-    VkResult acquireNextImage(uint32_t *image_index);
+    // Waits until the frame that last used this frame slot is complete, then acquires an image.
+    VkResult acquireNextImage(uint32_t *image_index) override;
+
+    // Submits the frame pending on the device frame timeline and presents it.
+    VkResult submitCommandBuffers(const VkCommandBuffer &buffers, uint32_t &image_index) override;
 
-    VkResult submitCommandBuffers(const VkCommandBuffer &buffers, uint32_t &image_index);
+    const int getFrameIndex() const override;
+
+    const uint32_t getFramesInFlight() const override;
+
+    const VkImageLayout getFinalLayout() const override;
+
+    const Settings &getSettings() const;
 
     VkSwapchainKHR &getHandle();
 
-    VkRenderPass &getRenderPass();
+    VkExtent2D &getExtent() override;
+
+    const VkFormat &getDepthFormat() const override;
 
-    VkExtent2D &getExtent();
+    const VkFormat &getImageFormat() const override;
 
-    const VkFormat &getDepthFormat() const;
+    const float getAspectRatio() const override;
 
-    const VkFormat &getImageFormat() const;
+    const size_t getImageCount() const override;
 
-    const float getAspectRatio() const;
+    VkImage &getImage(const int index) override;
 
-    VkFramebuffer &getFramebuffer(const int index);
+    VkImageView &getImageView(const int index) override;
+
+    VkImage &getDepthImage(const int index) override;
+
+    VkImageView &getDepthImageView(const int index) override;
+
+    const std::vector<VkImageView> &getDepthImageViews() const override;
 
   private:
     Device &device;
     Window &window;
+    Settings settings;
 
     VkSwapchainKHR swapchain;
     VkSwapchainKHR oldSwapchain;
@@ -51,8 +85,6 @@ class Swapchain
     VkFormat depthFormat;
     VkExtent2D extent;
 
-    VkRenderPass renderPass;
-
     std::vector<VkImage> depthImages;
     std::vector<VmaAllocation> depthImagesMemory;
     std::vector<VkImageView> depthImageViews;
@@ -60,13 +92,11 @@ class Swapchain
     std::vector<VkImage> images;
     std::vector<VkImageView> imageViews;
 
-    std::vector<VkFramebuffer> framebuffers;
-
+    // Acquire semaphores are indexed by frame slot; present semaphores by image, since an image's previous present
+    // is only known to be done once the image is acquired again.
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
-    size_t currentFrame;
+    std::vector<uint64_t> imageFrames;
 
     void create();
 
@@ -76,16 +106,10 @@ class Swapchain
 
     void createDepthResources();
 
-    void createRenderPass();
-
-    void createFramebuffers();
-
     void createSyncObjects();
 
     VkSurfaceFormatKHR chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &available_formats);
 
-    VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR> &available_modes);
-
     VkExtent2D chooseExtent(const VkSurfaceCapabilitiesKHR &capabilities);
 
     VkFormat findDepthFormat();
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace zh
+{
+struct AABB
+{
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+    inline const bool isValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+
+    inline const glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+
+    inline const glm::vec3 getHalfExtent() const { return (max - min) * 0.5f; }
+
+    void expand(const glm::vec3 &point);
+
+    const AABB transform(const glm::mat4 &matrix) const;
+};
+
+struct Frustum
+{
+    // Left, right, bottom, top, near, far. Normals (xyz) point inside, w is the plane distance.
+    std::array<glm::vec4, 6> planes;
+
+    static const Frustum fromMatrix(const glm::mat4 &view_projection);
+
+    const bool intersects(const AABB &aabb) const;
+
+    const bool intersects(const glm::vec3 &center, const float radius) const;
+};
+} // namespace zh
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "System/Scene/Bounds.hpp"
+
 class Camera
 {
   public:
@@ -16,6 +18,14 @@ class Camera
 
     void setViewYXZ(glm::vec3 position, glm::vec3 rotation);
 
+    const glm::mat4 &getProjection() const;
+
+    const glm::mat4 &getView() const;
+
+    const glm::mat4 &getInverseView() const;
+
+    const zh::Frustum getFrustum() const;
+
   private:
     glm::mat4 projectionMatrix;
     glm::mat4 viewMatrix;
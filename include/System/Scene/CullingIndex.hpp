@@ -0,0 +1,27 @@
+#pragma once
+
+#include "System/Scene/Bounds.hpp"
+#include "System/Scene/Object.hpp"
+
+namespace zh
+{
+// Common interface for spatial structures that answer visibility queries, so static and dynamic objects can live in
+// whichever structure suits them and still be culled the same way.
+class CullingIndex
+{
+  public:
+    virtual ~CullingIndex() = default;
+
+    virtual void insert(Object &object) = 0;
+
+    virtual void remove(Object &object) = 0;
+
+    // Must be called after the object transform or model changes.
+    virtual void update(Object &object) = 0;
+
+    // Appends every object whose bounds intersect the frustum to visible.
+    virtual void query(const Frustum &frustum, std::vector<Object *> &visible) const = 0;
+
+    virtual const size_t getSize() const = 0;
+};
+} // namespace zh
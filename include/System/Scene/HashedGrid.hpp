@@ -0,0 +1,75 @@
+#pragma once
+
+#include "System/Scene/CullingIndex.hpp"
+
+namespace zh
+{
+// Loose hashed uniform grid for objects that move every frame. Each object lives in exactly one cell, picked by the
+// center of its bounds, and cells are tested with bounds inflated by half a cell. Moving an object is an O(1) swap
+// remove and push, with no refitting. Objects bigger than a cell are kept in a separate list.
+class HashedGrid : public CullingIndex
+{
+  public:
+    HashedGrid(const float cell_size);
+
+    HashedGrid() = delete;
+    HashedGrid(const HashedGrid &) = delete;
+    HashedGrid &operator=(const HashedGrid &) = delete;
+
+    ~HashedGrid() override = default;
+
+    void insert(Object &object) override;
+
+    void remove(Object &object) override;
+
+    void update(Object &object) override;
+
+    void query(const Frustum &frustum, std::vector<Object *> &visible) const override;
+
+    const size_t getSize() const override;
+
+    const float getCellSize() const;
+
+    // Drops cells left empty by moving objects.
+    void compact();
+
+    void clear();
+
+  private:
+    static constexpr uint64_t OVERSIZED_CELL = std::numeric_limits<uint64_t>::max();
+
+    struct Entry
+    {
+        Object *object;
+        AABB bounds;
+    };
+
+    struct Cell
+    {
+        glm::ivec3 coord;
+        std::vector<Entry> entries;
+    };
+
+    struct Location
+    {
+        uint64_t cell;
+        uint32_t slot;
+    };
+
+    float cellSize;
+
+    std::unordered_map<uint64_t, Cell> cells;
+    std::unordered_map<uint32_t, Location> locations;
+    std::vector<Entry> oversized;
+
+    const glm::ivec3 getCellCoord(const glm::vec3 &position) const;
+
+    const uint64_t getCellKey(const AABB &bounds) const;
+
+    void place(Object &object, const AABB &bounds);
+
+    void erase(const Location &location);
+
+    static const uint64_t hashCoord(const glm::ivec3 &coord);
+};
+} // namespace zh
@@ -12,8 +12,8 @@ class Object
         glm::vec3 translation{};
         glm::vec3 scale{1.f, 1.f, 1.f};
         glm::vec3 rotation{};
-        glm::mat4 mat4();
-        glm::mat3 normalMatrix();
+        glm::mat4 mat4() const;
+        glm::mat3 normalMatrix() const;
     };
 
     Object(Device &device);
@@ -36,6 +36,14 @@ class Object
 
     void setRotation(const glm::vec3 &rotation);
 
+    const uint32_t getId() const;
+
+    std::shared_ptr<Model> &getModel();
+
+    const TransformComponent &getTransform() const;
+
+    const AABB getBounds() const;
+
   private:
     inline static uint32_t idCounter = 0;
 
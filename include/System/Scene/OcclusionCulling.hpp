@@ -0,0 +1,40 @@
+#pragma once
+
+#include "System/Scene/CullingIndex.hpp"
+#include "System/Scene/OcclusionRasterizer.hpp"
+
+namespace zh
+{
+// Wraps another culling index and drops the objects its frustum query returns that are hidden behind the occluders
+// of a software rasteriser. The rasteriser must be rasterised for the current camera before querying.
+class OcclusionCulling : public CullingIndex
+{
+  public:
+    OcclusionCulling(CullingIndex &index, OcclusionRasterizer &rasterizer);
+
+    OcclusionCulling() = delete;
+    OcclusionCulling(const OcclusionCulling &) = delete;
+    OcclusionCulling &operator=(const OcclusionCulling &) = delete;
+
+    ~OcclusionCulling() override = default;
+
+    void insert(Object &object) override;
+
+    void remove(Object &object) override;
+
+    void update(Object &object) override;
+
+    void query(const Frustum &frustum, std::vector<Object *> &visible) const override;
+
+    const size_t getSize() const override;
+
+    // Number of objects dropped by the last query.
+    const size_t getOccludedCount() const;
+
+  private:
+    CullingIndex &index;
+    OcclusionRasterizer &rasterizer;
+
+    mutable size_t occludedCount;
+};
+} // namespace zh
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "System/Core/ThreadPool.hpp"
+#include "System/Scene/Bounds.hpp"
+#include "System/Scene/OcclusionRasterizerAvx2.hpp"
+
+namespace zh
+{
+// Software depth rasteriser for CPU side occlusion culling. A small set of occluder meshes is rasterised into a low
+// resolution depth buffer, split in row bands across worker threads, and bounds are tested against it before they
+// reach the draw queue. Rows are processed eight pixels at a time with AVX2 when the build includes the AVX2 kernels
+// and the CPU running it supports them, and one at a time otherwise.
+//
+// A pixel counts as covered when its center is, so occluders should be simplified meshes that fit inside the geometry
+// they stand for. Depth follows the Vulkan convention, 0 at the near plane and 1 at the far plane.
+class OcclusionRasterizer
+{
+  public:
+    OcclusionRasterizer(const uint32_t width, const uint32_t height);
+
+    OcclusionRasterizer() = delete;
+    OcclusionRasterizer(const OcclusionRasterizer &) = delete;
+    OcclusionRasterizer &operator=(const OcclusionRasterizer &) = delete;
+
+    // Returns the occluder index used to move it later.
+    const uint32_t addOccluder(const std::vector<glm::vec3> &vertices, const std::vector<uint32_t> &indices,
+                               const glm::mat4 &transform);
+
+    void updateOccluder(const uint32_t occluder, const glm::mat4 &transform);
+
+    void clearOccluders();
+
+    // Clears the depth buffer and rasterises every occluder. Runs on the calling thread without a thread pool.
+    void rasterize(const glm::mat4 &view_projection, ThreadPool *thread_pool = nullptr);
+
+    // Conservative; bounds crossing the near plane are always visible. Safe to call from several threads.
+    const bool isVisible(const AABB &bounds) const;
+
+    const uint32_t getWidth() const;
+
+    const uint32_t getHeight() const;
+
+    const uint32_t getTriangleCount() const;
+
+    // Row pitch is the width rounded up to a multiple of eight.
+    const std::vector<float> &getDepth() const;
+
+  private:
+    struct Occluder
+    {
+        std::vector<glm::vec3> vertices;
+        std::vector<uint32_t> indices;
+        glm::mat4 transform;
+        uint32_t firstTriangle;
+    };
+
+    using ScreenTriangle = OcclusionTriangle;
+
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;
+
+    // Checked once, the CPU does not change while running.
+    bool useAvx2;
+
+    glm::mat4 viewProjection;
+    std::vector<float> depth;
+
+    std::vector<Occluder> occluders;
+    std::vector<ScreenTriangle> triangles;
+
+    void setupTriangles(const Occluder &occluder);
+
+    void rasterizeRows(const int row_begin, const int row_end);
+
+    void rasterizeTriangle(const ScreenTriangle &triangle, const int row_begin, const int row_end);
+
+    const bool testRect(const int min_x, const int max_x, const int min_y, const int max_y,
+                        const float nearest) const;
+
+    // False when the build leaves out the AVX2 kernels, or the CPU or the OS do not support AVX2.
+    static const bool isAvx2Supported();
+};
+} // namespace zh
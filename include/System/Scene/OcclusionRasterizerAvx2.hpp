@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zh
+{
+// Edge functions e = a * x + b * y + c are positive inside, and depth is interpolated the same way.
+struct OcclusionTriangle
+{
+    float a[3];
+    float b[3];
+    float c[3];
+    float depthA;
+    float depthB;
+    float depthC;
+    int minX;
+    int maxX;
+    int minY;
+    int maxY;
+    bool isValid;
+};
+
+// The eight pixel wide loops of OcclusionRasterizer. They live in the only translation unit built with AVX2, which
+// includes nothing but this header and the intrinsics so no shared inline code is compiled for AVX2, and are only
+// called once the CPU is known to support it. Depth buffer rows are a multiple of eight floats.
+class OcclusionRasterizerAvx2
+{
+  public:
+    OcclusionRasterizerAvx2() = delete;
+
+    // Rasterises rows [min_y, max_y] of the triangle.
+    static void rasterizeTriangle(const OcclusionTriangle &triangle, float *depth, const uint32_t pitch,
+                                  const int min_y, const int max_y);
+
+    // True when any pixel of the rectangle, bounds included, is at or behind nearest.
+    static const bool testRect(const float *depth, const uint32_t pitch, const int min_x, const int max_x,
+                               const int min_y, const int max_y, const float nearest);
+};
+} // namespace zh
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <iostream>
 #include <string>
 #include <memory>
 #include <map>
+#include <unordered_map>
+#include <array>
 #include <vector>
 #include <cstring>
 #include <optional>
@@ -16,6 +19,13 @@
 #include <cstdint>
 #include <cstring>
 #include <filesystem>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <deque>
+#include <atomic>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
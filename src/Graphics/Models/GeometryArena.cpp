@@ -0,0 +1,80 @@
+#include "stdafx.hpp"
+#include "Graphics/Models/GeometryArena.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
+#include "System/Profiling/RenderStats.hpp"
+
+zh::GeometryArena::GeometryArena(Device &device, const uint32_t vertex_capacity, const uint32_t index_capacity)
+    : device(device), vertexCapacity(vertex_capacity), indexCapacity(index_capacity), vertexCount(0), indexCount(0)
+{
+    id = idCounter++;
+
+    vertexBuffer = std::make_unique<Buffer>(device, vertex_capacity * sizeof(Vertex),
+                                            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+                                            VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT);
+
+    indexBuffer = std::make_unique<Buffer>(device, index_capacity * sizeof(Index),
+                                           VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+                                           VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT);
+}
+
+zh::GeometryArena::~GeometryArena() = default;
+
+const zh::GeometryArena::Range zh::GeometryArena::allocate(const std::vector<Vertex> &vertices,
+                                                           const std::vector<Index> &indices)
+{
+    if (vertexCount + vertices.size() > vertexCapacity || indexCount + indices.size() > indexCapacity)
+        throw std::runtime_error("zh::GeometryArena::allocate: ARENA IS OUT OF SPACE");
+
+    Range range{static_cast<int32_t>(vertexCount), indexCount, static_cast<uint32_t>(vertices.size()),
+                static_cast<uint32_t>(indices.size())};
+
+    upload(vertices.data(), vertices.size() * sizeof(Vertex), *vertexBuffer, vertexCount * sizeof(Vertex));
+
+    if (!indices.empty())
+        upload(indices.data(), indices.size() * sizeof(Index), *indexBuffer, indexCount * sizeof(Index));
+
+    vertexCount += range.vertexCount;
+    indexCount += range.indexCount;
+
+    return range;
+}
+
+void zh::GeometryArena::bind(VkCommandBuffer &command_buffer)
+{
+    VkBuffer buffers[] = {vertexBuffer->getBuffer()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers, offsets);
+    vkCmdBindIndexBuffer(command_buffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    ZH_STAT_ADD(BufferBinds, 2);
+}
+
+zh::Buffer &zh::GeometryArena::getVertexBuffer()
+{
+    return *vertexBuffer;
+}
+
+zh::Buffer &zh::GeometryArena::getIndexBuffer()
+{
+    return *indexBuffer;
+}
+
+const uint32_t zh::GeometryArena::getId() const
+{
+    return id;
+}
+
+void zh::GeometryArena::upload(const void *data, const VkDeviceSize size, Buffer &dst, const VkDeviceSize dst_offset)
+{
+    ZH_PROFILE_SCOPE("zh::GeometryArena::upload");
+
+    StagingBuffer staging_buffer(device.getAllocator(), size);
+
+    staging_buffer.map();
+    staging_buffer.write(const_cast<void *>(data), size);
+    staging_buffer.unmap();
+
+    Buffer::copy(device.getLogicalDevice(), device.getTransientCommandPool(), device.getTransferQueue(), staging_buffer,
+                 dst, dst_offset);
+}
@@ -1,66 +1,152 @@
 #include "stdafx.hpp"
 #include "Graphics/Models/Model.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
+#include "System/Profiling/RenderStats.hpp"
 
-zh::Model::Model(Device &device) : device(device)
+zh::Model::Model(Device &device)
+    : device(device), arena(nullptr), vertexCount(0), indexCount(0), vertexOffset(0), firstIndex(0),
+      hasIndexBuffer(false), loaded(false)
 {
-
+    id = idCounter++;
 }
 
-zh::Model::Model(Device &device, const std::string &path) : device(device), hasIndexBuffer(false), loaded(false)
+zh::Model::Model(Device &device, const std::string &path)
+    : device(device), arena(nullptr), vertexCount(0), indexCount(0), vertexOffset(0), firstIndex(0),
+      hasIndexBuffer(false), loaded(false)
 {
+    id = idCounter++;
     loadFromFile(path);
 }
 
-zh::Model::Model(Device &device, const std::vector<Vertex> &vertices) : device(device), hasIndexBuffer(false), loaded(true)
+zh::Model::Model(Device &device, const std::vector<Vertex> &vertices)
+    : device(device), arena(nullptr), vertexOffset(0), firstIndex(0), hasIndexBuffer(false), loaded(true)
 {
+    id = idCounter++;
     vertexCount = static_cast<uint32_t>(vertices.size());
     indexCount = 0;
+
+    computeBounds(vertices);
+    createVertexBuffer(vertices);
 }
 
 zh::Model::Model(Device &device, std::vector<Vertex> vertices, std::vector<Index> indices)
-    : device(device), hasIndexBuffer(true), loaded(true)
+    : device(device), arena(nullptr), vertexOffset(0), firstIndex(0), hasIndexBuffer(true), loaded(true)
 {
+    id = idCounter++;
     vertexCount = static_cast<uint32_t>(vertices.size());
     indexCount = static_cast<uint32_t>(indices.size());
 
+    computeBounds(vertices);
     createVertexBuffer(vertices);
     createIndexBuffer(indices);
 }
 
+zh::Model::Model(Device &device, GeometryArena &arena, const std::vector<Vertex> &vertices,
+                 const std::vector<Index> &indices)
+    : device(device), arena(&arena), hasIndexBuffer(!indices.empty()), loaded(true)
+{
+    id = idCounter++;
+
+    auto range = arena.allocate(vertices, indices);
+    vertexCount = range.vertexCount;
+    indexCount = range.indexCount;
+    vertexOffset = range.vertexOffset;
+    firstIndex = range.firstIndex;
+
+    computeBounds(vertices);
+}
+
 zh::Model::~Model() = default;
 
 const bool zh::Model::loadFromFile(const std::string &path)
 {
+    ZH_PROFILE_SCOPE("zh::Model::loadFromFile");
+
     loaded = true;
     return loaded;
 }
 
 void zh::Model::draw(VkCommandBuffer &command_buffer)
+{
+    draw(command_buffer, 1, 0);
+}
+
+void zh::Model::draw(VkCommandBuffer &command_buffer, const uint32_t instance_count, const uint32_t first_instance)
 {
     if (hasIndexBuffer)
-        vkCmdDrawIndexed(command_buffer, indexCount, 1, 0, 0, 0);
+        vkCmdDrawIndexed(command_buffer, indexCount, instance_count, firstIndex, vertexOffset, first_instance);
     else
-        vkCmdDraw(command_buffer, vertexCount, 1, 0, 0);
+        vkCmdDraw(command_buffer, vertexCount, instance_count, static_cast<uint32_t>(vertexOffset), first_instance);
+
+    ZH_STAT_INCREMENT(DrawCalls);
+    ZH_STAT_ADD(Instances, instance_count);
+    ZH_STAT_ADD(Triangles, uint64_t((hasIndexBuffer ? indexCount : vertexCount) / 3) * instance_count);
 }
 
 void zh::Model::bind(VkCommandBuffer &command_buffer)
 {
+    if (arena != nullptr)
+    {
+        arena->bind(command_buffer);
+        return;
+    }
+
     VkBuffer buffers[] = {vertexBuffer->getBuffer()};
     VkDeviceSize offsets[] = {0};
     vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers, offsets);
+    ZH_STAT_INCREMENT(BufferBinds);
 
     if (hasIndexBuffer)
+    {
         vkCmdBindIndexBuffer(command_buffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+        ZH_STAT_INCREMENT(BufferBinds);
+    }
 }
-void zh::Model::createVertexBuffer(std::vector<Vertex> &vertices)
+
+const zh::AABB &zh::Model::getBounds() const
 {
+    return bounds;
+}
+
+const uint32_t zh::Model::getId() const
+{
+    return id;
+}
+
+zh::GeometryArena *zh::Model::getArena() const
+{
+    return arena;
+}
+
+const bool zh::Model::isIndexed() const
+{
+    return hasIndexBuffer;
+}
+
+const VkDrawIndexedIndirectCommand zh::Model::getIndirectCommand(const uint32_t instance_count,
+                                                                 const uint32_t first_instance) const
+{
+    VkDrawIndexedIndirectCommand command{};
+    command.indexCount = indexCount;
+    command.instanceCount = instance_count;
+    command.firstIndex = firstIndex;
+    command.vertexOffset = vertexOffset;
+    command.firstInstance = first_instance;
+
+    return command;
+}
+
+void zh::Model::createVertexBuffer(const std::vector<Vertex> &vertices)
+{
+    ZH_PROFILE_SCOPE("zh::Model::createVertexBuffer");
+
     StagingBuffer staging_buffer(device.getAllocator(), vertices.size() * sizeof(Vertex));
 
     staging_buffer.map();
-    staging_buffer.write(vertices.data(), staging_buffer.getSize());
+    staging_buffer.write(const_cast<Vertex *>(vertices.data()), staging_buffer.getSize());
     staging_buffer.unmap();
 
-    vertexBuffer = std::make_unique<Buffer>(device.getAllocator(), staging_buffer.getSize(),
+    vertexBuffer = std::make_unique<Buffer>(device, staging_buffer.getSize(),
                                             VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
                                             VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT);
@@ -69,19 +155,29 @@ void zh::Model::createVertexBuffer(std::vector<Vertex> &vertices)
                  *vertexBuffer);
 }
 
-void zh::Model::createIndexBuffer(std::vector<Index> &indices)
+void zh::Model::createIndexBuffer(const std::vector<Index> &indices)
 {
+    ZH_PROFILE_SCOPE("zh::Model::createIndexBuffer");
+
     StagingBuffer staging_buffer(device.getAllocator(), indices.size() * sizeof(Index));
 
     staging_buffer.map();
-    staging_buffer.write(indices.data(), staging_buffer.getSize());
+    staging_buffer.write(const_cast<Index *>(indices.data()), staging_buffer.getSize());
     staging_buffer.unmap();
 
-    indexBuffer = std::make_unique<Buffer>(device.getAllocator(), staging_buffer.getSize(),
+    indexBuffer = std::make_unique<Buffer>(device, staging_buffer.getSize(),
                                            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
                                            VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT);
 
     Buffer::copy(device.getLogicalDevice(), device.getTransientCommandPool(), device.getTransferQueue(), staging_buffer,
-                 *vertexBuffer);
+                 *indexBuffer);
+}
+
+void zh::Model::computeBounds(const std::vector<Vertex> &vertices)
+{
+    bounds = AABB{};
+
+    for (auto &vertex : vertices)
+        bounds.expand(glm::vec3(vertex.pos, 0.f));
 }
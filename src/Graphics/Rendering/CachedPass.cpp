@@ -0,0 +1,94 @@
+#include "stdafx.hpp"
+#include "Graphics/Rendering/CachedPass.hpp"
+
+zh::CachedPass::CachedPass(Device &device, const uint32_t frame_count) : device(device), recordCount(0)
+{
+    slots.resize(frame_count);
+
+    // One pool per slot, so re-recording a slot is a single pool reset.
+    VkCommandPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    pool_info.flags = 0;
+    pool_info.queueFamilyIndex = device.findQueueFamilies(device.getPhysicalDevice()).getGraphicsFamily();
+
+    for (auto &slot : slots)
+    {
+        if (vkCreateCommandPool(device.getLogicalDevice(), &pool_info, nullptr, &slot.commandPool) != VK_SUCCESS)
+            throw std::runtime_error("zh::CachedPass::CachedPass: FAILED TO CREATE COMMAND POOL");
+
+        VkCommandBufferAllocateInfo alloc_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        alloc_info.commandPool = slot.commandPool;
+        alloc_info.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device.getLogicalDevice(), &alloc_info, &slot.commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("zh::CachedPass::CachedPass: FAILED TO ALLOCATE COMMAND BUFFER");
+    }
+}
+
+zh::CachedPass::~CachedPass()
+{
+    std::vector<VkCommandPool> pools;
+
+    for (auto &slot : slots)
+        pools.push_back(slot.commandPool);
+
+    // A frame in flight may still execute the secondary buffers, so their pools go once it has completed.
+    VkDevice logical_device = device.getLogicalDevice();
+
+    device.getDeletionQueue().push([logical_device, pools]() {
+        for (auto &pool : pools)
+            vkDestroyCommandPool(logical_device, pool, nullptr);
+    });
+}
+
+VkCommandBuffer &zh::CachedPass::get(const int frame_index, const State &state, const RecordFunction &record)
+{
+    assert(frame_index >= 0 && frame_index < slots.size() && "zh::CachedPass::get: FRAME INDEX OUT OF BOUNDS");
+
+    Slot &slot = slots[frame_index];
+
+    if (slot.isRecorded && slot.state == state)
+        return slot.commandBuffer;
+
+    vkResetCommandPool(device.getLogicalDevice(), slot.commandPool, 0);
+
+    // Only the attachment formats are inherited, so the same commands work for every swapchain image.
+    VkCommandBufferInheritanceRenderingInfo rendering_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+    rendering_info.colorAttachmentCount = 1;
+    rendering_info.pColorAttachmentFormats = &state.colorFormat;
+    rendering_info.depthAttachmentFormat = state.depthFormat;
+    rendering_info.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+    rendering_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritance_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritance_info.pNext = &rendering_info;
+
+    VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance_info;
+
+    if (vkBeginCommandBuffer(slot.commandBuffer, &begin_info) != VK_SUCCESS)
+        throw std::runtime_error("zh::CachedPass::get: FAILED TO BEGIN RECORDING COMMAND BUFFER");
+
+    record(slot.commandBuffer, frame_index);
+
+    if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("zh::CachedPass::get: FAILED TO RECORD COMMAND BUFFER");
+
+    slot.state = state;
+    slot.isRecorded = true;
+    ++recordCount;
+
+    return slot.commandBuffer;
+}
+
+void zh::CachedPass::invalidate()
+{
+    for (auto &slot : slots)
+        slot.isRecorded = false;
+}
+
+const uint64_t zh::CachedPass::getRecordCount() const
+{
+    return recordCount;
+}
@@ -0,0 +1,345 @@
+#include "stdafx.hpp"
+#include "Graphics/Rendering/CullingPass.hpp"
+#include "System/Profiling/RenderStats.hpp"
+
+zh::CullingPass::CullingPass(Device &device, GeometryArena &arena, const uint32_t max_objects,
+                             const uint32_t frame_count)
+    : device(device), arena(arena), maxObjects(max_objects), objectCount(0), objects(max_objects),
+      isVisibilityCleared(false), frames(frame_count)
+{
+    if (!device.getEnabledVulkan12Features().drawIndirectCount)
+        throw std::runtime_error("zh::CullingPass::CullingPass: DEVICE DOES NOT SUPPORT DRAW INDIRECT COUNT");
+
+    // cull.comp addresses each surviving object's instance data through firstInstance.
+    if (!device.getEnabledFeatures().drawIndirectFirstInstance)
+        throw std::runtime_error("zh::CullingPass::CullingPass: DEVICE DOES NOT SUPPORT DRAW INDIRECT FIRST INSTANCE");
+
+    createBuffers();
+    createDescriptorSets();
+
+    pipeline = std::make_unique<ComputePipeline>(device, "Assets/Shaders/cull.spv",
+                                                 std::vector<VkDescriptorSetLayout>{
+                                                     descriptorSetLayout->getDescriptorSetLayout()},
+                                                 static_cast<uint32_t>(sizeof(PushConstants)));
+
+    latePipeline = std::make_unique<ComputePipeline>(
+        device, "Assets/Shaders/cull_late.spv",
+        std::vector<VkDescriptorSetLayout>{descriptorSetLayout->getDescriptorSetLayout(),
+                                           pyramidDescriptorSetLayout->getDescriptorSetLayout()},
+        static_cast<uint32_t>(sizeof(PushConstants)));
+}
+
+zh::CullingPass::~CullingPass() = default;
+
+const uint32_t zh::CullingPass::addObject(Object &object)
+{
+    uint32_t slot;
+
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        if (objectCount >= maxObjects)
+            throw std::runtime_error("zh::CullingPass::addObject: OBJECT BUFFER IS FULL");
+
+        slot = objectCount++;
+    }
+
+    updateObject(slot, object);
+    return slot;
+}
+
+void zh::CullingPass::updateObject(const uint32_t slot, Object &object)
+{
+    assert(slot < objectCount && "zh::CullingPass::updateObject: SLOT OUT OF BOUNDS");
+
+    auto &model = object.getModel();
+
+    if (model == nullptr || model->getArena() != &arena || !model->isIndexed())
+        throw std::runtime_error("zh::CullingPass::updateObject: OBJECT MODEL IS NOT INDEXED IN THE CULLING ARENA");
+
+    const AABB bounds = object.getBounds();
+    const VkDrawIndexedIndirectCommand command = model->getIndirectCommand(1, 0);
+
+    GPUObject gpu_object{};
+    gpu_object.transform = object.getTransform().mat4();
+    gpu_object.sphere = glm::vec4(bounds.getCenter(), glm::length(bounds.getHalfExtent()));
+    gpu_object.indexCount = command.indexCount;
+    gpu_object.firstIndex = command.firstIndex;
+    gpu_object.vertexOffset = command.vertexOffset;
+    gpu_object.flags = 1;
+
+    writeObject(slot, gpu_object);
+}
+
+void zh::CullingPass::removeObject(const uint32_t slot)
+{
+    assert(slot < objectCount && "zh::CullingPass::removeObject: SLOT OUT OF BOUNDS");
+
+    writeObject(slot, GPUObject{});
+    freeSlots.push_back(slot);
+}
+
+void zh::CullingPass::cull(VkCommandBuffer &command_buffer, const Camera &camera, const int frame_index)
+{
+    dispatch(command_buffer, camera, Phase::All, frame_index);
+}
+
+void zh::CullingPass::cullEarly(VkCommandBuffer &command_buffer, const Camera &camera, const int frame_index)
+{
+    dispatch(command_buffer, camera, Phase::Early, frame_index);
+}
+
+void zh::CullingPass::cullLate(VkCommandBuffer &command_buffer, const Camera &camera, HiZPyramid &pyramid,
+                               const int frame_index)
+{
+    FrameResources &frame = frames[frame_index];
+
+    // The previous use of this frame's set has completed, and the pyramid may have been recreated since.
+    VkDescriptorImageInfo pyramid_info{pyramid.getSampler(), pyramid.getView(), VK_IMAGE_LAYOUT_GENERAL};
+    DescriptorWriter(device, *pyramidDescriptorSetLayout, *descriptorPool)
+        .writeImage(0, &pyramid_info)
+        .overwrite(frame.pyramidDescriptorSet);
+
+    dispatch(command_buffer, camera, Phase::Late, frame_index, pyramid.getExtent());
+}
+
+void zh::CullingPass::draw(VkCommandBuffer &command_buffer, Pipeline &pipeline, VkDescriptorSet descriptor_set,
+                           const int frame_index)
+{
+    drawPhase(command_buffer, pipeline, descriptor_set, frames[frame_index].primary);
+}
+
+void zh::CullingPass::drawLate(VkCommandBuffer &command_buffer, Pipeline &pipeline, VkDescriptorSet descriptor_set,
+                               const int frame_index)
+{
+    drawPhase(command_buffer, pipeline, descriptor_set, frames[frame_index].late);
+}
+
+const uint32_t zh::CullingPass::getObjectCount() const
+{
+    return objectCount - static_cast<uint32_t>(freeSlots.size());
+}
+
+void zh::CullingPass::createBuffers()
+{
+    visibilityBuffer = std::make_unique<Buffer>(
+        device, maxObjects * sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
+
+    for (auto &frame : frames)
+    {
+        createPhaseBuffers(frame.primary);
+        createPhaseBuffers(frame.late);
+
+        frame.uniformBuffer = std::make_unique<Buffer>(
+            device, sizeof(CullData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+        frame.uniformBuffer->map();
+
+        frame.objectBuffer = std::make_unique<Buffer>(
+            device, maxObjects * sizeof(GPUObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+        frame.objectBuffer->map();
+        frame.isSlotDirty.resize(maxObjects, false);
+    }
+}
+
+void zh::CullingPass::createPhaseBuffers(PhaseResources &phase)
+{
+    phase.commandBuffer = std::make_unique<Buffer>(
+        device, maxObjects * sizeof(VkDrawIndexedIndirectCommand),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
+
+    phase.countBuffer = std::make_unique<Buffer>(
+        device, sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
+
+    phase.instanceBuffer = std::make_unique<Buffer>(
+        device, maxObjects * sizeof(InstanceData),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
+}
+
+void zh::CullingPass::createDescriptorSets()
+{
+    descriptorSetLayout = DescriptorSetLayout::Builder(device)
+                              .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                              .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                              .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                              .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                              .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                              .addBinding(5, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                              .build();
+
+    pyramidDescriptorSetLayout =
+        DescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
+
+    // Two phase sets and one pyramid set per frame.
+    const uint32_t frame_count = static_cast<uint32_t>(frames.size());
+    std::vector<VkDescriptorPoolSize> pool_sizes = {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10 * frame_count},
+                                                    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * frame_count},
+                                                    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frame_count}};
+    descriptorPool = std::make_unique<DescriptorPool>(device, 3 * frame_count, 0, pool_sizes);
+
+    for (auto &frame : frames)
+    {
+        writePhaseDescriptorSet(frame.primary, frame);
+        writePhaseDescriptorSet(frame.late, frame);
+
+        if (!descriptorPool->allocateDescriptor(pyramidDescriptorSetLayout->getDescriptorSetLayout(),
+                                                frame.pyramidDescriptorSet))
+            throw std::runtime_error("zh::CullingPass::createDescriptorSets: FAILED TO ALLOCATE PYRAMID DESCRIPTOR SET");
+    }
+}
+
+void zh::CullingPass::writePhaseDescriptorSet(PhaseResources &phase, FrameResources &frame)
+{
+    VkDescriptorBufferInfo object_info{frame.objectBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo command_info{phase.commandBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo count_info{phase.countBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo instance_info{phase.instanceBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo visibility_info{visibilityBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo uniform_info{frame.uniformBuffer->getBuffer(), 0, sizeof(CullData)};
+
+    bool built = DescriptorWriter(device, *descriptorSetLayout, *descriptorPool)
+                     .writeBuffer(0, &object_info)
+                     .writeBuffer(1, &command_info)
+                     .writeBuffer(2, &count_info)
+                     .writeBuffer(3, &instance_info)
+                     .writeBuffer(4, &visibility_info)
+                     .writeBuffer(5, &uniform_info)
+                     .build(phase.descriptorSet);
+
+    if (!built)
+        throw std::runtime_error("zh::CullingPass::writePhaseDescriptorSet: FAILED TO BUILD DESCRIPTOR SET");
+}
+
+void zh::CullingPass::dispatch(VkCommandBuffer &command_buffer, const Camera &camera, const Phase phase,
+                               const int frame_index, const VkExtent2D pyramid_extent)
+{
+    ZH_STAT_PASS(phase == Phase::Late ? "culling_late" : "culling");
+
+    FrameResources &frame = frames[frame_index];
+    PhaseResources &resources = phase == Phase::Late ? frame.late : frame.primary;
+
+    // The frame that last used this slot has completed, so its object buffer is no longer read.
+    flushObjects(frame);
+
+    // Both phases of a frame see the same camera, so rewriting the uniform data between them is harmless.
+    CullData cull_data{};
+    cull_data.viewProjection = camera.getProjection() * camera.getView();
+    const Frustum frustum = Frustum::fromMatrix(cull_data.viewProjection);
+    for (int i = 0; i < 6; ++i)
+        cull_data.planes[i] = frustum.planes[i];
+    cull_data.pyramidSize = glm::vec2(pyramid_extent.width, pyramid_extent.height);
+    cull_data.objectCount = objectCount;
+    frame.uniformBuffer->write(&cull_data, sizeof(CullData));
+
+    // Objects start out hidden, so the first early phase draws nothing and the late phase catches up.
+    if (!isVisibilityCleared)
+    {
+        vkCmdFillBuffer(command_buffer, visibilityBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+        isVisibilityCleared = true;
+    }
+
+    vkCmdFillBuffer(command_buffer, resources.countBuffer->getBuffer(), 0, sizeof(uint32_t), 0);
+
+    // Covers the fills above as well as the visibility written by the previous late phase.
+    VkMemoryBarrier reset_barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    reset_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    reset_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &reset_barrier, 0, nullptr, 0, nullptr);
+    ZH_STAT_INCREMENT(Barriers);
+
+    ComputePipeline &compute_pipeline = phase == Phase::Late ? *latePipeline : *pipeline;
+    PushConstants constants{phase};
+
+    compute_pipeline.bind(command_buffer);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline.getLayout(), 0, 1,
+                            &resources.descriptorSet, 0, nullptr);
+    ZH_STAT_INCREMENT(DescriptorBinds);
+
+    if (phase == Phase::Late)
+    {
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline.getLayout(), 1, 1,
+                                &frame.pyramidDescriptorSet, 0, nullptr);
+        ZH_STAT_INCREMENT(DescriptorBinds);
+    }
+
+    vkCmdPushConstants(command_buffer, compute_pipeline.getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(PushConstants), &constants);
+    vkCmdDispatch(command_buffer, (objectCount + 63) / 64, 1, 1);
+
+    // Make the appended commands and transforms visible to the indirect draw and the vertex input.
+    VkMemoryBarrier cull_barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    cull_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cull_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1,
+                         &cull_barrier, 0, nullptr, 0, nullptr);
+    ZH_STAT_INCREMENT(Barriers);
+}
+
+void zh::CullingPass::drawPhase(VkCommandBuffer &command_buffer, Pipeline &pipeline, VkDescriptorSet descriptor_set,
+                                PhaseResources &phase)
+{
+    pipeline.bind(command_buffer);
+
+    if (descriptor_set != VK_NULL_HANDLE)
+    {
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.getLayout(), 0, 1,
+                                &descriptor_set, 0, nullptr);
+        ZH_STAT_INCREMENT(DescriptorBinds);
+    }
+
+    arena.bind(command_buffer);
+
+    VkBuffer buffers[] = {phase.instanceBuffer->getBuffer()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(command_buffer, 1, 1, buffers, offsets);
+    ZH_STAT_INCREMENT(BufferBinds);
+
+    // The draw count is only known on the GPU, so instances and triangles of culled draws are not counted.
+    vkCmdDrawIndexedIndirectCount(command_buffer, phase.commandBuffer->getBuffer(), 0, phase.countBuffer->getBuffer(),
+                                  0, objectCount, sizeof(VkDrawIndexedIndirectCommand));
+    ZH_STAT_INCREMENT(DrawCalls);
+}
+
+void zh::CullingPass::writeObject(const uint32_t slot, const GPUObject &gpu_object)
+{
+    objects[slot] = gpu_object;
+
+    for (auto &frame : frames)
+    {
+        if (frame.isSlotDirty[slot])
+            continue;
+
+        frame.isSlotDirty[slot] = true;
+        frame.dirtySlots.push_back(slot);
+    }
+}
+
+void zh::CullingPass::flushObjects(FrameResources &frame)
+{
+    for (auto &slot : frame.dirtySlots)
+    {
+        frame.objectBuffer->write(&objects[slot], sizeof(GPUObject), slot * sizeof(GPUObject));
+        frame.isSlotDirty[slot] = false;
+    }
+
+    frame.dirtySlots.clear();
+}
@@ -0,0 +1,155 @@
+#include "stdafx.hpp"
+#include "Graphics/Rendering/FrameContext.hpp"
+
+zh::FrameContext::FrameContext(Device &device, const uint32_t worker_count) : device(device)
+{
+    commandPool = createCommandPool();
+
+    VkCommandBufferAllocateInfo alloc_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandPool = commandPool;
+    alloc_info.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(device.getLogicalDevice(), &alloc_info, &commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("zh::FrameContext::FrameContext: FAILED TO ALLOCATE COMMAND BUFFER");
+
+    workers.resize(worker_count);
+
+    for (auto &worker : workers)
+        worker.commandPool = createCommandPool();
+
+    std::vector<VkDescriptorPoolSize> pool_sizes = {
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_DESCRIPTOR_SETS},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_DESCRIPTOR_SETS},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_DESCRIPTOR_SETS},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_DESCRIPTOR_SETS},
+    };
+    descriptorPool = std::make_unique<DescriptorPool>(device, MAX_DESCRIPTOR_SETS, 0, pool_sizes);
+}
+
+zh::FrameContext::~FrameContext()
+{
+    // Destroying a pool frees the command buffers allocated from it.
+    for (auto &worker : workers)
+        vkDestroyCommandPool(device.getLogicalDevice(), worker.commandPool, nullptr);
+
+    vkDestroyCommandPool(device.getLogicalDevice(), commandPool, nullptr);
+}
+
+void zh::FrameContext::reset()
+{
+    vkResetCommandPool(device.getLogicalDevice(), commandPool, 0);
+
+    for (auto &worker : workers)
+    {
+        if (worker.usedCount == 0)
+            continue;
+
+        vkResetCommandPool(device.getLogicalDevice(), worker.commandPool, 0);
+        worker.usedCount = 0;
+    }
+
+    descriptorPool->resetPool();
+
+    for (auto &[usage, transient] : transientBuffers)
+    {
+        transient.offset = 0;
+        transient.retired.clear();
+    }
+}
+
+VkCommandBuffer &zh::FrameContext::getCommandBuffer()
+{
+    return commandBuffer;
+}
+
+VkCommandBuffer zh::FrameContext::acquireSecondaryCommandBuffer(const uint32_t worker)
+{
+    assert(worker < workers.size() && "zh::FrameContext::acquireSecondaryCommandBuffer: WORKER OUT OF BOUNDS");
+
+    WorkerCommands &commands = workers[worker];
+
+    if (commands.usedCount == commands.commandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo alloc_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        alloc_info.commandPool = commands.commandPool;
+        alloc_info.commandBufferCount = 1;
+
+        VkCommandBuffer command_buffer;
+
+        if (vkAllocateCommandBuffers(device.getLogicalDevice(), &alloc_info, &command_buffer) != VK_SUCCESS)
+            throw std::runtime_error(
+                "zh::FrameContext::acquireSecondaryCommandBuffer: FAILED TO ALLOCATE SECONDARY COMMAND BUFFER");
+
+        commands.commandBuffers.push_back(command_buffer);
+    }
+
+    return commands.commandBuffers[commands.usedCount++];
+}
+
+const uint32_t zh::FrameContext::getWorkerCount() const
+{
+    return static_cast<uint32_t>(workers.size());
+}
+
+VkDescriptorSet zh::FrameContext::allocateDescriptorSet(const DescriptorSetLayout &descriptor_set_layout)
+{
+    VkDescriptorSet descriptor_set;
+
+    if (!descriptorPool->allocateDescriptor(descriptor_set_layout.getDescriptorSetLayout(), descriptor_set))
+        throw std::runtime_error("zh::FrameContext::allocateDescriptorSet: FRAME DESCRIPTOR POOL IS EXHAUSTED");
+
+    return descriptor_set;
+}
+
+zh::Buffer &zh::FrameContext::allocateTransient(const VkDeviceSize size, const VkBufferUsageFlags usage,
+                                                VkDeviceSize &offset)
+{
+    TransientBuffer &transient = transientBuffers[usage];
+
+    // Keep every sub-allocation 16 byte aligned, which covers vertex and indirect offsets.
+    const VkDeviceSize aligned_offset = (transient.offset + 15) & ~VkDeviceSize(15);
+
+    if (transient.buffer == nullptr || aligned_offset + size > transient.buffer->getSize())
+    {
+        VkDeviceSize capacity = transient.buffer != nullptr ? transient.buffer->getSize() * 2 : 4096;
+        while (capacity < size)
+            capacity *= 2;
+
+        // Commands already recorded this frame may still reference the old buffer.
+        if (transient.buffer != nullptr)
+            transient.retired.push_back(std::move(transient.buffer));
+
+        transient.buffer = std::make_unique<Buffer>(
+            device, capacity, usage,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+        transient.buffer->map();
+        transient.offset = 0;
+    }
+    else
+    {
+        transient.offset = aligned_offset;
+    }
+
+    offset = transient.offset;
+    transient.offset += size;
+
+    return *transient.buffer;
+}
+
+VkCommandPool zh::FrameContext::createCommandPool()
+{
+    // No per buffer reset flag: the whole pool is reset once per frame.
+    VkCommandPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_info.queueFamilyIndex = device.findQueueFamilies(device.getPhysicalDevice()).getGraphicsFamily();
+
+    VkCommandPool command_pool;
+
+    if (vkCreateCommandPool(device.getLogicalDevice(), &pool_info, nullptr, &command_pool) != VK_SUCCESS)
+        throw std::runtime_error("zh::FrameContext::createCommandPool: FAILED TO CREATE COMMAND POOL");
+
+    return command_pool;
+}
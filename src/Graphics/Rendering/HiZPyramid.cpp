@@ -0,0 +1,265 @@
+#include "stdafx.hpp"
+#include "Graphics/Rendering/HiZPyramid.hpp"
+#include "System/Profiling/RenderStats.hpp"
+
+zh::HiZPyramid::HiZPyramid(Device &device, const VkExtent2D extent, const VkFormat depth_format,
+                           const std::vector<VkImageView> &depth_views)
+    : device(device), extent(extent), depthFormat(depth_format)
+{
+    levelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
+
+    createImage();
+    createSampler();
+    createDescriptorSets(depth_views);
+
+    pipeline = std::make_unique<ComputePipeline>(device, "Assets/Shaders/hiz.spv",
+                                                 std::vector<VkDescriptorSetLayout>{
+                                                     descriptorSetLayout->getDescriptorSetLayout()},
+                                                 static_cast<uint32_t>(sizeof(PushConstants)));
+}
+
+zh::HiZPyramid::~HiZPyramid()
+{
+    // The pyramid is recreated on resize while frames in flight may still sample it.
+    DeletionQueue &deletion_queue = device.getDeletionQueue();
+
+    deletion_queue.push(sampler);
+
+    for (auto &level_view : levelViews)
+        deletion_queue.push(level_view);
+
+    deletion_queue.push(view);
+    deletion_queue.push(image, imageMemory);
+
+    // The descriptor pool, set layout and pipeline retire themselves the same way.
+}
+
+void zh::HiZPyramid::build(VkCommandBuffer &command_buffer, VkImage depth_image, const uint32_t depth_index)
+{
+    assert(depth_index < depthDescriptorSets.size() && "zh::HiZPyramid::build: DEPTH INDEX OUT OF BOUNDS");
+
+    ZH_STAT_PASS("hiz");
+
+    const bool has_stencil =
+        depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT;
+    const VkImageAspectFlags depth_aspect =
+        VK_IMAGE_ASPECT_DEPTH_BIT | (has_stencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+
+    // The depth pass may have written from either fragment test stage.
+    std::array<VkImageMemoryBarrier2, 2> barriers{};
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barriers[0].srcStageMask =
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    barriers[0].srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barriers[0].dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = depth_image;
+    barriers[0].subresourceRange = {depth_aspect, 0, 1, 0, 1};
+
+    // The previous contents are discarded, but reads from earlier frames must finish before they are overwritten.
+    barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barriers[1].srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barriers[1].srcAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+    barriers[1].dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].image = image;
+    barriers[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1};
+
+    VkDependencyInfo dependency_info{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependency_info.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+    dependency_info.pImageMemoryBarriers = barriers.data();
+
+    vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+    ZH_STAT_ADD(Barriers, barriers.size());
+
+    pipeline->bind(command_buffer);
+
+    for (uint32_t level = 0; level < levelCount; ++level)
+    {
+        const VkExtent2D source_extent = level == 0 ? extent : getLevelExtent(level - 1);
+        const VkExtent2D destination_extent = getLevelExtent(level);
+
+        PushConstants constants{};
+        constants.sourceSize = glm::ivec2(source_extent.width, source_extent.height);
+        constants.destinationSize = glm::ivec2(destination_extent.width, destination_extent.height);
+
+        VkDescriptorSet &descriptor_set = level == 0 ? depthDescriptorSets[depth_index] : levelDescriptorSets[level];
+
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->getLayout(), 0, 1,
+                                &descriptor_set, 0, nullptr);
+        ZH_STAT_INCREMENT(DescriptorBinds);
+        vkCmdPushConstants(command_buffer, pipeline->getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(PushConstants), &constants);
+        vkCmdDispatch(command_buffer, (destination_extent.width + 7) / 8, (destination_extent.height + 7) / 8, 1);
+
+        // The level just written is the source of the next one, and of the occlusion test after the last one.
+        VkImageMemoryBarrier2 level_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+        level_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        level_barrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+        level_barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        level_barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+        level_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        level_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        level_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        level_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        level_barrier.image = image;
+        level_barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+
+        VkDependencyInfo level_dependency_info{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        level_dependency_info.imageMemoryBarrierCount = 1;
+        level_dependency_info.pImageMemoryBarriers = &level_barrier;
+
+        vkCmdPipelineBarrier2(command_buffer, &level_dependency_info);
+        ZH_STAT_INCREMENT(Barriers);
+    }
+
+    // Hands the depth image back to the attachment layout for the passes that follow.
+    VkImageMemoryBarrier2 &depth_barrier = barriers[0];
+    depth_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    depth_barrier.srcAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+    depth_barrier.dstStageMask =
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    depth_barrier.dstAccessMask =
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depth_barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    depth_barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    dependency_info.imageMemoryBarrierCount = 1;
+    dependency_info.pImageMemoryBarriers = &depth_barrier;
+
+    vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+    ZH_STAT_INCREMENT(Barriers);
+}
+
+VkImageView &zh::HiZPyramid::getView()
+{
+    return view;
+}
+
+VkSampler &zh::HiZPyramid::getSampler()
+{
+    return sampler;
+}
+
+const VkExtent2D zh::HiZPyramid::getExtent() const
+{
+    return extent;
+}
+
+const uint32_t zh::HiZPyramid::getLevelCount() const
+{
+    return levelCount;
+}
+
+void zh::HiZPyramid::createImage()
+{
+    VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.extent.width = extent.width;
+    image_info.extent.height = extent.height;
+    image_info.extent.depth = 1;
+    image_info.mipLevels = levelCount;
+    image_info.arrayLayers = 1;
+    image_info.format = VK_FORMAT_R32_SFLOAT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_info.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.flags = 0;
+
+    device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+    VkImageViewCreateInfo view_info{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    view_info.image = image;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = VK_FORMAT_R32_SFLOAT;
+    view_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1};
+
+    if (vkCreateImageView(device.getLogicalDevice(), &view_info, nullptr, &view) != VK_SUCCESS)
+        throw std::runtime_error("zh::HiZPyramid::createImage: FAILED TO CREATE IMAGE VIEW");
+
+    levelViews.resize(levelCount);
+
+    for (uint32_t level = 0; level < levelCount; ++level)
+    {
+        view_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+
+        if (vkCreateImageView(device.getLogicalDevice(), &view_info, nullptr, &levelViews[level]) != VK_SUCCESS)
+            throw std::runtime_error("zh::HiZPyramid::createImage: FAILED TO CREATE LEVEL IMAGE VIEW");
+    }
+}
+
+void zh::HiZPyramid::createSampler()
+{
+    // Point sampling; the shaders pick texels and levels themselves.
+    VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+    sampler_info.magFilter = VK_FILTER_NEAREST;
+    sampler_info.minFilter = VK_FILTER_NEAREST;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.minLod = 0.f;
+    sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(device.getLogicalDevice(), &sampler_info, nullptr, &sampler) != VK_SUCCESS)
+        throw std::runtime_error("zh::HiZPyramid::createSampler: FAILED TO CREATE SAMPLER");
+}
+
+void zh::HiZPyramid::createDescriptorSets(const std::vector<VkImageView> &depth_views)
+{
+    descriptorSetLayout =
+        DescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
+
+    // Level 0 reads one of the swapchain depth images, every other level reads the level above it.
+    const uint32_t set_count = static_cast<uint32_t>(depth_views.size()) + levelCount;
+    std::vector<VkDescriptorPoolSize> pool_sizes = {{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, set_count},
+                                                    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, set_count}};
+    descriptorPool = std::make_unique<DescriptorPool>(device, set_count, 0, pool_sizes);
+
+    VkDescriptorImageInfo destination_info{VK_NULL_HANDLE, levelViews[0], VK_IMAGE_LAYOUT_GENERAL};
+
+    depthDescriptorSets.resize(depth_views.size());
+
+    for (size_t i = 0; i < depth_views.size(); ++i)
+    {
+        VkDescriptorImageInfo source_info{sampler, depth_views[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+        if (!DescriptorWriter(device, *descriptorSetLayout, *descriptorPool)
+                 .writeImage(0, &source_info)
+                 .writeImage(1, &destination_info)
+                 .build(depthDescriptorSets[i]))
+            throw std::runtime_error("zh::HiZPyramid::createDescriptorSets: FAILED TO BUILD DEPTH DESCRIPTOR SET");
+    }
+
+    levelDescriptorSets.resize(levelCount, VK_NULL_HANDLE);
+
+    for (uint32_t level = 1; level < levelCount; ++level)
+    {
+        VkDescriptorImageInfo source_info{sampler, levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL};
+        VkDescriptorImageInfo level_info{VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+
+        if (!DescriptorWriter(device, *descriptorSetLayout, *descriptorPool)
+                 .writeImage(0, &source_info)
+                 .writeImage(1, &level_info)
+                 .build(levelDescriptorSets[level]))
+            throw std::runtime_error("zh::HiZPyramid::createDescriptorSets: FAILED TO BUILD LEVEL DESCRIPTOR SET");
+    }
+}
+
+const VkExtent2D zh::HiZPyramid::getLevelExtent(const uint32_t level) const
+{
+    return {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u)};
+}
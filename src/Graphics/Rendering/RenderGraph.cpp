@@ -0,0 +1,950 @@
+#include "stdafx.hpp"
+#include "Graphics/Rendering/RenderGraph.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
+#include "System/Profiling/RenderStats.hpp"
+
+namespace
+{
+// Write bits are the only ones that matter on the source side of a barrier.
+constexpr VkAccessFlags2 WRITE_ACCESS_MASK =
+    VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT |
+    VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+} // namespace
+
+zh::RenderGraph::PassBuilder::PassBuilder(RenderGraph &graph, const uint32_t pass) : graph(graph), pass(pass)
+{
+}
+
+zh::RenderGraph::PassBuilder &zh::RenderGraph::PassBuilder::read(const Resource resource, const Usage usage)
+{
+    assert(resource < graph.resources.size() && "zh::RenderGraph::PassBuilder::read: RESOURCE OUT OF BOUNDS");
+    assert(!isWriteUsage(usage) && "zh::RenderGraph::PassBuilder::read: USAGE WRITES THE RESOURCE");
+
+    graph.passes[pass].accesses.push_back({resource, usage, false});
+    graph.compiled = false;
+
+    return *this;
+}
+
+zh::RenderGraph::PassBuilder &zh::RenderGraph::PassBuilder::write(const Resource resource, const Usage usage)
+{
+    assert(resource < graph.resources.size() && "zh::RenderGraph::PassBuilder::write: RESOURCE OUT OF BOUNDS");
+    assert(isWriteUsage(usage) && "zh::RenderGraph::PassBuilder::write: USAGE ONLY READS THE RESOURCE");
+
+    graph.passes[pass].accesses.push_back({resource, usage, true});
+    graph.compiled = false;
+
+    return *this;
+}
+
+zh::RenderGraph::PassBuilder &zh::RenderGraph::PassBuilder::clear(const Resource resource,
+                                                                  const VkClearValue clear_value)
+{
+    assert(resource < graph.resources.size() && "zh::RenderGraph::PassBuilder::clear: RESOURCE OUT OF BOUNDS");
+
+    graph.passes[pass].clearValues[resource] = clear_value;
+    graph.compiled = false;
+
+    return *this;
+}
+
+zh::RenderGraph::PassBuilder &zh::RenderGraph::PassBuilder::setSideEffects()
+{
+    graph.passes[pass].hasSideEffects = true;
+    graph.compiled = false;
+
+    return *this;
+}
+
+zh::RenderGraph::RenderGraph(Device &device) : device(device), profiler(nullptr), statistics(nullptr), compiled(false)
+{
+}
+
+zh::RenderGraph::~RenderGraph()
+{
+    destroyTransientImages();
+}
+
+zh::RenderGraph::Resource zh::RenderGraph::importImage(const std::string &name, VkImage image, VkImageView view,
+                                                       const VkFormat format, const VkExtent2D extent,
+                                                       const ResourceState &initial_state,
+                                                       const ResourceState &final_state)
+{
+    ResourceNode node{name, true, true};
+    node.image = image;
+    node.view = view;
+    node.format = format;
+    node.extent = extent;
+    node.initialState = initial_state;
+    node.finalState = final_state;
+
+    resources.push_back(node);
+    compiled = false;
+
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+zh::RenderGraph::Resource zh::RenderGraph::importBuffer(const std::string &name, VkBuffer buffer,
+                                                        const ResourceState &initial_state)
+{
+    ResourceNode node{name, false, true};
+    node.buffer = buffer;
+    node.initialState = initial_state;
+
+    resources.push_back(node);
+    compiled = false;
+
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+zh::RenderGraph::Resource zh::RenderGraph::createImage(const std::string &name, const ImageDescription &description)
+{
+    ResourceNode node{name, true, false};
+    node.format = description.format;
+    node.extent = description.extent;
+
+    resources.push_back(node);
+    compiled = false;
+
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+zh::RenderGraph::PassBuilder zh::RenderGraph::addPass(const std::string &name, const PassType type,
+                                                       const ExecuteFunction &execute)
+{
+    PassNode node;
+    node.name = name;
+    node.type = type;
+    node.execute = execute;
+
+    passes.push_back(node);
+    compiled = false;
+
+    return PassBuilder(*this, static_cast<uint32_t>(passes.size() - 1));
+}
+
+void zh::RenderGraph::setImportedImage(const Resource resource, VkImage image, VkImageView view)
+{
+    if (resource >= resources.size() || !resources[resource].isImported || !resources[resource].isImage)
+        throw std::runtime_error("zh::RenderGraph::setImportedImage: RESOURCE IS NOT AN IMPORTED IMAGE");
+
+    resources[resource].image = image;
+    resources[resource].view = view;
+}
+
+void zh::RenderGraph::setImportedBuffer(const Resource resource, VkBuffer buffer)
+{
+    if (resource >= resources.size() || !resources[resource].isImported || resources[resource].isImage)
+        throw std::runtime_error("zh::RenderGraph::setImportedBuffer: RESOURCE IS NOT AN IMPORTED BUFFER");
+
+    resources[resource].buffer = buffer;
+}
+
+void zh::RenderGraph::setProfiler(GpuProfiler *profiler)
+{
+    this->profiler = profiler;
+}
+
+void zh::RenderGraph::setPipelineStatistics(PipelineStatistics *statistics)
+{
+    this->statistics = statistics;
+}
+
+void zh::RenderGraph::compile()
+{
+    ZH_PROFILE_SCOPE("zh::RenderGraph::compile");
+
+    destroyTransientImages();
+
+    for (auto &resource : resources)
+    {
+        resource.memorySlot = -1;
+        resource.firstPass = -1;
+        resource.lastPass = -1;
+        resource.usage = 0;
+    }
+
+    steps.clear();
+    finalBarriers.clear();
+
+    cullPasses();
+    computeLifetimes();
+    allocateTransientImages();
+    planBarriers();
+
+    compiled = true;
+}
+
+void zh::RenderGraph::execute(VkCommandBuffer &command_buffer)
+{
+    ZH_PROFILE_SCOPE("zh::RenderGraph::execute");
+
+    if (!compiled)
+        throw std::runtime_error("zh::RenderGraph::execute: GRAPH MUST BE COMPILED BEFORE IT IS EXECUTED");
+
+    for (auto &step : steps)
+    {
+        ZH_STAT_PASS(passes[step.pass].name);
+
+        recordBarriers(command_buffer, step.barriers);
+
+        if (profiler != nullptr)
+            profiler->beginScope(command_buffer, passes[step.pass].name);
+
+        if (statistics != nullptr)
+            statistics->beginScope(command_buffer, passes[step.pass].name);
+
+        const bool is_rendering = !step.colorAttachments.empty() || step.depthAttachment.has_value();
+
+        if (is_rendering)
+        {
+            std::vector<VkRenderingAttachmentInfo> color_attachments;
+
+            for (auto &attachment : step.colorAttachments)
+            {
+                VkRenderingAttachmentInfo color_attachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+                color_attachment.imageView = resources[attachment.resource].view;
+                color_attachment.imageLayout = attachment.layout;
+                color_attachment.loadOp = attachment.loadOp;
+                color_attachment.storeOp = attachment.storeOp;
+                color_attachment.clearValue = attachment.clearValue;
+
+                color_attachments.push_back(color_attachment);
+            }
+
+            VkRenderingAttachmentInfo depth_attachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+
+            if (step.depthAttachment.has_value())
+            {
+                depth_attachment.imageView = resources[step.depthAttachment->resource].view;
+                depth_attachment.imageLayout = step.depthAttachment->layout;
+                depth_attachment.loadOp = step.depthAttachment->loadOp;
+                depth_attachment.storeOp = step.depthAttachment->storeOp;
+                depth_attachment.clearValue = step.depthAttachment->clearValue;
+            }
+
+            VkRenderingInfo rendering_info{VK_STRUCTURE_TYPE_RENDERING_INFO};
+            rendering_info.renderArea.offset = {0, 0};
+            rendering_info.renderArea.extent = step.renderArea;
+            rendering_info.layerCount = 1;
+            rendering_info.colorAttachmentCount = static_cast<uint32_t>(color_attachments.size());
+            rendering_info.pColorAttachments = color_attachments.empty() ? nullptr : color_attachments.data();
+            rendering_info.pDepthAttachment = step.depthAttachment.has_value() ? &depth_attachment : nullptr;
+
+            vkCmdBeginRendering(command_buffer, &rendering_info);
+
+            VkViewport viewport{};
+            viewport.x = 0.0f;
+            viewport.y = 0.0f;
+            viewport.width = static_cast<float>(step.renderArea.width);
+            viewport.height = static_cast<float>(step.renderArea.height);
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+
+            VkRect2D scissor{{0, 0}, step.renderArea};
+
+            vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+            vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+        }
+
+        passes[step.pass].execute(command_buffer, *this);
+
+        if (is_rendering)
+            vkCmdEndRendering(command_buffer);
+
+        if (statistics != nullptr)
+            statistics->endScope(command_buffer);
+
+        if (profiler != nullptr)
+            profiler->endScope(command_buffer);
+    }
+
+    recordBarriers(command_buffer, finalBarriers);
+}
+
+void zh::RenderGraph::clear()
+{
+    destroyTransientImages();
+
+    resources.clear();
+    passes.clear();
+    steps.clear();
+    finalBarriers.clear();
+    compiled = false;
+}
+
+VkImage &zh::RenderGraph::getImage(const Resource resource)
+{
+    if (resource >= resources.size() || !resources[resource].isImage)
+        throw std::runtime_error("zh::RenderGraph::getImage: RESOURCE IS NOT AN IMAGE");
+
+    return resources[resource].image;
+}
+
+VkImageView &zh::RenderGraph::getImageView(const Resource resource)
+{
+    if (resource >= resources.size() || !resources[resource].isImage)
+        throw std::runtime_error("zh::RenderGraph::getImageView: RESOURCE IS NOT AN IMAGE");
+
+    return resources[resource].view;
+}
+
+VkBuffer &zh::RenderGraph::getBuffer(const Resource resource)
+{
+    if (resource >= resources.size() || resources[resource].isImage)
+        throw std::runtime_error("zh::RenderGraph::getBuffer: RESOURCE IS NOT A BUFFER");
+
+    return resources[resource].buffer;
+}
+
+const bool zh::RenderGraph::isCompiled() const
+{
+    return compiled;
+}
+
+const bool zh::RenderGraph::isPassCulled(const std::string &name) const
+{
+    for (auto &pass : passes)
+    {
+        if (pass.name == name)
+            return pass.isCulled;
+    }
+
+    throw std::runtime_error("zh::RenderGraph::isPassCulled: NO PASS NAMED " + name);
+}
+
+const size_t zh::RenderGraph::getTransientAllocationCount() const
+{
+    return memorySlots.size();
+}
+
+const size_t zh::RenderGraph::getBarrierCount() const
+{
+    size_t count = finalBarriers.size();
+
+    for (auto &step : steps)
+        count += step.barriers.size();
+
+    return count;
+}
+
+void zh::RenderGraph::cullPasses()
+{
+    std::vector<uint32_t> live_passes;
+
+    // Writes to imported resources are seen outside the graph, so those passes are always kept.
+    for (uint32_t i = 0; i < passes.size(); ++i)
+    {
+        PassNode &pass = passes[i];
+        pass.isCulled = !pass.hasSideEffects;
+
+        for (auto &access : pass.accesses)
+        {
+            if (access.isWrite && resources[access.resource].isImported)
+                pass.isCulled = false;
+        }
+
+        if (!pass.isCulled)
+            live_passes.push_back(i);
+    }
+
+    // Walk back from the kept passes to every earlier pass producing what they use. A write that does not clear
+    // keeps part of what was there, so it depends on earlier writers as well.
+    while (!live_passes.empty())
+    {
+        const uint32_t pass = live_passes.back();
+        live_passes.pop_back();
+
+        for (auto &access : passes[pass].accesses)
+        {
+            if (access.isWrite && passes[pass].clearValues.count(access.resource) != 0)
+                continue;
+
+            for (uint32_t producer = 0; producer < pass; ++producer)
+            {
+                if (!passes[producer].isCulled)
+                    continue;
+
+                for (auto &producer_access : passes[producer].accesses)
+                {
+                    if (producer_access.isWrite && producer_access.resource == access.resource)
+                    {
+                        passes[producer].isCulled = false;
+                        live_passes.push_back(producer);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void zh::RenderGraph::computeLifetimes()
+{
+    for (int i = 0; i < passes.size(); ++i)
+    {
+        if (passes[i].isCulled)
+            continue;
+
+        for (auto &access : passes[i].accesses)
+        {
+            ResourceNode &resource = resources[access.resource];
+
+            if (resource.firstPass < 0)
+                resource.firstPass = i;
+
+            resource.lastPass = i;
+            resource.usage |= getImageUsage(access.usage);
+        }
+    }
+}
+
+void zh::RenderGraph::allocateTransientImages()
+{
+    std::vector<Resource> transients;
+    std::unordered_map<Resource, VkMemoryRequirements> requirements;
+
+    for (Resource i = 0; i < resources.size(); ++i)
+    {
+        ResourceNode &resource = resources[i];
+
+        // Transient images no live pass touches are never created.
+        if (resource.isImported || !resource.isImage || resource.firstPass < 0)
+            continue;
+
+        VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.extent.width = resource.extent.width;
+        image_info.extent.height = resource.extent.height;
+        image_info.extent.depth = 1;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.format = resource.format;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_info.usage = resource.usage;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device.getLogicalDevice(), &image_info, nullptr, &resource.image) != VK_SUCCESS)
+            throw std::runtime_error("zh::RenderGraph::allocateTransientImages: FAILED TO CREATE IMAGE " +
+                                     resource.name);
+
+        vkGetImageMemoryRequirements(device.getLogicalDevice(), resource.image, &requirements[i]);
+        transients.push_back(i);
+    }
+
+    // Largest first, so smaller images fill allocations left by bigger ones that are done by then.
+    std::sort(transients.begin(), transients.end(), [&requirements](const Resource a, const Resource b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    for (auto &transient : transients)
+    {
+        ResourceNode &resource = resources[transient];
+        const VkMemoryRequirements &transient_requirements = requirements[transient];
+
+        for (int i = 0; i < memorySlots.size() && resource.memorySlot < 0; ++i)
+        {
+            MemorySlot &slot = memorySlots[i];
+
+            if ((slot.requirements.memoryTypeBits & transient_requirements.memoryTypeBits) == 0)
+                continue;
+
+            bool overlaps = false;
+
+            for (auto &other : slot.resources)
+            {
+                if (resource.firstPass <= resources[other].lastPass && resources[other].firstPass <= resource.lastPass)
+                    overlaps = true;
+            }
+
+            if (overlaps)
+                continue;
+
+            slot.requirements.size = std::max(slot.requirements.size, transient_requirements.size);
+            slot.requirements.alignment = std::max(slot.requirements.alignment, transient_requirements.alignment);
+            slot.requirements.memoryTypeBits &= transient_requirements.memoryTypeBits;
+            slot.resources.push_back(transient);
+            resource.memorySlot = i;
+        }
+
+        if (resource.memorySlot < 0)
+        {
+            MemorySlot slot;
+            slot.requirements = transient_requirements;
+            slot.resources.push_back(transient);
+
+            memorySlots.push_back(slot);
+            resource.memorySlot = static_cast<int>(memorySlots.size() - 1);
+        }
+    }
+
+    VmaAllocationCreateInfo alloc_create_info{};
+    alloc_create_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    for (auto &slot : memorySlots)
+    {
+        if (vmaAllocateMemory(device.getAllocator(), &slot.requirements, &alloc_create_info, &slot.allocation,
+                              nullptr) != VK_SUCCESS)
+            throw std::runtime_error("zh::RenderGraph::allocateTransientImages: FAILED TO ALLOCATE TRANSIENT MEMORY");
+
+        for (auto &transient : slot.resources)
+        {
+            if (vmaBindImageMemory(device.getAllocator(), slot.allocation, resources[transient].image) != VK_SUCCESS)
+                throw std::runtime_error("zh::RenderGraph::allocateTransientImages: FAILED TO BIND TRANSIENT MEMORY");
+        }
+    }
+
+    for (auto &transient : transients)
+    {
+        ResourceNode &resource = resources[transient];
+
+        VkImageViewCreateInfo view_info{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+        view_info.image = resource.image;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = resource.format;
+        view_info.subresourceRange = {getViewAspect(resource.format), 0, 1, 0, 1};
+
+        if (vkCreateImageView(device.getLogicalDevice(), &view_info, nullptr, &resource.view) != VK_SUCCESS)
+            throw std::runtime_error("zh::RenderGraph::allocateTransientImages: FAILED TO CREATE IMAGE VIEW " +
+                                     resource.name);
+    }
+}
+
+void zh::RenderGraph::planBarriers()
+{
+    // Hazard tracking state of a resource while walking the live passes.
+    struct Track
+    {
+        VkImageLayout layout;
+        VkPipelineStageFlags2 writeStages;
+        VkAccessFlags2 writeAccess;
+        VkPipelineStageFlags2 readStages;
+        VkPipelineStageFlags2 visibleStages;
+        VkAccessFlags2 visibleAccess;
+    };
+
+    // How each transient image is last used. Aliased images wait on every image sharing their memory, including
+    // themselves from the previous execution, since barriers also order against earlier submissions.
+    std::vector<ResourceState> last_uses(resources.size());
+
+    for (int i = 0; i < passes.size(); ++i)
+    {
+        if (passes[i].isCulled)
+            continue;
+
+        for (auto &access : passes[i].accesses)
+        {
+            if (resources[access.resource].lastPass != i)
+                continue;
+
+            const ResourceState state = getState(passes[i].type, access.usage);
+            last_uses[access.resource].stages |= state.stages;
+            last_uses[access.resource].access |= state.access & WRITE_ACCESS_MASK;
+        }
+    }
+
+    std::vector<Track> tracks(resources.size());
+
+    for (Resource i = 0; i < resources.size(); ++i)
+    {
+        ResourceNode &resource = resources[i];
+        Track &track = tracks[i];
+        track = {};
+
+        if (resource.isImported)
+        {
+            track.layout = resource.initialState.layout;
+            track.writeStages = resource.initialState.stages;
+            track.writeAccess = resource.initialState.access & WRITE_ACCESS_MASK;
+        }
+        else if (resource.memorySlot >= 0)
+        {
+            track.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            for (auto &alias : memorySlots[resource.memorySlot].resources)
+            {
+                track.writeStages |= last_uses[alias].stages;
+                track.writeAccess |= last_uses[alias].access;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < passes.size(); ++i)
+    {
+        PassNode &pass = passes[i];
+
+        if (pass.isCulled)
+            continue;
+
+        Step step{i};
+
+        // A pass using a resource in several ways needs one state covering all of them.
+        std::vector<Resource> order;
+        std::unordered_map<Resource, std::pair<ResourceState, bool>> states;
+
+        for (auto &access : pass.accesses)
+        {
+            const ResourceState state = getState(pass.type, access.usage);
+
+            if (states.count(access.resource) == 0)
+            {
+                order.push_back(access.resource);
+                states[access.resource] = {state, access.isWrite};
+                continue;
+            }
+
+            auto &merged = states[access.resource];
+            merged.first.stages |= state.stages;
+            merged.first.access |= state.access;
+            merged.second |= access.isWrite;
+
+            if (merged.first.layout != state.layout)
+                merged.first.layout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        for (auto &resource : order)
+        {
+            const ResourceState &next = states[resource].first;
+            const bool is_write = states[resource].second;
+            Track &track = tracks[resource];
+
+            const bool is_layout_change = resources[resource].isImage && track.layout != next.layout;
+
+            if (!is_write && !is_layout_change)
+            {
+                // Reads after reads, and reads of data already made visible to these stages, need nothing.
+                const bool is_visible =
+                    (next.stages & ~track.visibleStages) == 0 && (next.access & ~track.visibleAccess) == 0;
+
+                if (track.writeStages != VK_PIPELINE_STAGE_2_NONE && !is_visible)
+                {
+                    step.barriers.push_back(
+                        {resource, {track.writeStages, track.writeAccess, track.layout}, next});
+
+                    track.visibleStages |= next.stages;
+                    track.visibleAccess |= next.access;
+                }
+
+                track.readStages |= next.stages;
+                continue;
+            }
+
+            // Writes wait for earlier writes and, without needing their memory, for earlier reads.
+            const ResourceState source{track.writeStages | track.readStages, track.writeAccess, track.layout};
+
+            if (is_layout_change || source.stages != VK_PIPELINE_STAGE_2_NONE)
+                step.barriers.push_back({resource, source, next});
+
+            track.layout = next.layout;
+            track.writeStages = next.stages;
+            track.writeAccess = is_write ? next.access & WRITE_ACCESS_MASK : VK_ACCESS_2_NONE;
+            track.readStages = is_write ? VK_PIPELINE_STAGE_2_NONE : next.stages;
+            track.visibleStages = is_write ? VK_PIPELINE_STAGE_2_NONE : next.stages;
+            track.visibleAccess = is_write ? VK_ACCESS_2_NONE : next.access;
+        }
+
+        planAttachments(step);
+        steps.push_back(step);
+    }
+
+    for (Resource i = 0; i < resources.size(); ++i)
+    {
+        ResourceNode &resource = resources[i];
+        Track &track = tracks[i];
+
+        if (!resource.isImported || !resource.isImage || resource.finalState.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+            continue;
+
+        if (track.layout == resource.finalState.layout && resource.finalState.stages == VK_PIPELINE_STAGE_2_NONE)
+            continue;
+
+        finalBarriers.push_back(
+            {i, {track.writeStages | track.readStages, track.writeAccess, track.layout}, resource.finalState});
+    }
+}
+
+void zh::RenderGraph::planAttachments(Step &step)
+{
+    PassNode &pass = passes[step.pass];
+
+    if (pass.type != PassType::Graphics)
+        return;
+
+    // Contents are only loaded if something put them there, and only stored if something uses them afterwards.
+    auto is_written_before = [this, &step](const Resource resource) {
+        if (resources[resource].isImported)
+            return resources[resource].initialState.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+
+        for (uint32_t i = 0; i < step.pass; ++i)
+        {
+            if (passes[i].isCulled)
+                continue;
+
+            for (auto &access : passes[i].accesses)
+            {
+                if (access.isWrite && access.resource == resource)
+                    return true;
+            }
+        }
+
+        return false;
+    };
+
+    auto is_used_after = [this, &step](const Resource resource) {
+        return resources[resource].isImported || resources[resource].lastPass > static_cast<int>(step.pass);
+    };
+
+    for (auto &access : pass.accesses)
+    {
+        const bool is_color = access.usage == Usage::ColorAttachment;
+        const bool is_depth = access.usage == Usage::DepthAttachment || access.usage == Usage::DepthRead;
+
+        if (!is_color && !is_depth)
+            continue;
+
+        Attachment attachment{access.resource};
+        attachment.layout = getState(pass.type, access.usage).layout;
+        attachment.clearValue = {};
+
+        // Matches the layout the barriers moved the image to when the pass also uses it in other ways.
+        for (auto &other : pass.accesses)
+        {
+            if (other.resource == access.resource && getState(pass.type, other.usage).layout != attachment.layout)
+                attachment.layout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        auto clear_value = pass.clearValues.find(access.resource);
+
+        if (clear_value != pass.clearValues.end())
+        {
+            attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            attachment.clearValue = clear_value->second;
+        }
+        else
+        {
+            attachment.loadOp =
+                is_written_before(access.resource) ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        }
+
+        if (!access.isWrite)
+            attachment.storeOp = VK_ATTACHMENT_STORE_OP_NONE;
+        else
+            attachment.storeOp =
+                is_used_after(access.resource) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+        if (is_color)
+            step.colorAttachments.push_back(attachment);
+        else
+            step.depthAttachment = attachment;
+
+        step.renderArea = resources[access.resource].extent;
+    }
+}
+
+void zh::RenderGraph::recordBarriers(VkCommandBuffer &command_buffer, const std::vector<Barrier> &barriers)
+{
+    if (barriers.empty())
+        return;
+
+    std::vector<VkImageMemoryBarrier2> image_barriers;
+    std::vector<VkBufferMemoryBarrier2> buffer_barriers;
+
+    for (auto &barrier : barriers)
+    {
+        ResourceNode &resource = resources[barrier.resource];
+
+        if (resource.isImage)
+        {
+            VkImageMemoryBarrier2 image_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+            image_barrier.srcStageMask = barrier.source.stages;
+            image_barrier.srcAccessMask = barrier.source.access;
+            image_barrier.dstStageMask = barrier.destination.stages;
+            image_barrier.dstAccessMask = barrier.destination.access;
+            image_barrier.oldLayout = barrier.source.layout;
+            image_barrier.newLayout = barrier.destination.layout;
+            image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image_barrier.image = resource.image;
+            image_barrier.subresourceRange = {getAspect(resource.format), 0, VK_REMAINING_MIP_LEVELS, 0,
+                                              VK_REMAINING_ARRAY_LAYERS};
+
+            image_barriers.push_back(image_barrier);
+        }
+        else
+        {
+            VkBufferMemoryBarrier2 buffer_barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+            buffer_barrier.srcStageMask = barrier.source.stages;
+            buffer_barrier.srcAccessMask = barrier.source.access;
+            buffer_barrier.dstStageMask = barrier.destination.stages;
+            buffer_barrier.dstAccessMask = barrier.destination.access;
+            buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buffer_barrier.buffer = resource.buffer;
+            buffer_barrier.offset = 0;
+            buffer_barrier.size = VK_WHOLE_SIZE;
+
+            buffer_barriers.push_back(buffer_barrier);
+        }
+    }
+
+    VkDependencyInfo dependency_info{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependency_info.imageMemoryBarrierCount = static_cast<uint32_t>(image_barriers.size());
+    dependency_info.pImageMemoryBarriers = image_barriers.empty() ? nullptr : image_barriers.data();
+    dependency_info.bufferMemoryBarrierCount = static_cast<uint32_t>(buffer_barriers.size());
+    dependency_info.pBufferMemoryBarriers = buffer_barriers.empty() ? nullptr : buffer_barriers.data();
+
+    vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+    ZH_STAT_ADD(Barriers, image_barriers.size() + buffer_barriers.size());
+}
+
+void zh::RenderGraph::destroyTransientImages()
+{
+    std::vector<VkImageView> views;
+    std::vector<VkImage> images;
+    std::vector<VmaAllocation> allocations;
+
+    for (auto &resource : resources)
+    {
+        if (resource.isImported || resource.image == VK_NULL_HANDLE)
+            continue;
+
+        if (resource.view != VK_NULL_HANDLE)
+            views.push_back(resource.view);
+
+        images.push_back(resource.image);
+        resource.view = VK_NULL_HANDLE;
+        resource.image = VK_NULL_HANDLE;
+    }
+
+    for (auto &slot : memorySlots)
+    {
+        if (slot.allocation != VK_NULL_HANDLE)
+            allocations.push_back(slot.allocation);
+    }
+
+    memorySlots.clear();
+
+    if (images.empty() && allocations.empty())
+        return;
+
+    // Frames in flight may still render into them, and aliased images share allocations, so they go as one.
+    VkDevice logical_device = device.getLogicalDevice();
+    VmaAllocator allocator = device.getAllocator();
+
+    device.getDeletionQueue().push([logical_device, allocator, views, images, allocations]() {
+        for (auto &view : views)
+            vkDestroyImageView(logical_device, view, nullptr);
+
+        for (auto &image : images)
+            vkDestroyImage(logical_device, image, nullptr);
+
+        for (auto &allocation : allocations)
+            vmaFreeMemory(allocator, allocation);
+    });
+}
+
+const zh::RenderGraph::ResourceState zh::RenderGraph::getState(const PassType type, const Usage usage) const
+{
+    const VkPipelineStageFlags2 shader_stages = type == PassType::Compute
+                                                    ? VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT
+                                                    : VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                                                          VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+    const VkPipelineStageFlags2 fragment_tests =
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+
+    switch (usage)
+    {
+    case Usage::ColorAttachment:
+        return {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    case Usage::DepthAttachment:
+        return {fragment_tests,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+    case Usage::DepthRead:
+        return {fragment_tests, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+    case Usage::Sampled:
+        return {shader_stages, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    case Usage::StorageRead:
+        return {shader_stages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL};
+    case Usage::StorageWrite:
+        return {shader_stages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                VK_IMAGE_LAYOUT_GENERAL};
+    case Usage::TransferSource:
+        return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+    case Usage::TransferDestination:
+        return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
+    case Usage::Uniform:
+        return {shader_stages, VK_ACCESS_2_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+    case Usage::Vertex:
+        return {VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED};
+    case Usage::Index:
+        return {VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+    case Usage::Indirect:
+        return {VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED};
+    }
+
+    throw std::runtime_error("zh::RenderGraph::getState: UNKNOWN USAGE");
+}
+
+const bool zh::RenderGraph::isWriteUsage(const Usage usage)
+{
+    return usage == Usage::ColorAttachment || usage == Usage::DepthAttachment || usage == Usage::StorageWrite ||
+           usage == Usage::TransferDestination;
+}
+
+const VkImageUsageFlags zh::RenderGraph::getImageUsage(const Usage usage)
+{
+    switch (usage)
+    {
+    case Usage::ColorAttachment:
+        return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    case Usage::DepthAttachment:
+    case Usage::DepthRead:
+        return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    case Usage::Sampled:
+        return VK_IMAGE_USAGE_SAMPLED_BIT;
+    case Usage::StorageRead:
+    case Usage::StorageWrite:
+        return VK_IMAGE_USAGE_STORAGE_BIT;
+    case Usage::TransferSource:
+        return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    case Usage::TransferDestination:
+        return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    default:
+        return 0;
+    }
+}
+
+const VkImageAspectFlags zh::RenderGraph::getAspect(const VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+const VkImageAspectFlags zh::RenderGraph::getViewAspect(const VkFormat format)
+{
+    const VkImageAspectFlags aspect = getAspect(format);
+
+    return (aspect & VK_IMAGE_ASPECT_DEPTH_BIT) != 0 ? VK_IMAGE_ASPECT_DEPTH_BIT : aspect;
+}
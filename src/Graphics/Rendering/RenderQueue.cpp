@@ -0,0 +1,278 @@
+#include "stdafx.hpp"
+#include "Graphics/Rendering/RenderQueue.hpp"
+#include "System/Profiling/RenderStats.hpp"
+
+zh::RenderQueue::RenderQueue(Device &device) : device(device), isSorted(false)
+{
+}
+
+void zh::RenderQueue::push(const Pass pass, Pipeline &pipeline, VkDescriptorSet descriptor_set, Model &model,
+                           const glm::mat4 &transform, const float depth)
+{
+    auto [it, _] = descriptorSetIds.try_emplace(descriptor_set, static_cast<uint32_t>(descriptorSetIds.size()));
+
+    keys.push_back(makeKey(pass, pipeline.getId(), it->second, model.getId(), depth));
+    order.push_back(static_cast<uint32_t>(items.size()));
+    items.push_back(DrawItem{&pipeline, descriptor_set, &model, transform});
+    isSorted = false;
+}
+
+void zh::RenderQueue::sort()
+{
+    if (isSorted)
+        return;
+
+    radixSort();
+    buildBatches();
+    buildDraws();
+    isSorted = true;
+}
+
+void zh::RenderQueue::record(VkCommandBuffer &command_buffer, const size_t first_draw, const size_t draw_count,
+                             VkBuffer indirect_buffer, const VkDeviceSize indirect_offset) const
+{
+    assert(first_draw + draw_count <= draws.size() && "zh::RenderQueue::record: DRAW RANGE OUT OF BOUNDS");
+
+    const bool multi_draw = device.getEnabledFeatures().multiDrawIndirect;
+    const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    Pipeline *bound_pipeline = nullptr;
+    VkDescriptorSet bound_descriptor_set = VK_NULL_HANDLE;
+    const void *bound_geometry = nullptr;
+
+    for (size_t i = first_draw; i < first_draw + draw_count; ++i)
+    {
+        const Draw &draw = draws[i];
+
+        if (draw.pipeline != bound_pipeline)
+        {
+            draw.pipeline->bind(command_buffer);
+            bound_pipeline = draw.pipeline;
+            bound_descriptor_set = VK_NULL_HANDLE; // A new layout may disturb the bound set.
+        }
+
+        if (draw.descriptorSet != bound_descriptor_set && draw.descriptorSet != VK_NULL_HANDLE)
+        {
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline->getLayout(), 0, 1,
+                                    &draw.descriptorSet, 0, nullptr);
+            bound_descriptor_set = draw.descriptorSet;
+            ZH_STAT_INCREMENT(DescriptorBinds);
+        }
+
+        if (draw.arena != nullptr && indirect_buffer != VK_NULL_HANDLE)
+        {
+            if (bound_geometry != draw.arena)
+            {
+                draw.arena->bind(command_buffer);
+                bound_geometry = draw.arena;
+            }
+
+            const VkDeviceSize offset = indirect_offset + draw.firstBatch * stride;
+
+            if (multi_draw)
+            {
+                vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer, offset, draw.batchCount, stride);
+                ZH_STAT_INCREMENT(DrawCalls);
+            }
+            else
+            {
+                for (uint32_t j = 0; j < draw.batchCount; ++j)
+                    vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer, offset + j * stride, 1, stride);
+                ZH_STAT_ADD(DrawCalls, draw.batchCount);
+            }
+
+#ifdef AZHA_ENABLE_RENDER_STATS
+            for (uint32_t j = draw.firstBatch; j < draw.firstBatch + draw.batchCount; ++j)
+            {
+                const VkDrawIndexedIndirectCommand &command = indirectCommands[j];
+                ZH_STAT_ADD(Instances, command.instanceCount);
+                ZH_STAT_ADD(Triangles, uint64_t(command.indexCount / 3) * command.instanceCount);
+            }
+#endif
+
+            continue;
+        }
+
+        for (uint32_t j = draw.firstBatch; j < draw.firstBatch + draw.batchCount; ++j)
+        {
+            const Batch &batch = batches[j];
+            const void *geometry = batch.model->getArena() != nullptr ? static_cast<const void *>(batch.model->getArena())
+                                                                      : static_cast<const void *>(batch.model);
+
+            if (bound_geometry != geometry)
+            {
+                batch.model->bind(command_buffer);
+                bound_geometry = geometry;
+            }
+
+            batch.model->draw(command_buffer, batch.instanceCount, batch.firstInstance);
+        }
+    }
+}
+
+void zh::RenderQueue::record(VkCommandBuffer &command_buffer, VkBuffer indirect_buffer,
+                             const VkDeviceSize indirect_offset) const
+{
+    record(command_buffer, 0, draws.size(), indirect_buffer, indirect_offset);
+}
+
+void zh::RenderQueue::clear()
+{
+    items.clear();
+    keys.clear();
+    order.clear();
+    descriptorSetIds.clear();
+    batches.clear();
+    draws.clear();
+    instances.clear();
+    indirectCommands.clear();
+    isSorted = false;
+}
+
+const size_t zh::RenderQueue::getSize() const
+{
+    return items.size();
+}
+
+const std::vector<zh::RenderQueue::Batch> &zh::RenderQueue::getBatches() const
+{
+    return batches;
+}
+
+const std::vector<zh::RenderQueue::Draw> &zh::RenderQueue::getDraws() const
+{
+    return draws;
+}
+
+const std::vector<InstanceData> &zh::RenderQueue::getInstances() const
+{
+    return instances;
+}
+
+const std::vector<VkDrawIndexedIndirectCommand> &zh::RenderQueue::getIndirectCommands() const
+{
+    return indirectCommands;
+}
+
+const uint64_t zh::RenderQueue::makeKey(const Pass pass, const uint32_t pipeline_id, const uint32_t descriptor_set_id,
+                                        const uint32_t model_id, const float depth)
+{
+    // The bit pattern of a non negative float grows with its value, so its top bits are a valid depth key.
+    uint32_t depth_bits = 0;
+    const float clamped_depth = std::max(depth, 0.f);
+    std::memcpy(&depth_bits, &clamped_depth, sizeof(depth_bits));
+    depth_bits >>= 11;
+
+    const uint64_t pass_bits = (static_cast<uint64_t>(pass) & 0xF) << 60;
+    const uint64_t state_bits = (static_cast<uint64_t>(pipeline_id) & 0xFFF) << 28 |
+                                (static_cast<uint64_t>(descriptor_set_id) & 0xFFF) << 16 |
+                                (static_cast<uint64_t>(model_id) & 0xFFFF);
+
+    if (pass == Pass::Transparent)
+        return pass_bits | (static_cast<uint64_t>(~depth_bits) & 0xFFFFF) << 40 | state_bits;
+
+    return pass_bits | state_bits << 20 | (static_cast<uint64_t>(depth_bits) & 0xFFFFF);
+}
+
+void zh::RenderQueue::radixSort()
+{
+    const size_t count = keys.size();
+
+    if (count < 2)
+        return;
+
+    keysScratch.resize(count);
+    orderScratch.resize(count);
+
+    // Build every histogram in one read of the keys.
+    std::array<std::array<uint32_t, 256>, 8> histograms{};
+
+    for (auto &key : keys)
+    {
+        for (int pass = 0; pass < 8; ++pass)
+            ++histograms[pass][(key >> (pass * 8)) & 0xFF];
+    }
+
+    for (int pass = 0; pass < 8; ++pass)
+    {
+        auto &histogram = histograms[pass];
+        const int shift = pass * 8;
+
+        // Every key shares this byte, the pass would not move anything.
+        if (histogram[(keys[0] >> shift) & 0xFF] == count)
+            continue;
+
+        uint32_t sum = 0;
+        for (auto &bucket : histogram)
+        {
+            const uint32_t bucket_count = bucket;
+            bucket = sum;
+            sum += bucket_count;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint32_t destination = histogram[(keys[i] >> shift) & 0xFF]++;
+            keysScratch[destination] = keys[i];
+            orderScratch[destination] = order[i];
+        }
+
+        std::swap(keys, keysScratch);
+        std::swap(order, orderScratch);
+    }
+}
+
+void zh::RenderQueue::buildBatches()
+{
+    batches.clear();
+    instances.clear();
+    instances.reserve(order.size());
+
+    const uint64_t transparent = static_cast<uint64_t>(Pass::Transparent);
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        const DrawItem &item = items[order[i]];
+        Batch *batch = batches.empty() ? nullptr : &batches.back();
+
+        if (batch == nullptr || batch->pipeline != item.pipeline || batch->descriptorSet != item.descriptorSet ||
+            batch->model != item.model || keys[i] >> 60 == transparent)
+        {
+            batches.push_back(Batch{item.pipeline, item.descriptorSet, item.model,
+                                    static_cast<uint32_t>(instances.size()), 0});
+            batch = &batches.back();
+        }
+
+        ++batch->instanceCount;
+        instances.push_back(InstanceData{item.transform});
+    }
+}
+
+void zh::RenderQueue::buildDraws()
+{
+    draws.clear();
+    indirectCommands.clear();
+    indirectCommands.reserve(batches.size());
+
+    // Indirect commands can only address per object data through firstInstance when the device allows it.
+    const bool indirect = device.getEnabledFeatures().drawIndirectFirstInstance;
+
+    for (uint32_t i = 0; i < batches.size(); ++i)
+    {
+        const Batch &batch = batches[i];
+        GeometryArena *arena = indirect && batch.model->isIndexed() ? batch.model->getArena() : nullptr;
+
+        indirectCommands.push_back(batch.model->getIndirectCommand(batch.instanceCount, batch.firstInstance));
+
+        Draw *draw = draws.empty() ? nullptr : &draws.back();
+
+        if (arena != nullptr && draw != nullptr && draw->arena == arena && draw->pipeline == batch.pipeline &&
+            draw->descriptorSet == batch.descriptorSet)
+        {
+            ++draw->batchCount;
+            continue;
+        }
+
+        draws.push_back(Draw{batch.pipeline, batch.descriptorSet, batch.model, arena, i, 1});
+    }
+}
@@ -1,25 +1,92 @@
 #include "stdafx.hpp"
 #include "Graphics/Rendering/Renderer.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
+#include "System/Profiling/RenderStats.hpp"
 
-zh::Renderer::Renderer(Device &device, Window &window) : device(device), window(window)
+zh::Renderer::Renderer(Device &device, Window &window, const Swapchain::Settings &settings)
+    : device(device), window(&window), settings(settings), target(nullptr), renderQueue(device),
+      swapchainGeneration(0), currentImageIndex(0), currentFrameIndex(0), isFrameStarted(false),
+      isImageRendered(false), previousStatsPass(0)
 {
     recreateSwapchain();
-    createCommandBuffers();
+    createFrameContexts();
+
+    framePacer = std::make_unique<FramePacer>(device, settings.pacingPolicy, settings.framesInFlight);
+    gpuProfiler = std::make_unique<GpuProfiler>(device, settings.framesInFlight);
+    pipelineStatistics = std::make_unique<PipelineStatistics>(device, settings.framesInFlight);
+}
+
+zh::Renderer::Renderer(Device &device, const OffscreenTarget::Settings &settings)
+    : device(device), window(nullptr),
+      settings(Swapchain::Settings{settings.framesInFlight, settings.imageCount, FramePacer::Policy::Throughput}),
+      target(nullptr), renderQueue(device), swapchainGeneration(0), currentImageIndex(0), currentFrameIndex(0),
+      isFrameStarted(false), isImageRendered(false), previousStatsPass(0)
+{
+    offscreenTarget = std::make_unique<OffscreenTarget>(device, settings);
+    target = offscreenTarget.get();
+    ++swapchainGeneration;
+
+    createFrameContexts();
+
+    framePacer = std::make_unique<FramePacer>(device, this->settings.pacingPolicy, this->settings.framesInFlight);
+    gpuProfiler = std::make_unique<GpuProfiler>(device, this->settings.framesInFlight);
+    pipelineStatistics = std::make_unique<PipelineStatistics>(device, this->settings.framesInFlight);
 }
 
 zh::Renderer::~Renderer()
 {
-    freeCommandBuffers();
+    // Frame contexts destroy their command pools right away.
+    vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+zh::Swapchain &zh::Renderer::getSwapchain()
+{
+    if (swapchain == nullptr)
+        throw std::runtime_error("zh::Renderer::getSwapchain: A HEADLESS RENDERER HAS NO SWAPCHAIN");
+
+    return *swapchain;
+}
+
+zh::OffscreenTarget &zh::Renderer::getOffscreenTarget()
+{
+    if (offscreenTarget == nullptr)
+        throw std::runtime_error("zh::Renderer::getOffscreenTarget: ONLY A HEADLESS RENDERER HAS AN OFFSCREEN TARGET");
+
+    return *offscreenTarget;
+}
+
+zh::RenderTarget &zh::Renderer::getRenderTarget()
+{
+    return *target;
 }
 
-VkRenderPass &zh::Renderer::getSwapchainRenderPass() const
+const bool zh::Renderer::isHeadless() const
 {
-    return swapchain->getRenderPass();
+    return window == nullptr;
+}
+
+const VkExtent2D zh::Renderer::getExtent() const
+{
+    return target->getExtent();
+}
+
+const uint32_t zh::Renderer::getImageIndex() const
+{
+    if (!isFrameStarted)
+        throw std::runtime_error(
+            "zh::Renderer::getImageIndex: GETTING IMAGE INDEX IS ALLOWED ONLY WHEN FRAME IS IN PROGRESS");
+
+    return currentImageIndex;
+}
+
+const uint64_t zh::Renderer::getSwapchainGeneration() const
+{
+    return swapchainGeneration;
 }
 
 const float zh::Renderer::getAspectRatio() const
 {
-    return swapchain->getAspectRatio();
+    return target->getAspectRatio();
 }
 
 const bool zh::Renderer::isFrameInProgress() const
@@ -33,7 +100,7 @@ VkCommandBuffer zh::Renderer::getCurrentCommandBuffer()
         throw std::runtime_error(
             "zh::Renderer::getCurrentCommandBuffer: GETTING COMMAND BUFFER IS ALLOWED ONLY WHEN FRAME IS IN PROGRESS");
 
-    return commandBuffers[currentFrameIndex];
+    return frames[currentFrameIndex]->getCommandBuffer();
 }
 
 const int zh::Renderer::getFrameIndex() const
@@ -45,12 +112,45 @@ const int zh::Renderer::getFrameIndex() const
     return currentFrameIndex;
 }
 
+const uint32_t zh::Renderer::getFramesInFlight() const
+{
+    return settings.framesInFlight;
+}
+
+zh::FramePacer &zh::Renderer::getFramePacer()
+{
+    return *framePacer;
+}
+
+zh::GpuProfiler &zh::Renderer::getGpuProfiler()
+{
+    return *gpuProfiler;
+}
+
+zh::PipelineStatistics &zh::Renderer::getPipelineStatistics()
+{
+    return *pipelineStatistics;
+}
+
+zh::FrameContext &zh::Renderer::getFrameContext()
+{
+    if (!isFrameStarted)
+        throw std::runtime_error(
+            "zh::Renderer::getFrameContext: GETTING FRAME CONTEXT IS ALLOWED ONLY WHEN FRAME IS IN PROGRESS");
+
+    return *frames[currentFrameIndex];
+}
+
 VkCommandBuffer zh::Renderer::beginFrame()
 {
+    ZH_PROFILE_SCOPE("zh::Renderer::beginFrame");
+
     if (isFrameStarted)
         throw std::runtime_error("zh::Renderer::beginFrame: CANNOT BEGIN FRAME WHEN ANOTHER FRAME IS IN PROGRESS");
 
-    auto result = swapchain->acquireNextImage(&currentImageIndex);
+    framePacer->waitForFrameStart(getSwapchainHandle());
+
+    auto result = target->acquireNextImage(&currentImageIndex);
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
@@ -61,32 +161,80 @@ VkCommandBuffer zh::Renderer::beginFrame()
     if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
         throw std::runtime_error("zh::Renderer::beginFrame: FAILED TO ACQUIRE SWAPCHAIN IMAGE");
 
+    // Once an image has been acquired from the new swapchain, the presentation engine is done with the presents
+    // queued to the old ones. They still hand their resources to the deletion queue rather than destroying them, so
+    // they go once this frame has completed too.
+    retiredSwapchains.clear();
+
     isFrameStarted = true;
+    isImageRendered = false;
+
+    // Frame slots follow the device frame timeline, so they stay in step with the swapchain across recreation.
+    currentFrameIndex = target->getFrameIndex();
+
+    // The frame that last used this slot has completed, so nothing it recorded or allocated is in use anymore.
+    frames[currentFrameIndex]->reset();
+    device.getDeletionQueue().collect();
 
     auto command_buffer = getCurrentCommandBuffer();
     VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
         throw std::runtime_error("zh::Renderer::beginFrame FAILED TO BEGIN RECORDING COMMAND BUFFER");
 
+    framePacer->beginFrame(command_buffer, currentFrameIndex);
+    gpuProfiler->beginFrame(command_buffer, currentFrameIndex);
+    pipelineStatistics->beginFrame(command_buffer, currentFrameIndex);
+
     return command_buffer;
 }
 
 void zh::Renderer::endFrame()
 {
+    ZH_PROFILE_SCOPE("zh::Renderer::endFrame");
+
     if (!isFrameStarted)
         throw std::runtime_error("zh::Renderer::endFrame: CANNOT END FRAME WHEN NO FRAME IS IN PROGRESS");
 
     auto command_buffer = getCurrentCommandBuffer();
 
+    // The one transition out of the attachment layout. The present, or a readback of an offscreen image, waits for
+    // the whole submission, so no destination stage is needed.
+    VkImageMemoryBarrier2 present_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    present_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    present_barrier.srcAccessMask = isImageRendered ? VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT : VK_ACCESS_2_NONE;
+    present_barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+    present_barrier.dstAccessMask = VK_ACCESS_2_NONE;
+    present_barrier.oldLayout = isImageRendered ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    present_barrier.newLayout = target->getFinalLayout();
+    present_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    present_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    present_barrier.image = target->getImage(currentImageIndex);
+    present_barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    VkDependencyInfo dependency_info{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependency_info.imageMemoryBarrierCount = 1;
+    dependency_info.pImageMemoryBarriers = &present_barrier;
+
+    vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+    ZH_STAT_INCREMENT(Barriers);
+
+    framePacer->endFrame(command_buffer, currentFrameIndex);
+
     if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
         throw std::runtime_error("zh::Renderer::endFrame: FAILED TO RECORD COMMAND BUFFER");
 
-    auto result = swapchain->submitCommandBuffers(command_buffer, currentImageIndex);
+    auto result = target->submitCommandBuffers(command_buffer, currentImageIndex);
+    framePacer->markSubmitted(getSwapchainHandle());
+
+    ZH_STAT_END_FRAME(device.getFrameTimeline().getSubmittedFrame());
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window.getFramebufferResized())
+    const bool is_resized = window != nullptr && window->getFramebufferResized();
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || is_resized)
     {
-        window.setFramebufferResized(false);
+        window->setFramebufferResized(false);
         recreateSwapchain();
     }
     else if (result != VK_SUCCESS)
@@ -95,103 +243,340 @@ void zh::Renderer::endFrame()
     }
 
     isFrameStarted = false;
-    currentFrameIndex = (currentFrameIndex + 1) % Swapchain::MAX_FRAMES_IN_FLIGHT;
 }
 
-void zh::Renderer::beginSwapchainRenderPass(VkCommandBuffer &command_buffer)
+void zh::Renderer::beginSwapchainRenderPass(VkCommandBuffer &command_buffer, const bool clear,
+                                            const VkRenderingFlags flags)
 {
-    if (isFrameStarted)
+    if (!isFrameStarted)
         throw std::runtime_error("zh::Renderer::beginSwapchainRenderPass: CANNOT BEGIN SWAPCHAIN RENDER PASS WHEN "
-                                 "ANOTHER FRAME IS IN PROGRESS");
+                                 "NO FRAME IS IN PROGRESS");
 
     if (command_buffer != getCurrentCommandBuffer())
         throw std::runtime_error("zh::Renderer::beginSwapchainRenderPass: CANNOT BEGIN RENDER PASS ON A COMMAND BUFFER "
                                  "FROM A DIFFERENT FRAME");
 
-    VkRenderPassBeginInfo render_pass_info{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
-    render_pass_info.renderPass = swapchain->getRenderPass();
-    render_pass_info.framebuffer = swapchain->getFramebuffer(currentImageIndex);
+    // Spans until endSwapchainRenderPass(), so the draws recorded in between are counted to it.
+    previousStatsPass = ZH_STAT_BEGIN_PASS("swapchain");
+
+    // Clearing passes discard what the images held. Loading passes pick up the attachments from the previous pass of
+    // this frame, which left them in their attachment layouts, and wait for its writes; so does a clearing pass that
+    // follows one. Before the first pass of the frame there is nothing to keep or wait for.
+    std::array<VkImageMemoryBarrier2, 2> barriers{};
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barriers[0].srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    barriers[0].srcAccessMask = isImageRendered ? VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT : VK_ACCESS_2_NONE;
+    barriers[0].dstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+    barriers[0].oldLayout = clear || !isImageRendered ? VK_IMAGE_LAYOUT_UNDEFINED
+                                                      : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = target->getImage(currentImageIndex);
+    barriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barriers[1].srcStageMask =
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    barriers[1].srcAccessMask = isImageRendered ? VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_2_NONE;
+    barriers[1].dstStageMask =
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    barriers[1].dstAccessMask =
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barriers[1].oldLayout = clear || !isImageRendered ? VK_IMAGE_LAYOUT_UNDEFINED
+                                                      : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].image = target->getDepthImage(currentImageIndex);
+    barriers[1].subresourceRange = {getDepthAspect(), 0, 1, 0, 1};
+
+    VkDependencyInfo dependency_info{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependency_info.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+    dependency_info.pImageMemoryBarriers = barriers.data();
+
+    vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+    ZH_STAT_ADD(Barriers, barriers.size());
+
+    VkRenderingAttachmentInfo color_attachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+    color_attachment.imageView = target->getImageView(currentImageIndex);
+    color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    color_attachment.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    color_attachment.clearValue.color = {0.01f, 0.01f, 0.01f, 1.0f};
+
+    // Depth is stored so it can feed the occlusion culling pyramid between passes.
+    VkRenderingAttachmentInfo depth_attachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+    depth_attachment.imageView = target->getDepthImageView(currentImageIndex);
+    depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depth_attachment.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+    depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depth_attachment.clearValue.depthStencil = {1.0f, 0};
+
+    VkRenderingInfo rendering_info{VK_STRUCTURE_TYPE_RENDERING_INFO};
+    rendering_info.flags = flags;
+    rendering_info.renderArea.offset = {0, 0};
+    rendering_info.renderArea.extent = target->getExtent();
+    rendering_info.layerCount = 1;
+    rendering_info.colorAttachmentCount = 1;
+    rendering_info.pColorAttachments = &color_attachment;
+    rendering_info.pDepthAttachment = &depth_attachment;
+
+    vkCmdBeginRendering(command_buffer, &rendering_info);
+    isImageRendered = true;
+
+    // Secondary command buffers set their own dynamic state.
+    if ((flags & VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT) == 0)
+        setViewportAndScissor(command_buffer);
+}
 
-    render_pass_info.renderArea.offset = {0, 0};
-    render_pass_info.renderArea.extent = swapchain->getExtent();
+void zh::Renderer::endSwapchainRenderPass(VkCommandBuffer &command_buffer)
+{
+    if (!isFrameStarted)
+        throw std::runtime_error(
+            "zh::Renderer::endSwapchainRenderPass: CANNOT END SWAPCHAIN RENDER PASS WHEN NO FRAME IS IN PROGRESS");
 
-    std::array<VkClearValue, 2> clear_values{};
-    clear_values[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
-    clear_values[1].depthStencil = {1.0f, 0};
-    render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
-    render_pass_info.pClearValues = clear_values.data();
+    if (command_buffer != getCurrentCommandBuffer())
+        throw std::runtime_error(
+            "zh::Renderer::endSwapchainRenderPass: CANNOT END RENDER PASS ON A COMMAND BUFFER FROM A DIFFERENT FRAME");
 
-    vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdEndRendering(command_buffer);
+    ZH_STAT_END_PASS(previousStatsPass);
+}
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapchain->getExtent().width);
-    viewport.height = static_cast<float>(swapchain->getExtent().height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
+zh::RenderQueue &zh::Renderer::getRenderQueue()
+{
+    return renderQueue;
+}
 
-    VkRect2D scissor{{0, 0}, swapchain->getExtent()};
+void zh::Renderer::queueObjects(const std::vector<Object *> &objects, Pipeline &pipeline,
+                                VkDescriptorSet descriptor_set, const Camera &camera, const RenderQueue::Pass pass)
+{
+    for (auto &object : objects)
+    {
+        if (object->getModel() == nullptr)
+            continue;
 
-    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
-    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+        const glm::vec3 center = object->getBounds().getCenter();
+        const float depth = (camera.getView() * glm::vec4(center, 1.f)).z;
+
+        renderQueue.push(pass, pipeline, descriptor_set, *object->getModel(), object->getTransform().mat4(), depth);
+    }
 }
 
-void zh::Renderer::endSwapchainRenderPass(VkCommandBuffer &command_buffer)
+void zh::Renderer::flushRenderQueue(VkCommandBuffer &command_buffer)
 {
-    if (isFrameStarted)
-        throw std::runtime_error(
-            "zh::Renderer::endSwapchainRenderPass: CANNOT END SWAPCHAIN RENDER PASS WHEN NO FRAME IS IN PROGRESS");
+    ZH_PROFILE_SCOPE("zh::Renderer::flushRenderQueue");
 
     if (command_buffer != getCurrentCommandBuffer())
         throw std::runtime_error(
-            "zh::Renderer::endSwapchainRenderPass: CANNOT END RENDER PASS ON A COMMAND BUFFER FROM A DIFFERENT FRAME");
+            "zh::Renderer::flushRenderQueue: CANNOT FLUSH RENDER QUEUE ON A COMMAND BUFFER FROM A DIFFERENT FRAME");
+
+    if (renderQueue.getSize() == 0)
+        return;
+
+    VkBuffer instance_buffer, indirect_buffer;
+    VkDeviceSize instance_offset, indirect_offset;
+    uploadRenderQueue(instance_buffer, instance_offset, indirect_buffer, indirect_offset);
+
+    vkCmdBindVertexBuffers(command_buffer, 1, 1, &instance_buffer, &instance_offset);
+    ZH_STAT_INCREMENT(BufferBinds);
 
-    vkCmdEndRenderPass(command_buffer);
+    renderQueue.record(command_buffer, indirect_buffer, indirect_offset);
+    renderQueue.clear();
 }
 
-void zh::Renderer::createCommandBuffers()
+void zh::Renderer::flushRenderQueueParallel(VkCommandBuffer &command_buffer)
 {
-    commandBuffers.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
+    ZH_PROFILE_SCOPE("zh::Renderer::flushRenderQueueParallel");
+
+    if (command_buffer != getCurrentCommandBuffer())
+        throw std::runtime_error("zh::Renderer::flushRenderQueueParallel: CANNOT FLUSH RENDER QUEUE ON A COMMAND "
+                                 "BUFFER FROM A DIFFERENT FRAME");
+
+    if (renderQueue.getSize() == 0)
+        return;
+
+    VkBuffer instance_buffer, indirect_buffer;
+    VkDeviceSize instance_offset, indirect_offset;
+    uploadRenderQueue(instance_buffer, instance_offset, indirect_buffer, indirect_offset);
+
+    // One contiguous range of draws per worker, so each worker command pool is only touched by a single task.
+    const size_t draw_count = renderQueue.getDraws().size();
+    FrameContext &frame = *frames[currentFrameIndex];
+    const size_t worker_count =
+        std::max<size_t>(1, std::min<size_t>(frame.getWorkerCount(), draw_count / MIN_DRAWS_PER_WORKER));
+    const size_t range_size = (draw_count + worker_count - 1) / worker_count;
+
+    std::vector<VkCommandBuffer> secondary_command_buffers(worker_count);
+    std::vector<VkResult> results(worker_count, VK_SUCCESS);
+
+    VkCommandBufferInheritanceRenderingInfo rendering_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+    rendering_info.colorAttachmentCount = 1;
+    rendering_info.pColorAttachmentFormats = &target->getImageFormat();
+    rendering_info.depthAttachmentFormat = target->getDepthFormat();
+    rendering_info.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+    rendering_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritance_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritance_info.pNext = &rendering_info;
+
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        // The command buffers are allocated here so that workers never grow the per frame vectors.
+        secondary_command_buffers[i] = frame.acquireSecondaryCommandBuffer(static_cast<uint32_t>(i));
+
+        threadPool->submit([&, i]() {
+            ZH_PROFILE_SCOPE("zh::Renderer::flushRenderQueueParallel: record");
+
+            VkCommandBuffer secondary = secondary_command_buffers[i];
+
+            VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+            begin_info.flags =
+                VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            begin_info.pInheritanceInfo = &inheritance_info;
+
+            results[i] = vkBeginCommandBuffer(secondary, &begin_info);
+            if (results[i] != VK_SUCCESS)
+                return;
+
+            setViewportAndScissor(secondary);
+            vkCmdBindVertexBuffers(secondary, 1, 1, &instance_buffer, &instance_offset);
+            ZH_STAT_INCREMENT(BufferBinds);
+
+            const size_t first_draw = std::min(i * range_size, draw_count);
+            const size_t count = std::min(range_size, draw_count - first_draw);
+            renderQueue.record(secondary, first_draw, count, indirect_buffer, indirect_offset);
+
+            results[i] = vkEndCommandBuffer(secondary);
+        });
+    }
 
-    VkCommandBufferAllocateInfo alloc_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
-    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    alloc_info.commandPool = device.getCommandPool();
-    alloc_info.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    threadPool->wait();
 
-    if (vkAllocateCommandBuffers(device.getLogicalDevice(), &alloc_info, commandBuffers.data()) != VK_SUCCESS)
-        throw std::runtime_error("zh::Renderer::createCommandBuffers: FAILED TO ALLOCATE COMMAND BUFFERS");
+    for (auto &result : results)
+    {
+        if (result != VK_SUCCESS)
+            throw std::runtime_error(
+                "zh::Renderer::flushRenderQueueParallel: FAILED TO RECORD SECONDARY COMMAND BUFFER");
+    }
+
+    vkCmdExecuteCommands(command_buffer, static_cast<uint32_t>(secondary_command_buffers.size()),
+                         secondary_command_buffers.data());
+    renderQueue.clear();
+}
+
+void zh::Renderer::executeCachedPass(VkCommandBuffer &command_buffer, CachedPass &pass, const uint64_t version,
+                                     const CachedPass::RecordFunction &record)
+{
+    if (command_buffer != getCurrentCommandBuffer())
+        throw std::runtime_error("zh::Renderer::executeCachedPass: CANNOT EXECUTE CACHED PASS ON A COMMAND BUFFER FROM "
+                                 "A DIFFERENT FRAME");
+
+    CachedPass::State state{version, Pipeline::getGeneration(), swapchainGeneration, target->getImageFormat(),
+                            target->getDepthFormat()};
+
+    VkCommandBuffer &secondary =
+        pass.get(currentFrameIndex, state, [this, &record](VkCommandBuffer &secondary, const int frame_index) {
+            setViewportAndScissor(secondary);
+            record(secondary, frame_index);
+        });
+
+    vkCmdExecuteCommands(command_buffer, 1, &secondary);
+}
+
+void zh::Renderer::createFrameContexts()
+{
+    threadPool = std::make_unique<ThreadPool>();
+
+    frames.resize(settings.framesInFlight);
+
+    for (auto &frame : frames)
+        frame = std::make_unique<FrameContext>(device, threadPool->getThreadCount());
+}
+
+void zh::Renderer::setViewportAndScissor(VkCommandBuffer &command_buffer)
+{
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(target->getExtent().width);
+    viewport.height = static_cast<float>(target->getExtent().height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor{{0, 0}, target->getExtent()};
+
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 }
 
-void zh::Renderer::freeCommandBuffers()
+const VkImageAspectFlags zh::Renderer::getDepthAspect() const
 {
-    vkFreeCommandBuffers(device.getLogicalDevice(), device.getCommandPool(),
-                         static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+    const VkFormat depth_format = target->getDepthFormat();
+    const bool has_stencil =
+        depth_format == VK_FORMAT_D32_SFLOAT_S8_UINT || depth_format == VK_FORMAT_D24_UNORM_S8_UINT;
 
-    commandBuffers.clear();
+    return has_stencil ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+void zh::Renderer::uploadRenderQueue(VkBuffer &instance_buffer, VkDeviceSize &instance_offset,
+                                     VkBuffer &indirect_buffer, VkDeviceSize &indirect_offset)
+{
+    renderQueue.sort();
+
+    auto &instances = renderQueue.getInstances();
+    auto &commands = renderQueue.getIndirectCommands();
+
+    const VkDeviceSize instance_size = instances.size() * sizeof(InstanceData);
+    Buffer &instances_buffer =
+        frames[currentFrameIndex]->allocateTransient(instance_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, instance_offset);
+    instances_buffer.write(const_cast<InstanceData *>(instances.data()), instance_size, instance_offset);
+    instance_buffer = instances_buffer.getBuffer();
+
+    const VkDeviceSize indirect_size = commands.size() * sizeof(VkDrawIndexedIndirectCommand);
+    Buffer &commands_buffer = frames[currentFrameIndex]->allocateTransient(
+        indirect_size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, indirect_offset);
+    commands_buffer.write(const_cast<VkDrawIndexedIndirectCommand *>(commands.data()), indirect_size,
+                          indirect_offset);
+    indirect_buffer = commands_buffer.getBuffer();
 }
 
 void zh::Renderer::recreateSwapchain()
 {
-    auto extent = window.getExtent();
+    ZH_PROFILE_SCOPE("zh::Renderer::recreateSwapchain");
+
+    auto extent = window->getExtent();
 
     while (extent.width == 0 || extent.height == 0)
     {
-        extent = window.getExtent();
+        extent = window->getExtent();
         glfwWaitEvents();
     }
-    vkDeviceWaitIdle(device.getLogicalDevice());
 
+    // No device wait. Frame completion alone does not retire the old swapchain: the presents queued to it, and the
+    // render finished semaphores they wait on, may still be pending. It is kept until the next acquire from the new
+    // one, see beginFrame.
     if (swapchain == nullptr)
     {
-        swapchain = std::make_unique<Swapchain>(device, window);
+        swapchain = std::make_unique<Swapchain>(device, *window, settings);
     }
     else
     {
-        std::shared_ptr<Swapchain> old_swapchain = std::move(swapchain);
-        swapchain = std::make_unique<Swapchain>(device, window, old_swapchain->getHandle());
+        retiredSwapchains.push_back(std::move(swapchain));
+        Swapchain &old_swapchain = *retiredSwapchains.back();
+        swapchain = std::make_unique<Swapchain>(device, *window, settings, old_swapchain.getHandle());
 
-        if (!old_swapchain->compareSwapFormats(*swapchain))
+        if (!old_swapchain.compareSwapFormats(*swapchain))
             throw std::runtime_error("zh::Renderer::recreateSwapchain: SWAPCHAIN IMAGE OR DEPTH FORMAT CHANGED");
     }
+
+    target = swapchain.get();
+    ++swapchainGeneration;
+}
+
+VkSwapchainKHR zh::Renderer::getSwapchainHandle() const
+{
+    return swapchain != nullptr ? swapchain->getHandle() : VK_NULL_HANDLE;
 }
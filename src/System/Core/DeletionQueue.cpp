@@ -0,0 +1,210 @@
+#include "stdafx.hpp"
+#include "System/Core/DeletionQueue.hpp"
+
+zh::DeletionQueue::DeletionQueue(VkDevice &device, VmaAllocator &allocator, FrameTimeline &timeline)
+    : device(device), allocator(allocator), timeline(timeline)
+{
+}
+
+zh::DeletionQueue::~DeletionQueue()
+{
+    flush();
+}
+
+void zh::DeletionQueue::push(std::unique_ptr<Buffer> buffer)
+{
+    if (buffer == nullptr)
+        return;
+
+    // Such a buffer queues its own handles when destroyed; holding it here would push from destroy() under the lock.
+    if (buffer->isDeferred())
+    {
+        buffer.reset();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().ownedBuffers.push_back(std::move(buffer));
+}
+
+void zh::DeletionQueue::push(VkBuffer buffer, VmaAllocation allocation)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().buffers.emplace_back(buffer, allocation);
+}
+
+void zh::DeletionQueue::push(VkImage image, VmaAllocation allocation)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().images.emplace_back(image, allocation);
+}
+
+void zh::DeletionQueue::push(VkImageView image_view)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().imageViews.push_back(image_view);
+}
+
+void zh::DeletionQueue::push(VkSampler sampler)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().samplers.push_back(sampler);
+}
+
+void zh::DeletionQueue::push(VkFramebuffer framebuffer)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().framebuffers.push_back(framebuffer);
+}
+
+void zh::DeletionQueue::push(VkRenderPass render_pass)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().renderPasses.push_back(render_pass);
+}
+
+void zh::DeletionQueue::push(VkPipeline pipeline)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().pipelines.push_back(pipeline);
+}
+
+void zh::DeletionQueue::push(VkPipelineLayout pipeline_layout)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().pipelineLayouts.push_back(pipeline_layout);
+}
+
+void zh::DeletionQueue::push(VkDescriptorSetLayout descriptor_set_layout)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().descriptorSetLayouts.push_back(descriptor_set_layout);
+}
+
+void zh::DeletionQueue::push(VkDescriptorPool descriptor_pool)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().descriptorPools.push_back(descriptor_pool);
+}
+
+void zh::DeletionQueue::push(VkDescriptorPool descriptor_pool, VkDescriptorSet descriptor_set)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().descriptorSets.emplace_back(descriptor_pool, descriptor_set);
+}
+
+void zh::DeletionQueue::push(VkSemaphore semaphore)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().semaphores.push_back(semaphore);
+}
+
+void zh::DeletionQueue::push(VkSwapchainKHR swapchain)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().swapchains.push_back(swapchain);
+}
+
+void zh::DeletionQueue::push(std::function<void()> deleter)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    getBatch().deleters.push_back(std::move(deleter));
+}
+
+void zh::DeletionQueue::collect()
+{
+    const uint64_t completed_frame = timeline.getCompletedFrame();
+
+    // Batches are in frame order, so stop at the first one still in flight.
+    std::lock_guard<std::mutex> lock(mutex);
+
+    while (!batches.empty() && batches.front().frame <= completed_frame)
+    {
+        destroy(batches.front());
+        batches.pop_front();
+    }
+}
+
+void zh::DeletionQueue::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto &batch : batches)
+        destroy(batch);
+
+    batches.clear();
+}
+
+const size_t zh::DeletionQueue::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t count = 0;
+    for (auto &batch : batches)
+        count += batch.size;
+
+    return count;
+}
+
+zh::DeletionQueue::Batch &zh::DeletionQueue::getBatch()
+{
+    const uint64_t frame = timeline.getPendingFrame();
+
+    if (batches.empty() || batches.back().frame != frame)
+    {
+        batches.emplace_back();
+        batches.back().frame = frame;
+    }
+
+    ++batches.back().size;
+    return batches.back();
+}
+
+void zh::DeletionQueue::destroy(Batch &batch)
+{
+    batch.ownedBuffers.clear();
+
+    for (auto &[buffer, allocation] : batch.buffers)
+        vmaDestroyBuffer(allocator, buffer, allocation);
+
+    // Views go before the images they look into, framebuffers before their attachments.
+    for (auto &framebuffer : batch.framebuffers)
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+
+    for (auto &image_view : batch.imageViews)
+        vkDestroyImageView(device, image_view, nullptr);
+
+    for (auto &[image, allocation] : batch.images)
+        vmaDestroyImage(allocator, image, allocation);
+
+    for (auto &sampler : batch.samplers)
+        vkDestroySampler(device, sampler, nullptr);
+
+    for (auto &render_pass : batch.renderPasses)
+        vkDestroyRenderPass(device, render_pass, nullptr);
+
+    for (auto &pipeline : batch.pipelines)
+        vkDestroyPipeline(device, pipeline, nullptr);
+
+    for (auto &pipeline_layout : batch.pipelineLayouts)
+        vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+
+    // Sets go before the pools they were allocated from.
+    for (auto &[descriptor_pool, descriptor_set] : batch.descriptorSets)
+        vkFreeDescriptorSets(device, descriptor_pool, 1, &descriptor_set);
+
+    for (auto &descriptor_pool : batch.descriptorPools)
+        vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+
+    for (auto &descriptor_set_layout : batch.descriptorSetLayouts)
+        vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+
+    for (auto &semaphore : batch.semaphores)
+        vkDestroySemaphore(device, semaphore, nullptr);
+
+    for (auto &swapchain : batch.swapchains)
+        vkDestroySwapchainKHR(device, swapchain, nullptr);
+
+    for (auto &deleter : batch.deleters)
+        deleter();
+}
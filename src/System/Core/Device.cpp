@@ -1,24 +1,30 @@
 #include "stdafx.hpp"
 #include "System/Core/Device.hpp"
+#include "System/Profiling/RenderStats.hpp"
 
-zh::Device::Device(Window &window) : window(window)
+zh::Device::Device(Window &window) : window(&window)
 {
-    nullifyHandles();
-    initVulkanInstance();
-    initDebugMessenger();
-    initWindowSurface();
-    pickAdequatePhysicalDevice();
-    createLogicalDevice();
-    initMemoryAllocator();
-    createCommandPools();
+    init();
+}
+
+zh::Device::Device() : window(nullptr)
+{
+    init();
 }
 
 zh::Device::~Device()
 {
+    vkDeviceWaitIdle(device);
+
+    deletionQueue.reset();
+    frameTimeline.reset();
+    pipelineCache.reset();
     vkDestroyCommandPool(device, transientCommandPool, nullptr);
-    vkDestroyCommandPool(device, commandPool, nullptr);
     vmaDestroyAllocator(allocator);
-    vkDestroySurfaceKHR(instance, window.getSurface(), nullptr);
+
+    if (window != nullptr)
+        vkDestroySurfaceKHR(instance, window->getSurface(), nullptr);
+
     vkDestroyDevice(device, nullptr);
 #ifndef NDEBUG
     destroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
@@ -26,6 +32,22 @@ zh::Device::~Device()
     vkDestroyInstance(instance, nullptr);
 }
 
+void zh::Device::init()
+{
+    nullifyHandles();
+    initVulkanInstance();
+    initDebugMessenger();
+    initWindowSurface();
+    pickAdequatePhysicalDevice();
+    createLogicalDevice();
+    initMemoryAllocator();
+    createTransientCommandPool();
+
+    frameTimeline = std::make_unique<FrameTimeline>(device);
+    deletionQueue = std::make_unique<DeletionQueue>(device, allocator, *frameTimeline);
+    pipelineCache = std::make_unique<PipelineCache>(device, physicalDevice, PIPELINE_CACHE_PATH);
+}
+
 void zh::Device::createImageWithInfo(const VkImageCreateInfo &image_info, const VkMemoryPropertyFlags &properties,
                                      VkImage &image, VmaAllocation &image_memory)
 {
@@ -37,6 +59,8 @@ void zh::Device::createImageWithInfo(const VkImageCreateInfo &image_info, const
 
     if (vmaCreateImage(allocator, &image_info, &alloc_create_info, &image, &image_memory, nullptr) != VK_SUCCESS)
         throw std::runtime_error("zh::Device::createImageWithInfo: FAILED TO CREATE IMAGE");
+
+    ZH_STAT_INCREMENT(Allocations);
 }
 
 VkPhysicalDevice &zh::Device::getPhysicalDevice()
@@ -69,14 +93,54 @@ VkQueue &zh::Device::getTransferQueue()
     return graphicsQueue; // TEMP!!!!!!!!
 }
 
-VkCommandPool &zh::Device::getCommandPool()
+VkCommandPool &zh::Device::getTransientCommandPool()
 {
-    return commandPool;
+    return transientCommandPool;
 }
 
-VkCommandPool &zh::Device::getTransientCommandPool()
+const VkPhysicalDeviceFeatures &zh::Device::getEnabledFeatures() const
 {
-    return transientCommandPool;
+    return enabledFeatures;
+}
+
+const VkPhysicalDeviceVulkan12Features &zh::Device::getEnabledVulkan12Features() const
+{
+    return enabledVulkan12Features;
+}
+
+const VkPhysicalDeviceVulkan13Features &zh::Device::getEnabledVulkan13Features() const
+{
+    return enabledVulkan13Features;
+}
+
+const bool zh::Device::isPresentWaitEnabled() const
+{
+    return presentWaitEnabled;
+}
+
+const bool zh::Device::isMemoryBudgetEnabled() const
+{
+    return memoryBudgetEnabled;
+}
+
+const bool zh::Device::isHeadless() const
+{
+    return window == nullptr;
+}
+
+zh::FrameTimeline &zh::Device::getFrameTimeline()
+{
+    return *frameTimeline;
+}
+
+zh::DeletionQueue &zh::Device::getDeletionQueue()
+{
+    return *deletionQueue;
+}
+
+zh::PipelineCache &zh::Device::getPipelineCache()
+{
+    return *pipelineCache;
 }
 
 const bool zh::Device::checkValidationLayerSupport()
@@ -109,12 +173,16 @@ const bool zh::Device::checkValidationLayerSupport()
 
 std::vector<const char *> zh::Device::getRequiredExtensions()
 {
-    uint32_t glfw_extension_count = 0;
-    const char **glfw_extensions;
+    std::vector<const char *> extensions;
 
-    glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    // GLFW is never initialized without a window.
+    if (window != nullptr)
+    {
+        uint32_t glfw_extension_count = 0;
+        const char **glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
 
-    std::vector<const char *> extensions(glfw_extensions, glfw_extensions + glfw_extension_count);
+        extensions.assign(glfw_extensions, glfw_extensions + glfw_extension_count);
+    }
 
 #ifndef NDEBUG
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -139,11 +207,18 @@ const zh::Device::QueueFamilyIndices zh::Device::findQueueFamilies(VkPhysicalDev
         if (queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
             indices.graphicsFamily = i;
 
-        VkBool32 present_support = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, window.getSurface(), &present_support);
+        if (window == nullptr)
+        {
+            indices.presentFamily = indices.graphicsFamily;
+        }
+        else
+        {
+            VkBool32 present_support = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, window->getSurface(), &present_support);
 
-        if (present_support)
-            indices.presentFamily = i;
+            if (present_support)
+                indices.presentFamily = i;
+        }
 
         if (indices.isComplete())
             break;
@@ -154,27 +229,30 @@ const zh::Device::QueueFamilyIndices zh::Device::findQueueFamilies(VkPhysicalDev
 
 const zh::Device::SwapchainSupportDetails zh::Device::querySwapchainSupport(VkPhysicalDevice &physical_device) const
 {
-    SwapchainSupportDetails details;
+    SwapchainSupportDetails details{};
 
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physical_device, window.getSurface(), &details.capabilities);
+    if (window == nullptr)
+        return details;
+
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physical_device, window->getSurface(), &details.capabilities);
 
     uint32_t format_count = 0;
-    vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device, window.getSurface(), &format_count, nullptr);
+    vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device, window->getSurface(), &format_count, nullptr);
 
     if (format_count != 0)
     {
         details.formats.resize(format_count);
-        vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device, window.getSurface(), &format_count,
+        vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device, window->getSurface(), &format_count,
                                              details.formats.data());
     }
 
     uint32_t present_modes_count = 0;
-    vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device, window.getSurface(), &present_modes_count, nullptr);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device, window->getSurface(), &present_modes_count, nullptr);
 
     if (present_modes_count != 0)
     {
-        details.presentModes.resize(format_count);
-        vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device, window.getSurface(), &present_modes_count,
+        details.presentModes.resize(present_modes_count);
+        vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device, window->getSurface(), &present_modes_count,
                                                   details.presentModes.data());
     }
 
@@ -210,6 +288,8 @@ void zh::Device::nullifyHandles()
     device = VK_NULL_HANDLE;
     graphicsQueue = VK_NULL_HANDLE;
     presentQueue = VK_NULL_HANDLE;
+    presentWaitEnabled = false;
+    memoryBudgetEnabled = false;
 }
 
 void zh::Device::initVulkanInstance()
@@ -276,7 +356,8 @@ void zh::Device::initDebugMessenger()
 
 void zh::Device::initWindowSurface()
 {
-    window.createSurface(instance);
+    if (window != nullptr)
+        window->createSurface(instance);
 }
 
 void zh::Device::pickAdequatePhysicalDevice()
@@ -324,15 +405,108 @@ void zh::Device::createLogicalDevice()
         queue_create_infos.push_back(queue_create_info);
     }
 
-    VkPhysicalDeviceFeatures device_features{};
+    uint32_t extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extension_count, nullptr);
+
+    std::vector<VkExtensionProperties> available_extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extension_count, available_extensions.data());
+
+    std::set<std::string> missing_present_wait_extensions(PRESENT_WAIT_EXTENSIONS.begin(),
+                                                          PRESENT_WAIT_EXTENSIONS.end());
+
+    for (const auto &extension : available_extensions)
+    {
+        missing_present_wait_extensions.erase(extension.extensionName);
+
+        if (strcmp(extension.extensionName, MEMORY_BUDGET_EXTENSION) == 0)
+            memoryBudgetEnabled = true;
+    }
+
+    // Present wait builds on the swapchain.
+    if (window == nullptr)
+        missing_present_wait_extensions.insert(PRESENT_WAIT_EXTENSIONS.front());
+
+    // Optional features, used when the device has them.
+    VkPhysicalDevicePresentWaitFeaturesKHR supported_present_wait_features{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR};
+
+    VkPhysicalDevicePresentIdFeaturesKHR supported_present_id_features{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR};
+    supported_present_id_features.pNext = &supported_present_wait_features;
+
+    VkPhysicalDeviceVulkan13Features supported_vulkan13_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
+
+    if (missing_present_wait_extensions.empty())
+        supported_vulkan13_features.pNext = &supported_present_id_features;
+
+    VkPhysicalDeviceVulkan12Features supported_vulkan12_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    supported_vulkan12_features.pNext = &supported_vulkan13_features;
+
+    VkPhysicalDeviceFeatures2 supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    supported_features.pNext = &supported_vulkan12_features;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supported_features);
+
+    enabledFeatures = {};
+    enabledFeatures.multiDrawIndirect = supported_features.features.multiDrawIndirect;
+    enabledFeatures.drawIndirectFirstInstance = supported_features.features.drawIndirectFirstInstance;
+    enabledFeatures.pipelineStatisticsQuery = supported_features.features.pipelineStatisticsQuery;
+    enabledFeatures.occlusionQueryPrecise = supported_features.features.occlusionQueryPrecise;
+
+    enabledVulkan12Features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    enabledVulkan12Features.drawIndirectCount = supported_vulkan12_features.drawIndirectCount;
+
+    // Frame pacing is built on a timeline semaphore, which Vulkan 1.2 devices always support.
+    if (!supported_vulkan12_features.timelineSemaphore)
+        throw std::runtime_error("zh::Device::createLogicalDevice: DEVICE DOES NOT SUPPORT TIMELINE SEMAPHORES");
+
+    enabledVulkan12Features.timelineSemaphore = VK_TRUE;
+
+    // Swapchain rendering uses dynamic rendering with synchronization2 layout transitions, both core in 1.3.
+    if (!supported_vulkan13_features.dynamicRendering || !supported_vulkan13_features.synchronization2)
+        throw std::runtime_error("zh::Device::createLogicalDevice: DEVICE DOES NOT SUPPORT DYNAMIC RENDERING");
+
+    enabledVulkan13Features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
+    enabledVulkan13Features.dynamicRendering = VK_TRUE;
+    enabledVulkan13Features.synchronization2 = VK_TRUE;
+    enabledVulkan12Features.pNext = &enabledVulkan13Features;
+
+    presentWaitEnabled = missing_present_wait_extensions.empty() && supported_present_id_features.presentId &&
+                         supported_present_wait_features.presentWait;
+
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR};
+    present_wait_features.presentWait = VK_TRUE;
+
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR};
+    present_id_features.presentId = VK_TRUE;
+    present_id_features.pNext = &present_wait_features;
+
+    std::vector<const char *> extensions;
+
+    if (window != nullptr)
+        extensions = DEVICE_EXTENSIONS;
+
+    if (memoryBudgetEnabled)
+        extensions.push_back(MEMORY_BUDGET_EXTENSION);
+
+    if (presentWaitEnabled)
+    {
+        enabledVulkan13Features.pNext = &present_id_features;
+        extensions.insert(extensions.end(), PRESENT_WAIT_EXTENSIONS.begin(), PRESENT_WAIT_EXTENSIONS.end());
+    }
+
+    VkPhysicalDeviceFeatures2 device_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    device_features.features = enabledFeatures;
+    device_features.pNext = &enabledVulkan12Features;
 
     VkDeviceCreateInfo create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
     create_info.pQueueCreateInfos = queue_create_infos.data();
-    create_info.pEnabledFeatures = &device_features;
-    create_info.enabledExtensionCount = static_cast<uint32_t>(DEVICE_EXTENSIONS.size());
-    create_info.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
+    create_info.pNext = &device_features;
+    create_info.pEnabledFeatures = nullptr;
+    create_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    create_info.ppEnabledExtensionNames = extensions.data();
 
 #ifndef NDEBUG
     create_info.enabledLayerCount = static_cast<uint32_t>(VALIDATION_LAYERS.size());
@@ -356,7 +530,7 @@ void zh::Device::initMemoryAllocator()
     vulkan_functions.vkGetDeviceProcAddr = &vkGetDeviceProcAddr;
 
     VmaAllocatorCreateInfo allocator_create_info{};
-    allocator_create_info.flags = VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    allocator_create_info.flags = memoryBudgetEnabled ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0;
     allocator_create_info.vulkanApiVersion = VK_API_VERSION_1_2;
     allocator_create_info.physicalDevice = physicalDevice;
     allocator_create_info.device = device;
@@ -367,18 +541,11 @@ void zh::Device::initMemoryAllocator()
         throw std::runtime_error("zh::Device::initMemoryAllocator: FAILED TO INITIALIZE VMA MEMORY ALLOCATOR");
 }
 
-void zh::Device::createCommandPools()
+// Per frame recording uses each frame context's own pools; this one serves one time uploads and readbacks.
+void zh::Device::createTransientCommandPool()
 {
     QueueFamilyIndices queue_family_indices = findQueueFamilies(physicalDevice);
 
-    VkCommandPoolCreateInfo command_pool_info{};
-    command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    command_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    command_pool_info.queueFamilyIndex = queue_family_indices.getGraphicsFamily();
-
-    if (vkCreateCommandPool(device, &command_pool_info, nullptr, &commandPool) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create the Command Pool.");
-
     VkCommandPoolCreateInfo transient_command_pool_info{};
     transient_command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     transient_command_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
@@ -455,7 +622,7 @@ const int zh::Device::rateDeviceSuitability(VkPhysicalDevice physical_device)
         score = -1;
 
     // Require that swap chain is adequate
-    if (extension_support)
+    if (extension_support && window != nullptr)
     {
         SwapchainSupportDetails details = querySwapchainSupport(physical_device);
         if (details.formats.empty() || details.presentModes.empty())
@@ -0,0 +1,78 @@
+#include "stdafx.hpp"
+#include "System/Core/FrameTimeline.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
+
+zh::FrameTimeline::FrameTimeline(VkDevice &device) : device(device), submittedFrame(0)
+{
+    VkSemaphoreTypeCreateInfo type_info{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_info.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphore_info{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    semaphore_info.pNext = &type_info;
+
+    if (vkCreateSemaphore(device, &semaphore_info, nullptr, &semaphore) != VK_SUCCESS)
+        throw std::runtime_error("zh::FrameTimeline::FrameTimeline: FAILED TO CREATE TIMELINE SEMAPHORE");
+}
+
+zh::FrameTimeline::~FrameTimeline()
+{
+    vkDestroySemaphore(device, semaphore, nullptr);
+}
+
+VkSemaphore &zh::FrameTimeline::getSemaphore()
+{
+    return semaphore;
+}
+
+const uint64_t zh::FrameTimeline::getPendingFrame() const
+{
+    return submittedFrame.load() + 1;
+}
+
+const uint64_t zh::FrameTimeline::getSubmittedFrame() const
+{
+    return submittedFrame.load();
+}
+
+const uint64_t zh::FrameTimeline::getCompletedFrame() const
+{
+    uint64_t value = 0;
+
+    if (vkGetSemaphoreCounterValue(device, semaphore, &value) != VK_SUCCESS)
+        throw std::runtime_error("zh::FrameTimeline::getCompletedFrame: FAILED TO READ TIMELINE SEMAPHORE");
+
+    return value;
+}
+
+const bool zh::FrameTimeline::isComplete(const uint64_t frame) const
+{
+    return frame == 0 || getCompletedFrame() >= frame;
+}
+
+const bool zh::FrameTimeline::wait(const uint64_t frame, const uint64_t timeout) const
+{
+    if (frame == 0)
+        return true;
+
+    ZH_PROFILE_SCOPE("zh::FrameTimeline::wait");
+
+    VkSemaphoreWaitInfo wait_info{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &semaphore;
+    wait_info.pValues = &frame;
+
+    VkResult result = vkWaitSemaphores(device, &wait_info, timeout);
+
+    if (result != VK_SUCCESS && result != VK_TIMEOUT)
+        throw std::runtime_error("zh::FrameTimeline::wait: FAILED TO WAIT FOR TIMELINE SEMAPHORE");
+
+    return result == VK_SUCCESS;
+}
+
+void zh::FrameTimeline::markSubmitted(const uint64_t frame)
+{
+    assert(frame == submittedFrame.load() + 1 && "zh::FrameTimeline::markSubmitted: FRAMES MUST BE SUBMITTED IN ORDER");
+
+    submittedFrame.store(frame);
+}
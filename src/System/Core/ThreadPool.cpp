@@ -0,0 +1,97 @@
+#include "stdafx.hpp"
+#include "System/Core/ThreadPool.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
+
+zh::ThreadPool::ThreadPool(const uint32_t thread_count) : pendingTasks(0), isStopping(false)
+{
+    assert(thread_count > 0 && "zh::ThreadPool::ThreadPool: THREAD COUNT MUST BE GREATER THAN ZERO");
+
+    workers.reserve(thread_count);
+
+    for (uint32_t i = 0; i < thread_count; ++i)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+zh::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+
+    taskAvailable.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void zh::ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(task));
+        ++pendingTasks;
+    }
+
+    taskAvailable.notify_one();
+}
+
+void zh::ThreadPool::parallelFor(const uint32_t count, const std::function<void(uint32_t begin, uint32_t end)> &task,
+                                 const uint32_t min_range)
+{
+    if (count == 0)
+        return;
+
+    // A few ranges per worker keeps them busy when ranges take uneven time.
+    const uint32_t range_count = std::max(1u, std::min(count / std::max(min_range, 1u), getThreadCount() * 4));
+    const uint32_t range_size = (count + range_count - 1) / range_count;
+
+    for (uint32_t begin = 0; begin < count; begin += range_size)
+    {
+        const uint32_t end = std::min(begin + range_size, count);
+        submit([&task, begin, end]() { task(begin, end); });
+    }
+
+    wait();
+}
+
+void zh::ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    tasksFinished.wait(lock, [this]() { return pendingTasks == 0; });
+}
+
+const uint32_t zh::ThreadPool::getThreadCount() const
+{
+    return static_cast<uint32_t>(workers.size());
+}
+
+void zh::ThreadPool::work()
+{
+    ZH_PROFILE_THREAD("zh::ThreadPool worker");
+
+    while (true)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this]() { return isStopping || !tasks.empty(); });
+
+            if (isStopping && tasks.empty())
+                return;
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --pendingTasks;
+        }
+
+        tasksFinished.notify_all();
+    }
+}
@@ -1,10 +1,13 @@
 #include "stdafx.hpp"
 #include "System/Memory/Buffer.hpp"
+#include "System/Core/Device.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
+#include "System/Profiling/RenderStats.hpp"
 
 zh::Buffer::Buffer(VmaAllocator &allocator, VkDeviceSize size, VkBufferUsageFlags usage,
                    VkMemoryPropertyFlags properties, VmaMemoryUsage memory_usage,
                    VmaAllocationCreateFlags allocation_flags)
-    : allocator(allocator), size(size), mapped(false), mappable(false), mmem(nullptr)
+    : allocator(allocator), size(size), mapped(false), mappable(false), mmem(nullptr), deletionQueue(nullptr)
 {
     if (properties & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
         mappable = true;
@@ -12,6 +15,13 @@ zh::Buffer::Buffer(VmaAllocator &allocator, VkDeviceSize size, VkBufferUsageFlag
     create(allocator, size, usage, properties, memory_usage, allocation_flags, buffer, memory);
 }
 
+zh::Buffer::Buffer(Device &device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                   VmaMemoryUsage memory_usage, VmaAllocationCreateFlags allocation_flags)
+    : Buffer(device.getAllocator(), size, usage, properties, memory_usage, allocation_flags)
+{
+    deletionQueue = &device.getDeletionQueue();
+}
+
 VkBuffer &zh::Buffer::getBuffer()
 {
     return buffer;
@@ -32,6 +42,11 @@ const bool zh::Buffer::isMappable() const
     return mappable;
 }
 
+const bool zh::Buffer::isDeferred() const
+{
+    return deletionQueue != nullptr;
+}
+
 void zh::Buffer::map()
 {
     assert(allocator != VK_NULL_HANDLE && "zh::Buffer::map: ALLOCATOR IS NOT INITIALIZED");
@@ -56,13 +71,14 @@ void zh::Buffer::map(void *&mmem)
     this->mmem = mmem;
 }
 
-void zh::Buffer::write(void *data, const size_t size)
+void zh::Buffer::write(void *data, const size_t size, const size_t offset)
 {
     assert(mmem != nullptr && "zh::Buffer::write: TRYING TO WRITE TO UNMAPPED BUFFER");
     assert(data != nullptr && "zh::Buffer::write: DATA POINTER IS NULL");
-    assert(size <= this->size && "zh::Buffer::write: SIZE EXCEEDS BUFFER CAPACITY");
+    assert(offset + size <= this->size && "zh::Buffer::write: SIZE EXCEEDS BUFFER CAPACITY");
 
-    std::memcpy(mmem, data, size);
+    std::memcpy(static_cast<uint8_t *>(mmem) + offset, data, size);
+    ZH_STAT_ADD(BytesUploaded, size);
 }
 
 void zh::Buffer::unmap()
@@ -75,7 +91,13 @@ void zh::Buffer::unmap()
 
 zh::Buffer::~Buffer()
 {
-    vmaDestroyBuffer(allocator, buffer, memory);
+    if (mmem != nullptr)
+        unmap();
+
+    if (deletionQueue != nullptr)
+        deletionQueue->push(buffer, memory);
+    else
+        vmaDestroyBuffer(allocator, buffer, memory);
 }
 
 void zh::Buffer::create(VmaAllocator &allocator, VkDeviceSize size, VkBufferUsageFlags usage,
@@ -94,10 +116,14 @@ void zh::Buffer::create(VmaAllocator &allocator, VkDeviceSize size, VkBufferUsag
     alloc_info.requiredFlags = properties;
 
     vmaCreateBuffer(allocator, &create_info, &alloc_info, &buffer, &buffer_memory, nullptr);
+    ZH_STAT_INCREMENT(Allocations);
 }
 
-void zh::Buffer::copy(VkDevice &device, VkCommandPool &command_pool, VkQueue &queue, Buffer &src, Buffer &dst)
+void zh::Buffer::copy(VkDevice &device, VkCommandPool &command_pool, VkQueue &queue, Buffer &src, Buffer &dst,
+                      const VkDeviceSize dst_offset)
 {
+    ZH_PROFILE_SCOPE("zh::Buffer::copy");
+
     // Allocate command buffer
     // TODO: (reuse if possible)
     VkCommandBuffer command_buffer;
@@ -126,11 +152,12 @@ void zh::Buffer::copy(VkDevice &device, VkCommandPool &command_pool, VkQueue &qu
                          VK_PIPELINE_STAGE_HOST_BIT,     // Host write is complete
                          VK_PIPELINE_STAGE_TRANSFER_BIT, // Ready for transfer
                          0, 0, nullptr, 1, &buf_mem_barrier, 0, nullptr);
+    ZH_STAT_INCREMENT(Barriers);
 
     // Copy buffer
     VkBufferCopy copy_region{};
     copy_region.srcOffset = 0;
-    copy_region.dstOffset = 0;
+    copy_region.dstOffset = dst_offset;
     copy_region.size = src.getSize();
     vkCmdCopyBuffer(command_buffer, src.getBuffer(), dst.getBuffer(), 1, &copy_region);
 
@@ -141,13 +168,14 @@ void zh::Buffer::copy(VkDevice &device, VkCommandPool &command_pool, VkQueue &qu
     buf_mem_barrier_2.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     buf_mem_barrier_2.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     buf_mem_barrier_2.buffer = dst.getBuffer();
-    buf_mem_barrier_2.offset = 0;
-    buf_mem_barrier_2.size = VK_WHOLE_SIZE;
+    buf_mem_barrier_2.offset = dst_offset;
+    buf_mem_barrier_2.size = src.getSize();
 
     vkCmdPipelineBarrier(command_buffer,
                          VK_PIPELINE_STAGE_TRANSFER_BIT,     // Transfer is complete
                          VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, // Make buffer available for all subsequent operations
                          0, 0, nullptr, 1, &buf_mem_barrier_2, 0, nullptr);
+    ZH_STAT_INCREMENT(Barriers);
 
     // End command buffer
     vkEndCommandBuffer(command_buffer);
@@ -165,7 +193,10 @@ void zh::Buffer::copy(VkDevice &device, VkCommandPool &command_pool, VkQueue &qu
     vkQueueSubmit(queue, 1, &submit_info, fence);
 
     // Wait for the fence to ensure the copy is complete
-    vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+    {
+        ZH_PROFILE_SCOPE("zh::Buffer::copy: fence wait");
+        vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+    }
     vkDestroyFence(device, fence, nullptr);
 
     // Free command buffer (consider reusing it instead of freeing)
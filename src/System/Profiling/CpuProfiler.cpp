@@ -0,0 +1,149 @@
+#include "stdafx.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
+
+void zh::CpuProfiler::setEnabled(const bool enabled)
+{
+    CpuProfiler::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+const bool zh::CpuProfiler::isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void zh::CpuProfiler::setThreadName(const std::string &name)
+{
+    ThreadBuffer *buffer = threadBuffer != nullptr ? threadBuffer : registerThread();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer->name = name;
+}
+
+void zh::CpuProfiler::writeChromeTrace(const std::string &path)
+{
+    std::ofstream file(path);
+
+    if (!file.is_open())
+        throw std::runtime_error("zh::CpuProfiler::writeChromeTrace: FAILED TO OPEN FILE: " + path);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<std::pair<uint32_t, Event>> events;
+
+    for (auto &buffer : buffers)
+    {
+        const uint64_t end = buffer->writeIndex.load(std::memory_order_acquire);
+        const uint64_t oldest = end > BUFFER_CAPACITY ? end - BUFFER_CAPACITY : 0;
+        const uint64_t begin = std::max(buffer->clearIndex.load(std::memory_order_relaxed), oldest);
+
+        const size_t first_event = events.size();
+
+        for (uint64_t i = begin; i < end; ++i)
+        {
+            const Slot &slot = buffer->slots[i & (BUFFER_CAPACITY - 1)];
+            events.emplace_back(buffer->id, Event{slot.name.load(std::memory_order_acquire),
+                                                  slot.start.load(std::memory_order_acquire),
+                                                  slot.end.load(std::memory_order_acquire)});
+        }
+
+        // Whatever the thread wrote during the copy, including the event it may be writing right now, may have
+        // overwritten the oldest copied events, possibly halfway. Any field copied from such a write makes its index
+        // visible here, so those events are dropped.
+        const uint64_t written = buffer->writeIndex.load(std::memory_order_acquire) + 1;
+        const uint64_t overwritten = written > BUFFER_CAPACITY ? written - BUFFER_CAPACITY : 0;
+
+        if (overwritten > begin)
+        {
+            const size_t count = static_cast<size_t>(std::min(overwritten, end) - begin);
+            events.erase(events.begin() + first_event, events.begin() + first_event + count);
+        }
+    }
+
+    const double nanoseconds_per_tick = getNanosecondsPerTick();
+    uint64_t origin = std::numeric_limits<uint64_t>::max();
+
+    for (auto &event : events)
+        origin = std::min(origin, event.second.start);
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool is_first = true;
+
+    for (auto &buffer : buffers)
+    {
+        if (buffer->name.empty())
+            continue;
+
+        file << (is_first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->id
+             << ",\"args\":{\"name\":\"" << escape(buffer->name) << "\"}}";
+        is_first = false;
+    }
+
+    file << std::fixed;
+    file.precision(3);
+
+    // Chrome traces are in microseconds.
+    for (auto &[thread, event] : events)
+    {
+        file << (is_first ? "" : ",") << "\n{\"name\":\"" << escape(event.name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+             << thread << ",\"ts\":" << (event.start - origin) * nanoseconds_per_tick / 1000.0
+             << ",\"dur\":" << (event.end - event.start) * nanoseconds_per_tick / 1000.0 << "}";
+        is_first = false;
+    }
+
+    file << "\n]}\n";
+}
+
+void zh::CpuProfiler::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto &buffer : buffers)
+        buffer->clearIndex.store(buffer->writeIndex.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+zh::CpuProfiler::ThreadBuffer *zh::CpuProfiler::registerThread()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    buffers.push_back(std::make_unique<ThreadBuffer>());
+    buffers.back()->id = static_cast<uint32_t>(buffers.size() - 1);
+
+    threadBuffer = buffers.back().get();
+
+    return threadBuffer;
+}
+
+const double zh::CpuProfiler::getNanosecondsPerTick()
+{
+#ifdef ZH_PROFILE_USE_TSC
+    const uint64_t ticks = now() - calibration.ticks;
+    const auto time = std::chrono::steady_clock::now() - calibration.time;
+
+    if (ticks == 0)
+        return 1.0;
+
+    return std::chrono::duration<double, std::nano>(time).count() / static_cast<double>(ticks);
+#else
+    return 1.0;
+#endif
+}
+
+const std::string zh::CpuProfiler::escape(const std::string &text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+
+    for (const char character : text)
+    {
+        if (character == '"' || character == '\\')
+            escaped += '\\';
+
+        if (static_cast<unsigned char>(character) < 0x20)
+            continue;
+
+        escaped += character;
+    }
+
+    return escaped;
+}
@@ -0,0 +1,79 @@
+#include "stdafx.hpp"
+#include "System/Profiling/FrameQueryPools.hpp"
+
+zh::FrameQueryPools::FrameQueryPools(Device &device, const uint32_t frame_count, const VkQueryPoolCreateInfo &pool_info,
+                                     const std::string &what)
+    : device(device), queryCount(pool_info.queryCount), pools(frame_count, VK_NULL_HANDLE)
+{
+    for (auto &pool : pools)
+    {
+        if (vkCreateQueryPool(device.getLogicalDevice(), &pool_info, nullptr, &pool) != VK_SUCCESS)
+            throw std::runtime_error("zh::FrameQueryPools::FrameQueryPools: FAILED TO CREATE " + what + " QUERY POOL");
+    }
+}
+
+zh::FrameQueryPools::~FrameQueryPools()
+{
+    for (auto &pool : pools)
+    {
+        if (pool != VK_NULL_HANDLE)
+            vkDestroyQueryPool(device.getLogicalDevice(), pool, nullptr);
+    }
+}
+
+VkQueryPool zh::FrameQueryPools::getPool(const int frame_index) const
+{
+    assert(frame_index >= 0 && frame_index < pools.size() && "zh::FrameQueryPools::getPool: FRAME INDEX OUT OF BOUNDS");
+
+    return pools[frame_index];
+}
+
+const uint32_t zh::FrameQueryPools::getQueryCount() const
+{
+    return queryCount;
+}
+
+void zh::FrameQueryPools::reset(VkCommandBuffer &command_buffer, const int frame_index)
+{
+    vkCmdResetQueryPool(command_buffer, getPool(frame_index), 0, queryCount);
+}
+
+const bool zh::FrameQueryPools::readResults(const int frame_index, const uint32_t query_count, const size_t stride,
+                                            uint64_t *results) const
+{
+    assert(query_count <= queryCount && "zh::FrameQueryPools::readResults: QUERY COUNT OUT OF BOUNDS");
+
+    if (query_count == 0)
+        return true;
+
+    // Without the wait flag, unavailable results make this return VK_NOT_READY instead of blocking.
+    return vkGetQueryPoolResults(device.getLogicalDevice(), getPool(frame_index), 0, query_count, query_count * stride,
+                                 results, stride, VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+}
+
+const zh::FrameQueryPools::TimestampProperties zh::FrameQueryPools::getTimestampProperties(Device &device)
+{
+    VkPhysicalDevice &physical_device = device.getPhysicalDevice();
+    const uint32_t graphics_family = device.findQueueFamilies(physical_device).getGraphicsFamily();
+
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, queue_families.data());
+
+    const uint32_t valid_bits = queue_families[graphics_family].timestampValidBits;
+
+    if (valid_bits == 0)
+        return {};
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+    TimestampProperties timestamp_properties;
+    timestamp_properties.period = properties.limits.timestampPeriod;
+    timestamp_properties.mask =
+        valid_bits >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t(1) << valid_bits) - 1;
+
+    return timestamp_properties;
+}
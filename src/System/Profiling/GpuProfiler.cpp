@@ -0,0 +1,197 @@
+#include "stdafx.hpp"
+#include "System/Profiling/GpuProfiler.hpp"
+
+zh::GpuProfiler::Scope::Scope(GpuProfiler &profiler, VkCommandBuffer &command_buffer, const std::string &name)
+    : profiler(profiler), commandBuffer(command_buffer)
+{
+    profiler.beginScope(commandBuffer, name);
+}
+
+zh::GpuProfiler::Scope::~Scope()
+{
+    profiler.endScope(commandBuffer);
+}
+
+zh::GpuProfiler::GpuProfiler(Device &device, const uint32_t frame_count, const uint32_t max_scopes)
+    : device(device), maxScopes(max_scopes), timestampPeriod(0.0), timestampMask(0), currentFrame(-1)
+{
+    createQueryPools(frame_count);
+}
+
+zh::GpuProfiler::~GpuProfiler() = default;
+
+void zh::GpuProfiler::beginFrame(VkCommandBuffer &command_buffer, const int frame_index)
+{
+    assert(frame_index >= 0 && frame_index < frames.size() &&
+           "zh::GpuProfiler::beginFrame: FRAME INDEX OUT OF BOUNDS");
+    assert(openScopes.empty() && "zh::GpuProfiler::beginFrame: SCOPES LEFT OPEN IN THE PREVIOUS FRAME");
+
+    if (!isSupported())
+        return;
+
+    FrameQueries &frame = frames[frame_index];
+
+    if (frame.isRecorded)
+        readResults(frame_index);
+
+    queryPools->reset(command_buffer, frame_index);
+
+    frame.scopes.clear();
+    frame.queryCount = 0;
+    frame.isRecorded = true;
+    currentFrame = frame_index;
+}
+
+void zh::GpuProfiler::beginScope(VkCommandBuffer &command_buffer, const std::string &name)
+{
+    // Dropped scopes still push, so their endScope() pops the right entry.
+    if (!isSupported() || currentFrame < 0 || frames[currentFrame].queryCount + 2 > maxScopes * 2)
+    {
+        openScopes.push_back(std::numeric_limits<size_t>::max());
+        return;
+    }
+
+    FrameQueries &frame = frames[currentFrame];
+
+    ScopeRecord scope{name, frame.queryCount, frame.queryCount + 1};
+    frame.queryCount += 2;
+
+    vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, queryPools->getPool(currentFrame),
+                         scope.beginQuery);
+
+    openScopes.push_back(frame.scopes.size());
+    frame.scopes.push_back(scope);
+}
+
+void zh::GpuProfiler::endScope(VkCommandBuffer &command_buffer)
+{
+    assert(!openScopes.empty() && "zh::GpuProfiler::endScope: NO SCOPE IS OPEN");
+
+    const size_t scope = openScopes.back();
+    openScopes.pop_back();
+
+    if (scope == std::numeric_limits<size_t>::max())
+        return;
+
+    FrameQueries &frame = frames[currentFrame];
+
+    vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPools->getPool(currentFrame),
+                         frame.scopes[scope].endQuery);
+}
+
+const bool zh::GpuProfiler::isSupported() const
+{
+    return timestampMask != 0;
+}
+
+const std::vector<zh::GpuProfiler::Timing> &zh::GpuProfiler::getTimings() const
+{
+    return timings;
+}
+
+const zh::GpuProfiler::Timing *zh::GpuProfiler::getTiming(const std::string &name) const
+{
+    auto index = timingIndices.find(name);
+
+    if (index == timingIndices.end())
+        return nullptr;
+
+    return &timings[index->second];
+}
+
+void zh::GpuProfiler::printTimings(std::ostream &stream) const
+{
+    for (auto &timing : timings)
+    {
+        stream << timing.name << ": " << timing.averageTime << " ms (last " << timing.lastTime << ", min "
+               << timing.minTime << ", max " << timing.maxTime << ")\n";
+    }
+}
+
+void zh::GpuProfiler::writeCsv(const std::string &path) const
+{
+    std::ofstream file(path);
+
+    if (!file.is_open())
+        throw std::runtime_error("zh::GpuProfiler::writeCsv: FAILED TO OPEN FILE: " + path);
+
+    file << "scope,last_ms,average_ms,min_ms,max_ms,samples\n";
+
+    for (auto &timing : timings)
+    {
+        file << timing.name << ',' << timing.lastTime << ',' << timing.averageTime << ',' << timing.minTime << ','
+             << timing.maxTime << ',' << timing.sampleCount << '\n';
+    }
+}
+
+void zh::GpuProfiler::resetTimings()
+{
+    timings.clear();
+    timingIndices.clear();
+}
+
+void zh::GpuProfiler::createQueryPools(const uint32_t frame_count)
+{
+    frames.resize(frame_count);
+
+    const FrameQueryPools::TimestampProperties properties = FrameQueryPools::getTimestampProperties(device);
+
+    if (properties.mask == 0)
+        return;
+
+    timestampPeriod = properties.period;
+    timestampMask = properties.mask;
+
+    VkQueryPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    pool_info.queryCount = maxScopes * 2;
+
+    queryPools = std::make_unique<FrameQueryPools>(device, frame_count, pool_info, "TIMESTAMP");
+}
+
+void zh::GpuProfiler::readResults(const int frame_index)
+{
+    FrameQueries &frame = frames[frame_index];
+
+    if (frame.queryCount == 0)
+        return;
+
+    std::vector<uint64_t> timestamps(frame.queryCount);
+
+    // The frame has completed, so this does not wait; an incomplete frame is skipped rather than waited on.
+    if (!queryPools->readResults(frame_index, frame.queryCount, sizeof(uint64_t), timestamps.data()))
+        return;
+
+    std::unordered_map<std::string, double> frame_times;
+    std::vector<std::string> frame_order;
+
+    for (auto &scope : frame.scopes)
+    {
+        const uint64_t ticks = (timestamps[scope.endQuery] - timestamps[scope.beginQuery]) & timestampMask;
+        const double time = static_cast<double>(ticks) * timestampPeriod / 1e6;
+
+        if (frame_times.count(scope.name) == 0)
+            frame_order.push_back(scope.name);
+
+        frame_times[scope.name] += time;
+    }
+
+    for (auto &name : frame_order)
+    {
+        const double time = frame_times[name];
+
+        if (timingIndices.count(name) == 0)
+        {
+            timingIndices[name] = timings.size();
+            timings.push_back(Timing{name});
+        }
+
+        Timing &timing = timings[timingIndices[name]];
+        timing.lastTime = time;
+        timing.averageTime =
+            timing.sampleCount == 0 ? time : timing.averageTime + (time - timing.averageTime) * SMOOTHING;
+        timing.minTime = std::min(timing.minTime, time);
+        timing.maxTime = std::max(timing.maxTime, time);
+        ++timing.sampleCount;
+    }
+}
@@ -0,0 +1,237 @@
+#include "stdafx.hpp"
+#include "System/Profiling/PipelineStatistics.hpp"
+
+zh::PipelineStatistics::Scope::Scope(PipelineStatistics &statistics, VkCommandBuffer &command_buffer,
+                                     const std::string &name)
+    : statistics(statistics), commandBuffer(command_buffer)
+{
+    statistics.beginScope(commandBuffer, name);
+}
+
+zh::PipelineStatistics::Scope::~Scope()
+{
+    statistics.endScope(commandBuffer);
+}
+
+zh::PipelineStatistics::PipelineStatistics(Device &device, const uint32_t frame_count, const uint32_t max_scopes)
+    : device(device), maxScopes(max_scopes), supported(false), enabled(false), currentFrame(-1)
+{
+    createQueryPools(frame_count);
+}
+
+zh::PipelineStatistics::~PipelineStatistics() = default;
+
+void zh::PipelineStatistics::setEnabled(const bool enabled)
+{
+    this->enabled = enabled;
+}
+
+const bool zh::PipelineStatistics::isEnabled() const
+{
+    return enabled;
+}
+
+void zh::PipelineStatistics::beginFrame(VkCommandBuffer &command_buffer, const int frame_index)
+{
+    assert(frame_index >= 0 && frame_index < frames.size() &&
+           "zh::PipelineStatistics::beginFrame: FRAME INDEX OUT OF BOUNDS");
+    assert(openScopes.empty() && "zh::PipelineStatistics::beginFrame: SCOPES LEFT OPEN IN THE PREVIOUS FRAME");
+
+    currentFrame = -1;
+
+    if (!isSupported())
+        return;
+
+    FrameQueries &frame = frames[frame_index];
+
+    // Results recorded before the statistics were disabled are still read back.
+    if (frame.isRecorded)
+        readResults(frame_index);
+
+    frame.scopes.clear();
+    frame.isRecorded = false;
+
+    if (!enabled)
+        return;
+
+    statisticsPools->reset(command_buffer, frame_index);
+    occlusionPools->reset(command_buffer, frame_index);
+
+    frame.isRecorded = true;
+    currentFrame = frame_index;
+}
+
+void zh::PipelineStatistics::beginScope(VkCommandBuffer &command_buffer, const std::string &name)
+{
+    const bool is_nested = std::any_of(openScopes.begin(), openScopes.end(), [](const size_t scope) {
+        return scope != std::numeric_limits<size_t>::max();
+    });
+
+    // Dropped scopes still push, so their endScope() pops the right entry.
+    if (currentFrame < 0 || is_nested || frames[currentFrame].scopes.size() >= maxScopes)
+    {
+        openScopes.push_back(std::numeric_limits<size_t>::max());
+        return;
+    }
+
+    FrameQueries &frame = frames[currentFrame];
+    const uint32_t query = static_cast<uint32_t>(frame.scopes.size());
+
+    const VkQueryControlFlags occlusion_flags =
+        device.getEnabledFeatures().occlusionQueryPrecise ? VK_QUERY_CONTROL_PRECISE_BIT : 0;
+
+    vkCmdBeginQuery(command_buffer, statisticsPools->getPool(currentFrame), query, 0);
+    vkCmdBeginQuery(command_buffer, occlusionPools->getPool(currentFrame), query, occlusion_flags);
+
+    openScopes.push_back(frame.scopes.size());
+    frame.scopes.push_back(name);
+}
+
+void zh::PipelineStatistics::endScope(VkCommandBuffer &command_buffer)
+{
+    assert(!openScopes.empty() && "zh::PipelineStatistics::endScope: NO SCOPE IS OPEN");
+
+    const size_t scope = openScopes.back();
+    openScopes.pop_back();
+
+    if (scope == std::numeric_limits<size_t>::max())
+        return;
+
+    vkCmdEndQuery(command_buffer, occlusionPools->getPool(currentFrame), static_cast<uint32_t>(scope));
+    vkCmdEndQuery(command_buffer, statisticsPools->getPool(currentFrame), static_cast<uint32_t>(scope));
+}
+
+const bool zh::PipelineStatistics::isSupported() const
+{
+    return supported;
+}
+
+const std::vector<zh::PipelineStatistics::Statistics> &zh::PipelineStatistics::getStatistics() const
+{
+    return statistics;
+}
+
+const zh::PipelineStatistics::Statistics *zh::PipelineStatistics::getStatistics(const std::string &name) const
+{
+    auto index = statisticsIndices.find(name);
+
+    if (index == statisticsIndices.end())
+        return nullptr;
+
+    return &statistics[index->second];
+}
+
+void zh::PipelineStatistics::printStatistics(std::ostream &stream) const
+{
+    for (auto &entry : statistics)
+    {
+        const Counts &last = entry.last;
+
+        stream << entry.name << ": " << last.inputVertices << " vertices, " << last.inputPrimitives
+               << " primitives, " << last.vertexInvocations << " vertex invocations, " << last.clippingPrimitives
+               << " of " << last.clippingInvocations << " primitives left after clipping, "
+               << last.fragmentInvocations << " fragment invocations, " << last.samplesPassed << " samples passed, "
+               << last.computeInvocations << " compute invocations\n";
+    }
+}
+
+void zh::PipelineStatistics::resetStatistics()
+{
+    statistics.clear();
+    statisticsIndices.clear();
+}
+
+void zh::PipelineStatistics::createQueryPools(const uint32_t frame_count)
+{
+    frames.resize(frame_count);
+
+    if (!device.getEnabledFeatures().pipelineStatisticsQuery)
+        return;
+
+    supported = true;
+
+    // Results are written in the order of the flag bits, which is the order of the fields of Counts.
+    VkQueryPoolCreateInfo statistics_info{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    statistics_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    statistics_info.queryCount = maxScopes;
+    statistics_info.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+                                         VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+                                         VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                                         VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+                                         VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                                         VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+                                         VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+    VkQueryPoolCreateInfo occlusion_info{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    occlusion_info.queryType = VK_QUERY_TYPE_OCCLUSION;
+    occlusion_info.queryCount = maxScopes;
+
+    statisticsPools = std::make_unique<FrameQueryPools>(device, frame_count, statistics_info, "PIPELINE STATISTICS");
+    occlusionPools = std::make_unique<FrameQueryPools>(device, frame_count, occlusion_info, "OCCLUSION");
+}
+
+void zh::PipelineStatistics::readResults(const int frame_index)
+{
+    FrameQueries &frame = frames[frame_index];
+    const uint32_t scope_count = static_cast<uint32_t>(frame.scopes.size());
+
+    if (scope_count == 0)
+        return;
+
+    std::vector<uint64_t> counters(scope_count * COUNTER_COUNT);
+    std::vector<uint64_t> samples(scope_count);
+
+    // The frame has completed, so this does not wait; an incomplete frame is skipped rather than waited on.
+    if (!statisticsPools->readResults(frame_index, scope_count, COUNTER_COUNT * sizeof(uint64_t), counters.data()) ||
+        !occlusionPools->readResults(frame_index, scope_count, sizeof(uint64_t), samples.data()))
+        return;
+
+    // Scopes with the same name are summed within the frame before being added to the totals.
+    std::unordered_map<std::string, Counts> frame_counts;
+    std::vector<std::string> frame_order;
+
+    for (uint32_t i = 0; i < scope_count; ++i)
+    {
+        const std::string &name = frame.scopes[i];
+        const uint64_t *values = &counters[i * COUNTER_COUNT];
+
+        if (frame_counts.count(name) == 0)
+        {
+            frame_order.push_back(name);
+            frame_counts[name] = Counts{};
+        }
+
+        Counts &counts = frame_counts[name];
+        counts.inputVertices += values[0];
+        counts.inputPrimitives += values[1];
+        counts.vertexInvocations += values[2];
+        counts.clippingInvocations += values[3];
+        counts.clippingPrimitives += values[4];
+        counts.fragmentInvocations += values[5];
+        counts.computeInvocations += values[6];
+        counts.samplesPassed += samples[i];
+    }
+
+    for (auto &name : frame_order)
+    {
+        const Counts &counts = frame_counts[name];
+
+        if (statisticsIndices.count(name) == 0)
+        {
+            statisticsIndices[name] = statistics.size();
+            statistics.push_back(Statistics{name, Counts{}, Counts{}, 0});
+        }
+
+        Statistics &entry = statistics[statisticsIndices[name]];
+        entry.last = counts;
+        entry.total.inputVertices += counts.inputVertices;
+        entry.total.inputPrimitives += counts.inputPrimitives;
+        entry.total.vertexInvocations += counts.vertexInvocations;
+        entry.total.clippingInvocations += counts.clippingInvocations;
+        entry.total.clippingPrimitives += counts.clippingPrimitives;
+        entry.total.fragmentInvocations += counts.fragmentInvocations;
+        entry.total.computeInvocations += counts.computeInvocations;
+        entry.total.samplesPassed += counts.samplesPassed;
+        ++entry.sampleCount;
+    }
+}
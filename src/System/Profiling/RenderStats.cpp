@@ -0,0 +1,114 @@
+#include "stdafx.hpp"
+#include "System/Profiling/RenderStats.hpp"
+
+const uint32_t zh::RenderStats::beginPass(const std::string &name)
+{
+    const uint32_t previous = currentPass.load(std::memory_order_relaxed);
+
+    auto it = std::find(passNames.begin(), passNames.end(), name);
+    uint32_t pass = static_cast<uint32_t>(it - passNames.begin()) + 1;
+
+    if (it == passNames.end())
+    {
+        if (passNames.size() < MAX_PASSES)
+            passNames.push_back(name);
+        else
+            pass = MAX_PASSES;
+    }
+
+    currentPass.store(pass, std::memory_order_relaxed);
+    return previous;
+}
+
+void zh::RenderStats::endPass(const uint32_t previous)
+{
+    currentPass.store(previous, std::memory_order_relaxed);
+}
+
+void zh::RenderStats::endFrame(const uint64_t frame)
+{
+    lastFrame.frame = frame;
+    lastFrame.total.fill(0);
+    lastFrame.passes.resize(passNames.size());
+
+    for (uint32_t slot = 0; slot <= passNames.size(); ++slot)
+    {
+        for (size_t i = 0; i < COUNTER_COUNT; ++i)
+        {
+            const uint64_t value = counters[slot][i].exchange(0, std::memory_order_relaxed);
+            lastFrame.total[i] += value;
+
+            if (slot > 0)
+                lastFrame.passes[slot - 1].counters[i] = value;
+        }
+
+        if (slot > 0)
+            lastFrame.passes[slot - 1].name = passNames[slot - 1];
+    }
+
+    // Pass names are assigned slots again every frame, in the order the passes are begun.
+    passNames.clear();
+
+    if (logInterval != 0 && frame % logInterval == 0)
+        print(lastFrame);
+}
+
+const zh::RenderStats::FrameStats &zh::RenderStats::getLastFrame()
+{
+    return lastFrame;
+}
+
+const uint64_t zh::RenderStats::getLastFrame(const Counter counter)
+{
+    return lastFrame.total[static_cast<size_t>(counter)];
+}
+
+void zh::RenderStats::setLogInterval(const uint32_t interval)
+{
+    logInterval = interval;
+}
+
+void zh::RenderStats::print(const FrameStats &stats, std::ostream &stream)
+{
+    const auto print_counters = [&](const std::string &name, const Counters &values) {
+        stream << "  " << name << ":";
+        for (size_t i = 0; i < COUNTER_COUNT; ++i)
+            stream << " " << getCounterName(static_cast<Counter>(i)) << "=" << values[i];
+        stream << "\n";
+    };
+
+    stream << "zh::RenderStats: frame " << stats.frame << "\n";
+    print_counters("total", stats.total);
+
+    for (auto &pass : stats.passes)
+        print_counters(pass.name, pass.counters);
+
+    stream << std::flush;
+}
+
+const char *zh::RenderStats::getCounterName(const Counter counter)
+{
+    switch (counter)
+    {
+    case Counter::DrawCalls:
+        return "draws";
+    case Counter::Instances:
+        return "instances";
+    case Counter::Triangles:
+        return "triangles";
+    case Counter::PipelineBinds:
+        return "pipelineBinds";
+    case Counter::DescriptorBinds:
+        return "descriptorBinds";
+    case Counter::BufferBinds:
+        return "bufferBinds";
+    case Counter::BytesUploaded:
+        return "bytesUploaded";
+    case Counter::Allocations:
+        return "allocations";
+    case Counter::Barriers:
+        return "barriers";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,83 @@
+#include "stdafx.hpp"
+#include "System/Rendering/ComputePipeline.hpp"
+#include "System/Rendering/Pipeline.hpp"
+#include "System/Profiling/RenderStats.hpp"
+
+zh::ComputePipeline::ComputePipeline(Device &device, const std::string &compute_shader_path,
+                                     const std::vector<VkDescriptorSetLayout> &descriptor_set_layouts,
+                                     const uint32_t push_constant_size)
+    : device(device)
+{
+    createPipeline(compute_shader_path, descriptor_set_layouts, push_constant_size);
+}
+
+zh::ComputePipeline::~ComputePipeline()
+{
+    // Frames in flight may still dispatch with it.
+    device.getDeletionQueue().push(pipeline);
+    device.getDeletionQueue().push(pipelineLayout);
+}
+
+void zh::ComputePipeline::bind(VkCommandBuffer &command_buffer)
+{
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    ZH_STAT_INCREMENT(PipelineBinds);
+}
+
+VkPipeline &zh::ComputePipeline::getHandle()
+{
+    return pipeline;
+}
+
+VkPipelineLayout &zh::ComputePipeline::getLayout()
+{
+    return pipelineLayout;
+}
+
+void zh::ComputePipeline::createPipeline(const std::string &compute_shader_path,
+                                         const std::vector<VkDescriptorSetLayout> &descriptor_set_layouts,
+                                         const uint32_t push_constant_size)
+{
+    VkShaderModule shader_module;
+
+    {
+        auto shader_bytecode = Pipeline::readFile(compute_shader_path);
+        shader_module = Pipeline::createShaderModule(device, shader_bytecode);
+    }
+
+    VkPipelineShaderStageCreateInfo shader_stage_info{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
+    shader_stage_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    shader_stage_info.module = shader_module;
+    shader_stage_info.pName = "main";
+
+    // Pipeline Layout
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = push_constant_size;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(descriptor_set_layouts.size());
+    pipeline_layout_info.pSetLayouts = descriptor_set_layouts.empty() ? nullptr : descriptor_set_layouts.data();
+    pipeline_layout_info.pushConstantRangeCount = push_constant_size > 0 ? 1 : 0;
+    pipeline_layout_info.pPushConstantRanges = push_constant_size > 0 ? &push_constant_range : nullptr;
+
+    if (vkCreatePipelineLayout(device.getLogicalDevice(), &pipeline_layout_info, nullptr, &pipelineLayout) !=
+        VK_SUCCESS)
+        throw std::runtime_error("zh::ComputePipeline::createPipeline: FAILED TO CREATE PIPELINE LAYOUT");
+
+    // Compute Pipeline
+    VkComputePipelineCreateInfo compute_pipeline_info{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    compute_pipeline_info.stage = shader_stage_info;
+    compute_pipeline_info.layout = pipelineLayout;
+    compute_pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+    compute_pipeline_info.basePipelineIndex = -1;
+
+    if (vkCreateComputePipelines(device.getLogicalDevice(), device.getPipelineCache().getHandle(), 1,
+                                 &compute_pipeline_info, nullptr, &pipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("zh::ComputePipeline::createPipeline: FAILED TO CREATE COMPUTE PIPELINE");
+    }
+
+    vkDestroyShaderModule(device.getLogicalDevice(), shader_module, nullptr);
+}
@@ -47,7 +47,7 @@ zh::DescriptorSetLayout::DescriptorSetLayout(Device &device,
 
 zh::DescriptorSetLayout::~DescriptorSetLayout()
 {
-    vkDestroyDescriptorSetLayout(device.getLogicalDevice(), descriptorSetLayout, nullptr);
+    device.getDeletionQueue().push(descriptorSetLayout);
 }
 
 VkDescriptorSetLayout zh::DescriptorSetLayout::getDescriptorSetLayout() const
@@ -81,7 +81,8 @@ zh::DescriptorPool::DescriptorPool(Device &device, const uint32_t max_sets, VkDe
 
 zh::DescriptorPool::~DescriptorPool()
 {
-    vkDestroyDescriptorPool(device.getLogicalDevice(), descriptorPool, nullptr);
+    // Frames in flight may still have sets from this pool bound.
+    device.getDeletionQueue().push(descriptorPool);
 }
 
 const bool zh::DescriptorPool::allocateDescriptor(const VkDescriptorSetLayout descriptor_set_layout,
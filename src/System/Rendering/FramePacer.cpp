@@ -0,0 +1,258 @@
+#include "stdafx.hpp"
+#include "System/Rendering/FramePacer.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
+
+zh::FramePacer::FramePacer(Device &device, const Policy policy, const uint32_t frame_count)
+    : device(device), policy(policy), frameCount(frame_count), timestampPeriod(0.0), timestampMask(0),
+      waitForPresent(nullptr), averageCpuTime(0.0), averageGpuTime(0.0)
+{
+    createQueryPool();
+
+    if (device.isPresentWaitEnabled())
+        waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+            vkGetDeviceProcAddr(device.getLogicalDevice(), "vkWaitForPresentKHR"));
+}
+
+zh::FramePacer::~FramePacer() = default;
+
+VkPresentModeKHR zh::FramePacer::choosePresentMode(const Policy policy,
+                                                   const std::vector<VkPresentModeKHR> &available_modes)
+{
+    std::vector<VkPresentModeKHR> preferred_modes;
+
+    switch (policy)
+    {
+    // Immediate presentation tears, which the default policy must not do.
+    case Policy::Throughput:
+    case Policy::LowLatency:
+        preferred_modes = {VK_PRESENT_MODE_MAILBOX_KHR};
+        break;
+    case Policy::PowerSaver:
+        break;
+    }
+
+    for (auto const &preferred_mode : preferred_modes)
+    {
+        if (std::find(available_modes.begin(), available_modes.end(), preferred_mode) != available_modes.end())
+            return preferred_mode;
+    }
+
+    // The only mode every surface supports.
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+void zh::FramePacer::waitForFrameStart(VkSwapchainKHR swapchain)
+{
+    ZH_PROFILE_SCOPE("zh::FramePacer::waitForFrameStart");
+
+    FrameTimeline &timeline = device.getFrameTimeline();
+    const uint64_t frame = timeline.getPendingFrame();
+    const Clock::time_point wait_start = Clock::now();
+
+    collect(swapchain);
+
+    switch (policy)
+    {
+    case Policy::Throughput:
+        break;
+    case Policy::LowLatency:
+        if (frame > 2)
+            waitForPresentation(frame - 2, swapchain);
+
+        // While the previous frame is still on the GPU, starting now would only queue this one behind it. Starting
+        // so that it is recorded just as the GPU frees up samples input as late as possible.
+        if (!pending.empty() && !timeline.isComplete(pending.back().timings.frame))
+        {
+            const double remaining_gpu_time = averageGpuTime - elapsed(pending.back().submission, Clock::now());
+            const double delay = remaining_gpu_time - averageCpuTime - LOW_LATENCY_MARGIN;
+
+            if (delay > 0.0)
+                std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(delay));
+        }
+        break;
+    case Policy::PowerSaver:
+        if (frame > 1)
+            waitForPresentation(frame - 1, swapchain);
+        break;
+    }
+
+    current = PendingFrame{};
+    current.timings.frame = frame;
+    current.start = Clock::now();
+    current.timings.pacingDelay = elapsed(wait_start, current.start);
+}
+
+void zh::FramePacer::beginFrame(VkCommandBuffer &command_buffer, const int frame_index)
+{
+    assert(frame_index >= 0 && frame_index < frameCount && "zh::FramePacer::beginFrame: FRAME INDEX OUT OF BOUNDS");
+
+    current.frameIndex = frame_index;
+
+    // The frame that last used this slot has completed, so its timestamps are read before they are reset.
+    for (auto &pending_frame : pending)
+    {
+        if (pending_frame.frameIndex == frame_index)
+            readGpuTime(pending_frame);
+    }
+
+    if (queryPools == nullptr)
+        return;
+
+    queryPools->reset(command_buffer, frame_index);
+    vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, queryPools->getPool(frame_index), 0);
+}
+
+void zh::FramePacer::endFrame(VkCommandBuffer &command_buffer, const int frame_index)
+{
+    assert(frame_index >= 0 && frame_index < frameCount && "zh::FramePacer::endFrame: FRAME INDEX OUT OF BOUNDS");
+
+    if (queryPools == nullptr)
+        return;
+
+    vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPools->getPool(frame_index), 1);
+    current.isTimed = true;
+}
+
+void zh::FramePacer::markSubmitted(VkSwapchainKHR swapchain)
+{
+    current.submission = Clock::now();
+    current.swapchain = swapchain;
+    current.timings.cpuTime = elapsed(current.start, current.submission);
+
+    if (averageCpuTime == 0.0)
+        averageCpuTime = current.timings.cpuTime;
+    else
+        averageCpuTime += (current.timings.cpuTime - averageCpuTime) * SMOOTHING;
+
+    pending.push_back(current);
+}
+
+const zh::FramePacer::Policy zh::FramePacer::getPolicy() const
+{
+    return policy;
+}
+
+const double zh::FramePacer::getAverageCpuTime() const
+{
+    return averageCpuTime;
+}
+
+const double zh::FramePacer::getAverageGpuTime() const
+{
+    return averageGpuTime;
+}
+
+const std::deque<zh::FramePacer::FrameTimings> &zh::FramePacer::getTimings() const
+{
+    return history;
+}
+
+void zh::FramePacer::createQueryPool()
+{
+    const FrameQueryPools::TimestampProperties properties = FrameQueryPools::getTimestampProperties(device);
+
+    // Without timestamps the GPU time stays at zero and low latency pacing falls back to presentation waits.
+    if (properties.mask == 0)
+        return;
+
+    timestampPeriod = properties.period;
+    timestampMask = properties.mask;
+
+    // The start and end of the frame's command buffer.
+    VkQueryPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    pool_info.queryCount = 2;
+
+    queryPools = std::make_unique<FrameQueryPools>(device, frameCount, pool_info, "TIMESTAMP");
+}
+
+void zh::FramePacer::collect(VkSwapchainKHR swapchain)
+{
+    FrameTimeline &timeline = device.getFrameTimeline();
+    const Clock::time_point now = Clock::now();
+
+    while (!pending.empty())
+    {
+        PendingFrame &pending_frame = pending.front();
+
+        if (!timeline.isComplete(pending_frame.timings.frame))
+            break;
+
+        readGpuTime(pending_frame);
+
+        // Presentation to a retired swapchain can no longer be observed; completion is the best there is.
+        if (waitForPresent != nullptr && pending_frame.swapchain == swapchain)
+        {
+            VkResult result =
+                waitForPresent(device.getLogicalDevice(), swapchain, pending_frame.timings.frame, 0);
+
+            if (result == VK_TIMEOUT)
+                break;
+
+            pending_frame.timings.isPresented = result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR;
+        }
+
+        pending_frame.timings.latency = elapsed(pending_frame.start, now);
+
+        history.push_back(pending_frame.timings);
+
+        if (history.size() > HISTORY_SIZE)
+            history.pop_front();
+
+        pending.pop_front();
+    }
+}
+
+void zh::FramePacer::waitForPresentation(const uint64_t frame, VkSwapchainKHR swapchain)
+{
+    auto pending_frame = std::find_if(pending.begin(), pending.end(), [frame](const PendingFrame &pending_frame) {
+        return pending_frame.timings.frame == frame;
+    });
+
+    // Collected frames were already presented, or completed when presentation cannot be observed.
+    if (pending_frame == pending.end())
+        return;
+
+    if (waitForPresent != nullptr && pending_frame->swapchain == swapchain)
+    {
+        VkResult result = waitForPresent(device.getLogicalDevice(), swapchain, frame, PRESENT_WAIT_TIMEOUT);
+
+        if (result == VK_ERROR_DEVICE_LOST)
+            throw std::runtime_error("zh::FramePacer::waitForPresentation: DEVICE LOST WHILE WAITING FOR PRESENT");
+
+        // Out of date swapchains are recreated by the renderer; the timeline wait below covers them meanwhile.
+        if (result == VK_SUCCESS)
+            return;
+    }
+
+    device.getFrameTimeline().wait(frame);
+}
+
+void zh::FramePacer::readGpuTime(PendingFrame &pending_frame)
+{
+    if (pending_frame.hasGpuTime)
+        return;
+
+    pending_frame.hasGpuTime = true;
+
+    if (!pending_frame.isTimed)
+        return;
+
+    uint64_t timestamps[2] = {};
+
+    if (!queryPools->readResults(pending_frame.frameIndex, 2, sizeof(uint64_t), timestamps))
+        return;
+
+    const uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+    pending_frame.timings.gpuTime = static_cast<double>(ticks) * timestampPeriod / 1e6;
+
+    if (averageGpuTime == 0.0)
+        averageGpuTime = pending_frame.timings.gpuTime;
+    else
+        averageGpuTime += (pending_frame.timings.gpuTime - averageGpuTime) * SMOOTHING;
+}
+
+const double zh::FramePacer::elapsed(const Clock::time_point &from, const Clock::time_point &to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
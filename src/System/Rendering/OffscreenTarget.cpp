@@ -0,0 +1,401 @@
+#include "stdafx.hpp"
+#include "System/Rendering/OffscreenTarget.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
+#include "System/Profiling/RenderStats.hpp"
+
+zh::OffscreenTarget::OffscreenTarget(Device &device) : OffscreenTarget(device, Settings{})
+{
+}
+
+zh::OffscreenTarget::OffscreenTarget(Device &device, const Settings &settings)
+    : device(device), settings(settings), depthFormat(VK_FORMAT_UNDEFINED), nextImage(0), lastImage(0)
+{
+    if (settings.framesInFlight == 0)
+        throw std::runtime_error("zh::OffscreenTarget::OffscreenTarget: AT LEAST ONE FRAME MUST BE IN FLIGHT");
+
+    if (settings.extent.width == 0 || settings.extent.height == 0)
+        throw std::runtime_error("zh::OffscreenTarget::OffscreenTarget: EXTENT CANNOT BE ZERO");
+
+    if (this->settings.imageCount == 0)
+        this->settings.imageCount = settings.framesInFlight;
+
+    createImages();
+    createDepthResources();
+}
+
+zh::OffscreenTarget::~OffscreenTarget()
+{
+    DeletionQueue &deletion_queue = device.getDeletionQueue();
+
+    for (int i = 0; i < images.size(); i++)
+    {
+        deletion_queue.push(imageViews[i]);
+        deletion_queue.push(images[i], imagesMemory[i]);
+        deletion_queue.push(depthImageViews[i]);
+        deletion_queue.push(depthImages[i], depthImagesMemory[i]);
+    }
+}
+
+VkResult zh::OffscreenTarget::acquireNextImage(uint32_t *image_index)
+{
+    ZH_PROFILE_SCOPE("zh::OffscreenTarget::acquireNextImage");
+
+    FrameTimeline &timeline = device.getFrameTimeline();
+    const uint64_t frame = timeline.getPendingFrame();
+
+    if (frame > settings.framesInFlight)
+        timeline.wait(frame - settings.framesInFlight);
+
+    // Frames on the one queue render in order, so an image still used by an earlier frame needs no wait.
+    *image_index = nextImage;
+    nextImage = (nextImage + 1) % static_cast<uint32_t>(images.size());
+
+    return VK_SUCCESS;
+}
+
+VkResult zh::OffscreenTarget::submitCommandBuffers(const VkCommandBuffer &buffers, uint32_t &image_index)
+{
+    ZH_PROFILE_SCOPE("zh::OffscreenTarget::submitCommandBuffers");
+
+    FrameTimeline &timeline = device.getFrameTimeline();
+    const uint64_t frame = timeline.getPendingFrame();
+
+    imageFrames[image_index] = frame;
+    lastImage = image_index;
+
+    VkTimelineSemaphoreSubmitInfo timeline_info{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    timeline_info.signalSemaphoreValueCount = 1;
+    timeline_info.pSignalSemaphoreValues = &frame;
+
+    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.pNext = &timeline_info;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &buffers;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &timeline.getSemaphore();
+
+    if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+        throw std::runtime_error("zh::OffscreenTarget::submitCommandBuffers: FAILED TO SUBMIT DRAW COMMAND BUFFER");
+
+    timeline.markSubmitted(frame);
+
+    return VK_SUCCESS;
+}
+
+const int zh::OffscreenTarget::getFrameIndex() const
+{
+    return static_cast<int>(device.getFrameTimeline().getPendingFrame() % settings.framesInFlight);
+}
+
+const uint32_t zh::OffscreenTarget::getFramesInFlight() const
+{
+    return settings.framesInFlight;
+}
+
+const VkImageLayout zh::OffscreenTarget::getFinalLayout() const
+{
+    return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+}
+
+VkExtent2D &zh::OffscreenTarget::getExtent()
+{
+    return settings.extent;
+}
+
+const VkFormat &zh::OffscreenTarget::getDepthFormat() const
+{
+    return depthFormat;
+}
+
+const VkFormat &zh::OffscreenTarget::getImageFormat() const
+{
+    return settings.format;
+}
+
+const float zh::OffscreenTarget::getAspectRatio() const
+{
+    return static_cast<float>(settings.extent.width) / static_cast<float>(settings.extent.height);
+}
+
+const size_t zh::OffscreenTarget::getImageCount() const
+{
+    return images.size();
+}
+
+VkImage &zh::OffscreenTarget::getImage(const int index)
+{
+    if (index >= images.size() || index < 0)
+        throw std::runtime_error("zh::OffscreenTarget::getImage: IMAGE INDEX OUT OF BOUNDS");
+
+    return images[index];
+}
+
+VkImageView &zh::OffscreenTarget::getImageView(const int index)
+{
+    if (index >= imageViews.size() || index < 0)
+        throw std::runtime_error("zh::OffscreenTarget::getImageView: IMAGE VIEW INDEX OUT OF BOUNDS");
+
+    return imageViews[index];
+}
+
+VkImage &zh::OffscreenTarget::getDepthImage(const int index)
+{
+    if (index >= depthImages.size() || index < 0)
+        throw std::runtime_error("zh::OffscreenTarget::getDepthImage: DEPTH IMAGE INDEX OUT OF BOUNDS");
+
+    return depthImages[index];
+}
+
+VkImageView &zh::OffscreenTarget::getDepthImageView(const int index)
+{
+    if (index >= depthImageViews.size() || index < 0)
+        throw std::runtime_error("zh::OffscreenTarget::getDepthImageView: DEPTH IMAGE VIEW INDEX OUT OF BOUNDS");
+
+    return depthImageViews[index];
+}
+
+const std::vector<VkImageView> &zh::OffscreenTarget::getDepthImageViews() const
+{
+    return depthImageViews;
+}
+
+const zh::OffscreenTarget::Settings &zh::OffscreenTarget::getSettings() const
+{
+    return settings;
+}
+
+const uint32_t zh::OffscreenTarget::getLastImageIndex() const
+{
+    return lastImage;
+}
+
+void zh::OffscreenTarget::readPixels(const uint32_t image_index, std::vector<uint8_t> &pixels)
+{
+    ZH_PROFILE_SCOPE("zh::OffscreenTarget::readPixels");
+
+    if (image_index >= images.size())
+        throw std::runtime_error("zh::OffscreenTarget::readPixels: IMAGE INDEX OUT OF BOUNDS");
+
+    if (imageFrames[image_index] == 0)
+        throw std::runtime_error("zh::OffscreenTarget::readPixels: IMAGE WAS NEVER RENDERED TO");
+
+    device.getFrameTimeline().wait(imageFrames[image_index]);
+
+    const VkDeviceSize size =
+        static_cast<VkDeviceSize>(settings.extent.width) * settings.extent.height * getFormatSize(settings.format);
+
+    Buffer readback_buffer(device.getAllocator(), size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+
+    VkCommandBuffer command_buffer;
+    VkCommandBufferAllocateInfo alloc_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandPool = device.getTransientCommandPool();
+    alloc_info.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(device.getLogicalDevice(), &alloc_info, &command_buffer) != VK_SUCCESS)
+        throw std::runtime_error("zh::OffscreenTarget::readPixels: FAILED TO ALLOCATE COMMAND BUFFER");
+
+    const auto free_command_buffer = [&]() {
+        vkFreeCommandBuffers(device.getLogicalDevice(), device.getTransientCommandPool(), 1, &command_buffer);
+    };
+
+    VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+    {
+        free_command_buffer();
+        throw std::runtime_error("zh::OffscreenTarget::readPixels: FAILED TO BEGIN RECORDING COMMAND BUFFER");
+    }
+
+    // The frame left the image in the transfer source layout; only its writes must be made visible to the copy.
+    VkImageMemoryBarrier2 image_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    image_barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    image_barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    image_barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    image_barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+    image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.image = images[image_index];
+    image_barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    VkDependencyInfo dependency_info{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependency_info.imageMemoryBarrierCount = 1;
+    dependency_info.pImageMemoryBarriers = &image_barrier;
+
+    vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+    ZH_STAT_INCREMENT(Barriers);
+
+    VkBufferImageCopy copy_region{};
+    copy_region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    copy_region.imageExtent = {settings.extent.width, settings.extent.height, 1};
+
+    vkCmdCopyImageToBuffer(command_buffer, images[image_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           readback_buffer.getBuffer(), 1, &copy_region);
+
+    VkMemoryBarrier2 host_barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    host_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    host_barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    host_barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    host_barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+    VkDependencyInfo host_dependency_info{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    host_dependency_info.memoryBarrierCount = 1;
+    host_dependency_info.pMemoryBarriers = &host_barrier;
+
+    vkCmdPipelineBarrier2(command_buffer, &host_dependency_info);
+    ZH_STAT_INCREMENT(Barriers);
+
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+    {
+        free_command_buffer();
+        throw std::runtime_error("zh::OffscreenTarget::readPixels: FAILED TO RECORD COMMAND BUFFER");
+    }
+
+    VkSubmitInfo submit_info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+
+    VkFenceCreateInfo fence_info{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VkFence fence;
+
+    if (vkCreateFence(device.getLogicalDevice(), &fence_info, nullptr, &fence) != VK_SUCCESS)
+    {
+        free_command_buffer();
+        throw std::runtime_error("zh::OffscreenTarget::readPixels: FAILED TO CREATE FENCE");
+    }
+
+    if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submit_info, fence) != VK_SUCCESS)
+    {
+        vkDestroyFence(device.getLogicalDevice(), fence, nullptr);
+        free_command_buffer();
+        throw std::runtime_error("zh::OffscreenTarget::readPixels: FAILED TO SUBMIT READBACK COMMAND BUFFER");
+    }
+
+    VkResult wait_result;
+
+    {
+        ZH_PROFILE_SCOPE("zh::OffscreenTarget::readPixels: fence wait");
+        wait_result = vkWaitForFences(device.getLogicalDevice(), 1, &fence, VK_TRUE, UINT64_MAX);
+    }
+
+    // A failed wait, e.g. a lost device, leaves the command buffer possibly pending, so it is not freed then.
+    if (wait_result != VK_SUCCESS)
+        throw std::runtime_error("zh::OffscreenTarget::readPixels: FAILED TO WAIT FOR READBACK");
+
+    vkDestroyFence(device.getLogicalDevice(), fence, nullptr);
+    free_command_buffer();
+
+    void *data = nullptr;
+
+    if (vmaMapMemory(device.getAllocator(), readback_buffer.getMemory(), &data) != VK_SUCCESS)
+        throw std::runtime_error("zh::OffscreenTarget::readPixels: FAILED TO MAP READBACK BUFFER");
+
+    pixels.resize(size);
+    std::memcpy(pixels.data(), data, size);
+
+    vmaUnmapMemory(device.getAllocator(), readback_buffer.getMemory());
+}
+
+void zh::OffscreenTarget::createImages()
+{
+    images.resize(settings.imageCount);
+    imagesMemory.resize(settings.imageCount);
+    imageViews.resize(settings.imageCount);
+    imageFrames.resize(settings.imageCount, 0);
+
+    for (int i = 0; i < images.size(); i++)
+    {
+        VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.extent.width = settings.extent.width;
+        image_info.extent.height = settings.extent.height;
+        image_info.extent.depth = 1;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.format = settings.format;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_info.usage =
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, images[i], imagesMemory[i]);
+        imageViews[i] = createImageView(images[i], settings.format, VK_IMAGE_ASPECT_COLOR_BIT);
+    }
+}
+
+void zh::OffscreenTarget::createDepthResources()
+{
+    depthFormat = device.findSupportedFormat(
+        {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT}, VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+    depthImages.resize(images.size());
+    depthImagesMemory.resize(images.size());
+    depthImageViews.resize(images.size());
+
+    for (int i = 0; i < depthImages.size(); i++)
+    {
+        VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.extent.width = settings.extent.width;
+        image_info.extent.height = settings.extent.height;
+        image_info.extent.depth = 1;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.format = depthFormat;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImages[i],
+                                   depthImagesMemory[i]);
+        depthImageViews[i] = createImageView(depthImages[i], depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+    }
+}
+
+VkImageView zh::OffscreenTarget::createImageView(VkImage image, const VkFormat format,
+                                                 const VkImageAspectFlags aspect)
+{
+    VkImageViewCreateInfo view_info{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    view_info.image = image;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = format;
+    view_info.subresourceRange = {aspect, 0, 1, 0, 1};
+
+    VkImageView view;
+
+    if (vkCreateImageView(device.getLogicalDevice(), &view_info, nullptr, &view) != VK_SUCCESS)
+        throw std::runtime_error("zh::OffscreenTarget::createImageView: FAILED TO CREATE IMAGE VIEW");
+
+    return view;
+}
+
+const uint32_t zh::OffscreenTarget::getFormatSize(const VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_UNORM:
+        return 1;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+        return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 16;
+    default:
+        throw std::runtime_error("zh::OffscreenTarget::getFormatSize: UNSUPPORTED IMAGE FORMAT FOR READBACK");
+    }
+}
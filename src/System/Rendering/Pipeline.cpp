@@ -1,20 +1,54 @@
 #include "stdafx.hpp"
 #include "System/Rendering/Pipeline.hpp"
+#include "System/Profiling/RenderStats.hpp"
 
-zh::Pipeline::Pipeline(Device &device, Swapchain &swapchain, const std::string &vertex_shader_path,
-                       const std::string &fragment_shader_path)
-    : device(device), swapchain(swapchain)
+zh::Pipeline::Pipeline(Device &device, RenderTarget &target, const std::string &vertex_shader_path,
+                       const std::string &fragment_shader_path,
+                       const std::vector<VkDescriptorSetLayout> &descriptor_set_layouts)
+    : device(device), target(target)
 {
-    createPipeline(vertex_shader_path, fragment_shader_path);
+    id = idCounter++;
+    ++generation;
+    createPipeline(vertex_shader_path, fragment_shader_path, descriptor_set_layouts);
 }
 
 zh::Pipeline::~Pipeline()
 {
-    vkDestroyPipelineLayout(device.getLogicalDevice(), pipelineLayout, nullptr);
-    vkDestroyPipeline(device.getLogicalDevice(), pipeline, nullptr);
+    ++generation;
+
+    // Frames in flight may still be bound to it.
+    device.getDeletionQueue().push(pipeline);
+    device.getDeletionQueue().push(pipelineLayout);
+}
+
+void zh::Pipeline::bind(VkCommandBuffer &command_buffer)
+{
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    ZH_STAT_INCREMENT(PipelineBinds);
+}
+
+VkPipeline &zh::Pipeline::getHandle()
+{
+    return pipeline;
+}
+
+VkPipelineLayout &zh::Pipeline::getLayout()
+{
+    return pipelineLayout;
 }
 
-void zh::Pipeline::createPipeline(const std::string &vertex_shader_path, const std::string &fragment_shader_path)
+const uint32_t zh::Pipeline::getId() const
+{
+    return id;
+}
+
+const uint64_t zh::Pipeline::getGeneration()
+{
+    return generation;
+}
+
+void zh::Pipeline::createPipeline(const std::string &vertex_shader_path, const std::string &fragment_shader_path,
+                                  const std::vector<VkDescriptorSetLayout> &descriptor_set_layouts)
 {
     VkShaderModule vert_shader_module;
     VkShaderModule frag_shader_module;
@@ -23,8 +57,8 @@ void zh::Pipeline::createPipeline(const std::string &vertex_shader_path, const s
         auto vert_shader_bytecode = readFile(vertex_shader_path);
         auto frag_shader_bytecode = readFile(fragment_shader_path);
 
-        vert_shader_module = createShaderModule(vert_shader_bytecode);
-        frag_shader_module = createShaderModule(frag_shader_bytecode);
+        vert_shader_module = createShaderModule(device, vert_shader_bytecode);
+        frag_shader_module = createShaderModule(device, frag_shader_bytecode);
     }
 
     // Shader States
@@ -50,14 +84,22 @@ void zh::Pipeline::createPipeline(const std::string &vertex_shader_path, const s
     dynamic_state_info.dynamicStateCount = static_cast<uint32_t>(dynamic_states.size());
     dynamic_state_info.pDynamicStates = dynamic_states.data();
 
-    // Vertex Input State
-    auto binding_description = Vertex::getBindingDescription();
-    auto attribute_descriptions = Vertex::getAttributeDescriptions();
+    // Vertex Input State (binding 0: per vertex, binding 1: per instance)
+    std::array<VkVertexInputBindingDescription, 2> binding_descriptions = {Vertex::getBindingDescription(),
+                                                                           InstanceData::getBindingDescription()};
+
+    auto vertex_attribute_descriptions = Vertex::getAttributeDescriptions();
+    auto instance_attribute_descriptions = InstanceData::getAttributeDescriptions();
+
+    std::vector<VkVertexInputAttributeDescription> attribute_descriptions(vertex_attribute_descriptions.begin(),
+                                                                          vertex_attribute_descriptions.end());
+    attribute_descriptions.insert(attribute_descriptions.end(), instance_attribute_descriptions.begin(),
+                                  instance_attribute_descriptions.end());
 
     VkPipelineVertexInputStateCreateInfo vertex_input_state_info{
         VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
-    vertex_input_state_info.vertexBindingDescriptionCount = 1;
-    vertex_input_state_info.pVertexBindingDescriptions = &binding_description;
+    vertex_input_state_info.vertexBindingDescriptionCount = static_cast<uint32_t>(binding_descriptions.size());
+    vertex_input_state_info.pVertexBindingDescriptions = binding_descriptions.data();
     vertex_input_state_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attribute_descriptions.size());
     vertex_input_state_info.pVertexAttributeDescriptions = attribute_descriptions.data();
 
@@ -96,7 +138,15 @@ void zh::Pipeline::createPipeline(const std::string &vertex_shader_path, const s
     multisample_state_info.alphaToCoverageEnable = VK_FALSE;
     multisample_state_info.alphaToOneEnable = VK_FALSE;
 
-    // TODO: Depth and Stencil State
+    // Depth and Stencil State
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state{VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+    depth_stencil_state.depthTestEnable = VK_TRUE;
+    depth_stencil_state.depthWriteEnable = VK_TRUE;
+    depth_stencil_state.depthCompareOp = VK_COMPARE_OP_LESS;
+    depth_stencil_state.depthBoundsTestEnable = VK_FALSE;
+    depth_stencil_state.minDepthBounds = 0.f;
+    depth_stencil_state.maxDepthBounds = 1.f;
+    depth_stencil_state.stencilTestEnable = VK_FALSE;
 
     // Color Blending State
     VkPipelineColorBlendAttachmentState color_blending_attachment_state{};
@@ -122,10 +172,8 @@ void zh::Pipeline::createPipeline(const std::string &vertex_shader_path, const s
 
     // Pipeline Layout
     VkPipelineLayoutCreateInfo pipeline_layout_info{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
-    // pipeline_layout_info.setLayoutCount = 1;
-    // pipeline_layout_info.pSetLayouts = &descriptorSetLayout; // TEMP!!!
-    pipeline_layout_info.setLayoutCount = 0;
-    pipeline_layout_info.pSetLayouts = nullptr;
+    pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(descriptor_set_layouts.size());
+    pipeline_layout_info.pSetLayouts = descriptor_set_layouts.empty() ? nullptr : descriptor_set_layouts.data();
     pipeline_layout_info.pushConstantRangeCount = 0;
     pipeline_layout_info.pPushConstantRanges = nullptr;
 
@@ -133,8 +181,16 @@ void zh::Pipeline::createPipeline(const std::string &vertex_shader_path, const s
         VK_SUCCESS)
         throw std::runtime_error("zh::Pipeline::createPipeline: FAILED TO CREATE PIPELINE LAYOUT");
 
+    // Dynamic Rendering
+    VkPipelineRenderingCreateInfo rendering_info{VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+    rendering_info.colorAttachmentCount = 1;
+    rendering_info.pColorAttachmentFormats = &target.getImageFormat();
+    rendering_info.depthAttachmentFormat = target.getDepthFormat();
+    rendering_info.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+
     // Graphics Pipeline
     VkGraphicsPipelineCreateInfo graphics_pipeline_info{VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+    graphics_pipeline_info.pNext = &rendering_info;
     graphics_pipeline_info.stageCount = 2;
     graphics_pipeline_info.pStages = shader_stages;
     graphics_pipeline_info.pVertexInputState = &vertex_input_state_info;
@@ -142,17 +198,17 @@ void zh::Pipeline::createPipeline(const std::string &vertex_shader_path, const s
     graphics_pipeline_info.pViewportState = &viewport_state_info;
     graphics_pipeline_info.pRasterizationState = &rasterization_state_info;
     graphics_pipeline_info.pMultisampleState = &multisample_state_info;
-    graphics_pipeline_info.pDepthStencilState = nullptr;
+    graphics_pipeline_info.pDepthStencilState = &depth_stencil_state;
     graphics_pipeline_info.pColorBlendState = &color_blending_state;
     graphics_pipeline_info.pDynamicState = &dynamic_state_info;
     graphics_pipeline_info.layout = pipelineLayout;
-    graphics_pipeline_info.renderPass = swapchain.getRenderPass();
+    graphics_pipeline_info.renderPass = VK_NULL_HANDLE;
     graphics_pipeline_info.subpass = 0;
     graphics_pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
     graphics_pipeline_info.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device.getLogicalDevice(), VK_NULL_HANDLE, 1, &graphics_pipeline_info, nullptr,
-                                  &pipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(device.getLogicalDevice(), device.getPipelineCache().getHandle(), 1,
+                                  &graphics_pipeline_info, nullptr, &pipeline) != VK_SUCCESS)
     {
         throw std::runtime_error("zh::Pipeline::createPipeline: FAILED TO CREATE GRAPHICS PIPELINE");
     }
@@ -179,7 +235,7 @@ const std::vector<uint8_t> zh::Pipeline::readFile(const std::string &path)
     return f_data;
 }
 
-VkShaderModule zh::Pipeline::createShaderModule(std::vector<uint8_t> &code)
+VkShaderModule zh::Pipeline::createShaderModule(Device &device, std::vector<uint8_t> &code)
 {
     VkShaderModule shader_module;
 
@@ -0,0 +1,180 @@
+#include "stdafx.hpp"
+#include "System/Rendering/PipelineCache.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
+
+#include <random>
+
+zh::PipelineCache::PipelineCache(VkDevice &device, VkPhysicalDevice &physical_device, const std::string &path)
+    : device(device), path(path), cache(VK_NULL_HANDLE), loaded(false)
+{
+    ZH_PROFILE_SCOPE("zh::PipelineCache::PipelineCache");
+
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+    const std::vector<uint8_t> data = readData();
+
+    VkPipelineCacheCreateInfo cache_info{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    cache_info.initialDataSize = data.size();
+    cache_info.pInitialData = data.empty() ? nullptr : data.data();
+
+    // Drivers may still reject data they consider stale; start out empty rather than failing.
+    if (vkCreatePipelineCache(device, &cache_info, nullptr, &cache) == VK_SUCCESS)
+    {
+        loaded = !data.empty();
+        return;
+    }
+
+    cache_info.initialDataSize = 0;
+    cache_info.pInitialData = nullptr;
+
+    if (vkCreatePipelineCache(device, &cache_info, nullptr, &cache) != VK_SUCCESS)
+        throw std::runtime_error("zh::PipelineCache::PipelineCache: FAILED TO CREATE PIPELINE CACHE");
+}
+
+zh::PipelineCache::~PipelineCache()
+{
+    save();
+    vkDestroyPipelineCache(device, cache, nullptr);
+}
+
+VkPipelineCache &zh::PipelineCache::getHandle()
+{
+    return cache;
+}
+
+const bool zh::PipelineCache::save()
+{
+    ZH_PROFILE_SCOPE("zh::PipelineCache::save");
+
+    // Keeps the pipelines another instance compiled and saved while this one was running.
+    const std::vector<uint8_t> disk_data = readData();
+
+    if (!disk_data.empty())
+    {
+        VkPipelineCacheCreateInfo cache_info{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+        cache_info.initialDataSize = disk_data.size();
+        cache_info.pInitialData = disk_data.data();
+
+        VkPipelineCache disk_cache;
+        if (vkCreatePipelineCache(device, &cache_info, nullptr, &disk_cache) == VK_SUCCESS)
+        {
+            vkMergePipelineCaches(device, cache, 1, &disk_cache);
+            vkDestroyPipelineCache(device, disk_cache, nullptr);
+        }
+    }
+
+    size_t data_size = 0;
+    if (vkGetPipelineCacheData(device, cache, &data_size, nullptr) != VK_SUCCESS || data_size == 0)
+        return false;
+
+    std::vector<uint8_t> data(data_size);
+    if (vkGetPipelineCacheData(device, cache, &data_size, data.data()) != VK_SUCCESS)
+        return false;
+
+    data.resize(data_size);
+
+    const FileHeader header{MAGIC, properties.driverVersion, data.size(), computeChecksum(data.data(), data.size())};
+
+    // Written next to the file and renamed over it, so readers never see a partial file. The random suffix keeps
+    // processes saving at the same time from writing into, or renaming, each other's temporary file.
+    std::random_device random;
+    const std::string temp_path = path + "." + std::to_string((uint64_t(random()) << 32) | random()) + ".tmp";
+
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open())
+            return false;
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        file.flush();
+
+        if (!file.good())
+        {
+            file.close();
+
+            std::error_code error;
+            std::filesystem::remove(temp_path, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+
+    if (error)
+    {
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    return true;
+}
+
+const bool zh::PipelineCache::isLoaded() const
+{
+    return loaded;
+}
+
+const std::string &zh::PipelineCache::getPath() const
+{
+    return path;
+}
+
+const std::vector<uint8_t> zh::PipelineCache::readData() const
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+        return {};
+
+    const std::streamoff file_size = file.tellg();
+
+    if (file_size < static_cast<std::streamoff>(sizeof(FileHeader)))
+        return {};
+
+    FileHeader header;
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+    if (!file.good() || header.magic != MAGIC || header.driverVersion != properties.driverVersion ||
+        header.dataSize != static_cast<uint64_t>(file_size) - sizeof(FileHeader))
+        return {};
+
+    std::vector<uint8_t> data(header.dataSize);
+    file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size()));
+
+    if (!file.good() || computeChecksum(data.data(), data.size()) != header.checksum || !isCompatible(data))
+        return {};
+
+    return data;
+}
+
+const bool zh::PipelineCache::isCompatible(const std::vector<uint8_t> &data) const
+{
+    if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne))
+        return false;
+
+    VkPipelineCacheHeaderVersionOne header;
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) && header.headerSize <= data.size() &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header.vendorID == properties.vendorID &&
+           header.deviceID == properties.deviceID &&
+           std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+// FNV-1a, enough to catch truncation and corruption; the file is not a security boundary.
+const uint64_t zh::PipelineCache::computeChecksum(const uint8_t *data, const size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
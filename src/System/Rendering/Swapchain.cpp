@@ -1,14 +1,19 @@
 #include "stdafx.hpp"
 #include "System/Rendering/Swapchain.hpp"
+#include "System/Profiling/CpuProfiler.hpp"
 
-zh::Swapchain::Swapchain(Device &device, Window &window)
-    : device(device), window(window), oldSwapchain(VK_NULL_HANDLE), currentFrame(0)
+zh::Swapchain::Swapchain(Device &device, Window &window) : Swapchain(device, window, Settings{})
+{
+}
+
+zh::Swapchain::Swapchain(Device &device, Window &window, const Settings &settings)
+    : device(device), window(window), settings(settings), oldSwapchain(VK_NULL_HANDLE)
 {
     create();
 }
 
-zh::Swapchain::Swapchain(Device &device, Window &window, VkSwapchainKHR old_swapchain)
-    : device(device), window(window), oldSwapchain(old_swapchain), currentFrame(0)
+zh::Swapchain::Swapchain(Device &device, Window &window, const Settings &settings, VkSwapchainKHR old_swapchain)
+    : device(device), window(window), settings(settings), oldSwapchain(old_swapchain)
 {
     create();
 }
@@ -20,27 +25,47 @@ const bool zh::Swapchain::compareSwapFormats(const Swapchain &swapchain) const
 
 VkResult zh::Swapchain::acquireNextImage(uint32_t *image_index)
 {
-    vkWaitForFences(device.getLogicalDevice(), 1, &inFlightFences[currentFrame], VK_TRUE,
-                    std::numeric_limits<uint64_t>::max());
+    ZH_PROFILE_SCOPE("zh::Swapchain::acquireNextImage");
+
+    FrameTimeline &timeline = device.getFrameTimeline();
+    const uint64_t frame = timeline.getPendingFrame();
+
+    // The frame framesInFlight back used the same slot; its semaphore and per frame resources are free once done.
+    if (frame > settings.framesInFlight)
+        timeline.wait(frame - settings.framesInFlight);
 
+    // The semaphore must not be signaled; the submission of the previous frame in this slot has consumed it.
     VkResult result = vkAcquireNextImageKHR(device.getLogicalDevice(), swapchain, std::numeric_limits<uint64_t>::max(),
-                                            imageAvailableSemaphores[currentFrame], // must be a not signaled semaphore
-                                            VK_NULL_HANDLE, image_index);
+                                            imageAvailableSemaphores[getFrameIndex()], VK_NULL_HANDLE, image_index);
 
     return result;
 }
 
 VkResult zh::Swapchain::submitCommandBuffers(const VkCommandBuffer &buffers, uint32_t &image_index)
 {
-    if (imagesInFlight[image_index] != VK_NULL_HANDLE)
-        vkWaitForFences(device.getLogicalDevice(), 1, &imagesInFlight[image_index], VK_TRUE, UINT64_MAX);
+    ZH_PROFILE_SCOPE("zh::Swapchain::submitCommandBuffers");
 
-    imagesInFlight[image_index] = inFlightFences[currentFrame];
+    FrameTimeline &timeline = device.getFrameTimeline();
+    const uint64_t frame = timeline.getPendingFrame();
+    const int frame_index = getFrameIndex();
 
-    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    // Usually long done; only stalls when more images than frame slots are acquired out of order.
+    timeline.wait(imageFrames[image_index]);
+    imageFrames[image_index] = frame;
 
-    VkSemaphore wait_semaphores[] = {imageAvailableSemaphores[currentFrame]};
+    VkSemaphore wait_semaphores[] = {imageAvailableSemaphores[frame_index]};
     VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+
+    // The binary semaphore feeds the present, the timeline value marks the frame as complete.
+    VkSemaphore signal_semaphores[] = {renderFinishedSemaphores[image_index], timeline.getSemaphore()};
+    uint64_t signal_values[] = {0, frame};
+
+    VkTimelineSemaphoreSubmitInfo timeline_info{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    timeline_info.signalSemaphoreValueCount = 2;
+    timeline_info.pSignalSemaphoreValues = signal_values;
+
+    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.pNext = &timeline_info;
     submit_info.waitSemaphoreCount = 1;
     submit_info.pWaitSemaphores = wait_semaphores;
     submit_info.pWaitDstStageMask = wait_stages;
@@ -48,18 +73,17 @@ VkResult zh::Swapchain::submitCommandBuffers(const VkCommandBuffer &buffers, uin
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &buffers;
 
-    VkSemaphore signal_semaphores[] = {renderFinishedSemaphores[currentFrame]};
-    submit_info.signalSemaphoreCount = 1;
+    submit_info.signalSemaphoreCount = 2;
     submit_info.pSignalSemaphores = signal_semaphores;
 
-    vkResetFences(device.getLogicalDevice(), 1, &inFlightFences[currentFrame]);
-
-    if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submit_info, inFlightFences[currentFrame]) != VK_SUCCESS)
+    if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
         throw std::runtime_error("zh::Swapchain::submitCommandBuffers: FAILED TO SUBMIT DRAW COMMAND BUFFER");
 
+    timeline.markSubmitted(frame);
+
     VkPresentInfoKHR present_info = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
     present_info.waitSemaphoreCount = 1;
-    present_info.pWaitSemaphores = signal_semaphores;
+    present_info.pWaitSemaphores = &renderFinishedSemaphores[image_index];
 
     VkSwapchainKHR swapchains[] = {swapchain};
     present_info.swapchainCount = 1;
@@ -67,21 +91,40 @@ VkResult zh::Swapchain::submitCommandBuffers(const VkCommandBuffer &buffers, uin
 
     present_info.pImageIndices = &image_index;
 
-    auto result = vkQueuePresentKHR(device.getPresentQueue(), &present_info);
+    // Frame numbers only grow, so they double as present ids the frame pacer can wait on.
+    VkPresentIdKHR present_id{VK_STRUCTURE_TYPE_PRESENT_ID_KHR};
+    present_id.swapchainCount = 1;
+    present_id.pPresentIds = &frame;
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    if (device.isPresentWaitEnabled())
+        present_info.pNext = &present_id;
 
-    return result;
+    return vkQueuePresentKHR(device.getPresentQueue(), &present_info);
 }
 
-VkSwapchainKHR &zh::Swapchain::getHandle()
+const int zh::Swapchain::getFrameIndex() const
 {
-    return swapchain;
+    return static_cast<int>(device.getFrameTimeline().getPendingFrame() % settings.framesInFlight);
+}
+
+const uint32_t zh::Swapchain::getFramesInFlight() const
+{
+    return settings.framesInFlight;
 }
 
-VkRenderPass &zh::Swapchain::getRenderPass()
+const VkImageLayout zh::Swapchain::getFinalLayout() const
 {
-    return renderPass;
+    return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
+const zh::Swapchain::Settings &zh::Swapchain::getSettings() const
+{
+    return settings;
+}
+
+VkSwapchainKHR &zh::Swapchain::getHandle()
+{
+    return swapchain;
 }
 
 VkExtent2D &zh::Swapchain::getExtent()
@@ -104,49 +147,83 @@ const float zh::Swapchain::getAspectRatio() const
     return static_cast<float>(extent.width) / static_cast<float>(extent.height);
 }
 
-VkFramebuffer &zh::Swapchain::getFramebuffer(const int index)
+const size_t zh::Swapchain::getImageCount() const
 {
-    if (index >= framebuffers.size() || index < 0)
-        throw std::runtime_error("zh::Swapchain::getFramebuffer: FRAMEBUFFER INDEX OUT OF BOUNDS");
+    return images.size();
+}
 
-    return framebuffers[index];
+VkImage &zh::Swapchain::getImage(const int index)
+{
+    if (index >= images.size() || index < 0)
+        throw std::runtime_error("zh::Swapchain::getImage: IMAGE INDEX OUT OF BOUNDS");
+
+    return images[index];
 }
 
-zh::Swapchain::~Swapchain()
+VkImageView &zh::Swapchain::getImageView(const int index)
 {
-    vkDeviceWaitIdle(device.getLogicalDevice());
+    if (index >= imageViews.size() || index < 0)
+        throw std::runtime_error("zh::Swapchain::getImageView: IMAGE VIEW INDEX OUT OF BOUNDS");
+
+    return imageViews[index];
+}
 
-    vkDestroyRenderPass(device.getLogicalDevice(), renderPass, nullptr);
+VkImage &zh::Swapchain::getDepthImage(const int index)
+{
+    if (index >= depthImages.size() || index < 0)
+        throw std::runtime_error("zh::Swapchain::getDepthImage: DEPTH IMAGE INDEX OUT OF BOUNDS");
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        vkDestroySemaphore(device.getLogicalDevice(), renderFinishedSemaphores[i], nullptr);
-        vkDestroySemaphore(device.getLogicalDevice(), imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(device.getLogicalDevice(), inFlightFences[i], nullptr);
-    }
+    return depthImages[index];
+}
+
+VkImageView &zh::Swapchain::getDepthImageView(const int index)
+{
+    if (index >= depthImageViews.size() || index < 0)
+        throw std::runtime_error("zh::Swapchain::getDepthImageView: DEPTH IMAGE VIEW INDEX OUT OF BOUNDS");
+
+    return depthImageViews[index];
+}
+
+const std::vector<VkImageView> &zh::Swapchain::getDepthImageViews() const
+{
+    return depthImageViews;
+}
+
+zh::Swapchain::~Swapchain()
+{
+    // Frames in flight may still render to or present from this swapchain, so everything is retired through the
+    // deletion queue instead of waiting for the device to go idle.
+    DeletionQueue &deletion_queue = device.getDeletionQueue();
+
+    for (auto &semaphore : imageAvailableSemaphores)
+        deletion_queue.push(semaphore);
 
-    for (auto &framebuffer : framebuffers)
-        vkDestroyFramebuffer(device.getLogicalDevice(), framebuffer, nullptr);
+    for (auto &semaphore : renderFinishedSemaphores)
+        deletion_queue.push(semaphore);
 
     for (int i = 0; i < depthImages.size(); i++)
     {
-        vkDestroyImageView(device.getLogicalDevice(), depthImageViews[i], nullptr);
-        vmaDestroyImage(device.getAllocator(), depthImages[i], depthImagesMemory[i]);
+        deletion_queue.push(depthImageViews[i]);
+        deletion_queue.push(depthImages[i], depthImagesMemory[i]);
     }
 
     for (auto &view : imageViews)
-        vkDestroyImageView(device.getLogicalDevice(), view, nullptr);
+        deletion_queue.push(view);
 
-    vkDestroySwapchainKHR(device.getLogicalDevice(), swapchain, nullptr);
+    deletion_queue.push(swapchain);
 }
 
 void zh::Swapchain::create()
 {
+    if (settings.framesInFlight == 0)
+        throw std::runtime_error("zh::Swapchain::create: AT LEAST ONE FRAME MUST BE IN FLIGHT");
+
+    if (device.isHeadless())
+        throw std::runtime_error("zh::Swapchain::create: A HEADLESS DEVICE CANNOT PRESENT");
+
     createSwapchain();
     createImageViews();
     createDepthResources();
-    createRenderPass();
-    createFramebuffers();
     createSyncObjects();
 }
 
@@ -154,9 +231,11 @@ void zh::Swapchain::createSwapchain()
 {
     Device::SwapchainSupportDetails swap_chain_support = device.querySwapchainSupport(device.getPhysicalDevice());
     VkSurfaceFormatKHR format = chooseSurfaceFormat(swap_chain_support.formats);
-    VkPresentModeKHR mode = choosePresentMode(swap_chain_support.presentModes);
+    VkPresentModeKHR mode = FramePacer::choosePresentMode(settings.pacingPolicy, swap_chain_support.presentModes);
     VkExtent2D extent = chooseExtent(swap_chain_support.capabilities);
-    uint32_t image_count = swap_chain_support.capabilities.minImageCount + 1;
+    uint32_t image_count = settings.imageCount == 0
+                               ? swap_chain_support.capabilities.minImageCount + 1
+                               : std::max(settings.imageCount, swap_chain_support.capabilities.minImageCount);
 
     if (swap_chain_support.capabilities.maxImageCount > 0 &&
         image_count > swap_chain_support.capabilities.maxImageCount)
@@ -192,7 +271,8 @@ void zh::Swapchain::createSwapchain()
     create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     create_info.presentMode = mode;
     create_info.clipped = VK_TRUE;
-    create_info.oldSwapchain = VK_NULL_HANDLE;
+    // Lets the presentation engine hand images over from the retired swapchain without a gap.
+    create_info.oldSwapchain = oldSwapchain;
 
     if (vkCreateSwapchainKHR(device.getLogicalDevice(), &create_info, nullptr, &swapchain) != VK_SUCCESS)
         throw std::runtime_error("Failed to create a swapchain.");
@@ -255,7 +335,7 @@ void zh::Swapchain::createDepthResources()
         image_info.format = depthFormat;
         image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
         image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
         image_info.samples = VK_SAMPLE_COUNT_1_BIT;
         image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         image_info.flags = 0;
@@ -279,92 +359,24 @@ void zh::Swapchain::createDepthResources()
     }
 }
 
-void zh::Swapchain::createRenderPass()
-{
-    VkAttachmentDescription color_attachment{};
-    color_attachment.format = imageFormat;
-    color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference color_attachment_reference{};
-    color_attachment_reference.attachment = 0;
-    color_attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &color_attachment_reference;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    VkRenderPassCreateInfo render_pass_info{};
-    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_info.attachmentCount = 1;
-    render_pass_info.pAttachments = &color_attachment;
-    render_pass_info.subpassCount = 1;
-    render_pass_info.pSubpasses = &subpass;
-    render_pass_info.dependencyCount = 1;
-    render_pass_info.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(device.getLogicalDevice(), &render_pass_info, nullptr, &renderPass) != VK_SUCCESS)
-        throw std::runtime_error("zh::Swapchain::createImageViews: FAILED TO CREATE RENDER PASS");
-}
-
-void zh::Swapchain::createFramebuffers()
-{
-    framebuffers.resize(imageViews.size());
-
-    for (size_t i = 0; i < imageViews.size(); ++i)
-    {
-        VkImageView attachments[] = {imageViews[i]};
-
-        VkFramebufferCreateInfo create_info{};
-        create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        create_info.renderPass = renderPass;
-        create_info.attachmentCount = 1;
-        create_info.pAttachments = attachments;
-        create_info.width = extent.width;
-        create_info.height = extent.height;
-        create_info.layers = 1;
-
-        if (vkCreateFramebuffer(device.getLogicalDevice(), &create_info, nullptr, &framebuffers[i]) != VK_SUCCESS)
-            throw std::runtime_error("zh::Swapchain::createImageViews: FAILED TO CREATE FRAMEBUFFER");
-    }
-}
-
 void zh::Swapchain::createSyncObjects()
 {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    imagesInFlight.resize(images.size(), VK_NULL_HANDLE);
+    imageAvailableSemaphores.resize(settings.framesInFlight);
+    renderFinishedSemaphores.resize(images.size());
+    imageFrames.resize(images.size(), 0);
 
     VkSemaphoreCreateInfo semaphore_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
 
-    VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
-    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (auto &semaphore : imageAvailableSemaphores)
     {
-        if (vkCreateSemaphore(device.getLogicalDevice(), &semaphore_info, nullptr, &imageAvailableSemaphores[i]) !=
-                VK_SUCCESS ||
-            vkCreateSemaphore(device.getLogicalDevice(), &semaphore_info, nullptr, &renderFinishedSemaphores[i]) !=
-                VK_SUCCESS ||
-            vkCreateFence(device.getLogicalDevice(), &fence_info, nullptr, &inFlightFences[i]) != VK_SUCCESS)
-        {
+        if (vkCreateSemaphore(device.getLogicalDevice(), &semaphore_info, nullptr, &semaphore) != VK_SUCCESS)
             throw std::runtime_error("zh::Swapchain::createSyncObjects: FAILED TO CREATE SYNC OBJECTS FOR A FRAME");
-        }
+    }
+
+    for (auto &semaphore : renderFinishedSemaphores)
+    {
+        if (vkCreateSemaphore(device.getLogicalDevice(), &semaphore_info, nullptr, &semaphore) != VK_SUCCESS)
+            throw std::runtime_error("zh::Swapchain::createSyncObjects: FAILED TO CREATE SYNC OBJECTS FOR AN IMAGE");
     }
 }
 
@@ -379,17 +391,6 @@ VkSurfaceFormatKHR zh::Swapchain::chooseSurfaceFormat(const std::vector<VkSurfac
     return available_formats[0];
 }
 
-VkPresentModeKHR zh::Swapchain::choosePresentMode(const std::vector<VkPresentModeKHR> &available_modes)
-{
-    for (auto const &mode : available_modes)
-    {
-        if (mode == VK_PRESENT_MODE_MAILBOX_KHR)
-            return mode;
-    }
-
-    return VK_PRESENT_MODE_FIFO_KHR;
-}
-
 VkExtent2D zh::Swapchain::chooseExtent(const VkSurfaceCapabilitiesKHR &capabilities)
 {
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
@@ -412,5 +413,7 @@ VkExtent2D zh::Swapchain::chooseExtent(const VkSurfaceCapabilitiesKHR &capabilit
 VkFormat zh::Swapchain::findDepthFormat()
 {
     return device.findSupportedFormat({VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
-                                      VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+                                      VK_IMAGE_TILING_OPTIMAL,
+                                      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                          VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 }
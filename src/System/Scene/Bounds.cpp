@@ -0,0 +1,74 @@
+#include "stdafx.hpp"
+#include "System/Scene/Bounds.hpp"
+
+void zh::AABB::expand(const glm::vec3 &point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+const zh::AABB zh::AABB::transform(const glm::mat4 &matrix) const
+{
+    if (!isValid())
+        return *this;
+
+    const glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.f));
+    const glm::vec3 half_extent = getHalfExtent();
+
+    glm::vec3 new_half_extent{};
+    for (int i = 0; i < 3; ++i)
+    {
+        new_half_extent[i] = glm::abs(matrix[0][i]) * half_extent.x + glm::abs(matrix[1][i]) * half_extent.y +
+                             glm::abs(matrix[2][i]) * half_extent.z;
+    }
+
+    return AABB{center - new_half_extent, center + new_half_extent};
+}
+
+const zh::Frustum zh::Frustum::fromMatrix(const glm::mat4 &view_projection)
+{
+    const glm::mat4 &m = view_projection;
+
+    const glm::vec4 row0{m[0][0], m[1][0], m[2][0], m[3][0]};
+    const glm::vec4 row1{m[0][1], m[1][1], m[2][1], m[3][1]};
+    const glm::vec4 row2{m[0][2], m[1][2], m[2][2], m[3][2]};
+    const glm::vec4 row3{m[0][3], m[1][3], m[2][3], m[3][3]};
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row2; // Vulkan clip space depth is [0, 1].
+    frustum.planes[5] = row3 - row2;
+
+    for (auto &plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+
+    return frustum;
+}
+
+const bool zh::Frustum::intersects(const AABB &aabb) const
+{
+    for (auto &plane : planes)
+    {
+        const glm::vec3 positive{plane.x >= 0.f ? aabb.max.x : aabb.min.x, plane.y >= 0.f ? aabb.max.y : aabb.min.y,
+                                 plane.z >= 0.f ? aabb.max.z : aabb.min.z};
+
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.f)
+            return false;
+    }
+
+    return true;
+}
+
+const bool zh::Frustum::intersects(const glm::vec3 &center, const float radius) const
+{
+    for (auto &plane : planes)
+    {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    }
+
+    return true;
+}
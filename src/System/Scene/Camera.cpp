@@ -104,3 +104,23 @@ void Camera::setViewYXZ(glm::vec3 position, glm::vec3 rotation)
     inverseViewMatrix[3][1] = position.y;
     inverseViewMatrix[3][2] = position.z;
 }
+
+const glm::mat4 &Camera::getProjection() const
+{
+    return projectionMatrix;
+}
+
+const glm::mat4 &Camera::getView() const
+{
+    return viewMatrix;
+}
+
+const glm::mat4 &Camera::getInverseView() const
+{
+    return inverseViewMatrix;
+}
+
+const zh::Frustum Camera::getFrustum() const
+{
+    return zh::Frustum::fromMatrix(projectionMatrix * viewMatrix);
+}
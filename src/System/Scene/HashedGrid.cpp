@@ -0,0 +1,171 @@
+#include "stdafx.hpp"
+#include "System/Scene/HashedGrid.hpp"
+
+zh::HashedGrid::HashedGrid(const float cell_size) : cellSize(cell_size)
+{
+    assert(cell_size > 0.f && "zh::HashedGrid::HashedGrid: CELL SIZE MUST BE GREATER THAN ZERO");
+}
+
+void zh::HashedGrid::insert(Object &object)
+{
+    assert(locations.count(object.getId()) == 0 && "zh::HashedGrid::insert: OBJECT IS ALREADY IN THE GRID");
+
+    place(object, object.getBounds());
+}
+
+void zh::HashedGrid::remove(Object &object)
+{
+    auto it = locations.find(object.getId());
+
+    if (it == locations.end())
+        return;
+
+    erase(it->second);
+    locations.erase(it);
+}
+
+void zh::HashedGrid::update(Object &object)
+{
+    auto it = locations.find(object.getId());
+
+    if (it == locations.end())
+    {
+        insert(object);
+        return;
+    }
+
+    const AABB bounds = object.getBounds();
+    const uint64_t key = getCellKey(bounds);
+
+    // Still inside the same loose cell, only the stored bounds change.
+    if (key == it->second.cell)
+    {
+        if (key == OVERSIZED_CELL)
+            oversized[it->second.slot].bounds = bounds;
+        else
+            cells.at(key).entries[it->second.slot].bounds = bounds;
+
+        return;
+    }
+
+    erase(it->second);
+    locations.erase(it);
+    place(object, bounds);
+}
+
+void zh::HashedGrid::query(const Frustum &frustum, std::vector<Object *> &visible) const
+{
+    const glm::vec3 loose_margin{cellSize};
+
+    for (auto &[_, cell] : cells)
+    {
+        if (cell.entries.empty())
+            continue;
+
+        // A loose cell spans twice the cell size, so it contains any object centered in it.
+        const glm::vec3 cell_min = glm::vec3(cell.coord) * cellSize;
+        const AABB loose_bounds{cell_min - loose_margin * 0.5f, cell_min + loose_margin * 1.5f};
+
+        if (!frustum.intersects(loose_bounds))
+            continue;
+
+        for (auto &entry : cell.entries)
+        {
+            if (frustum.intersects(entry.bounds))
+                visible.push_back(entry.object);
+        }
+    }
+
+    for (auto &entry : oversized)
+    {
+        if (frustum.intersects(entry.bounds))
+            visible.push_back(entry.object);
+    }
+}
+
+const size_t zh::HashedGrid::getSize() const
+{
+    return locations.size();
+}
+
+const float zh::HashedGrid::getCellSize() const
+{
+    return cellSize;
+}
+
+void zh::HashedGrid::compact()
+{
+    for (auto it = cells.begin(); it != cells.end();)
+    {
+        if (it->second.entries.empty())
+            it = cells.erase(it);
+        else
+            ++it;
+    }
+}
+
+void zh::HashedGrid::clear()
+{
+    cells.clear();
+    locations.clear();
+    oversized.clear();
+}
+
+const glm::ivec3 zh::HashedGrid::getCellCoord(const glm::vec3 &position) const
+{
+    return glm::ivec3(glm::floor(position / cellSize));
+}
+
+const uint64_t zh::HashedGrid::getCellKey(const AABB &bounds) const
+{
+    const glm::vec3 half_extent = bounds.getHalfExtent();
+
+    if (!bounds.isValid() || glm::max(half_extent.x, glm::max(half_extent.y, half_extent.z)) > cellSize * 0.5f)
+        return OVERSIZED_CELL;
+
+    return hashCoord(getCellCoord(bounds.getCenter()));
+}
+
+void zh::HashedGrid::place(Object &object, const AABB &bounds)
+{
+    const uint64_t key = getCellKey(bounds);
+
+    if (key == OVERSIZED_CELL)
+    {
+        locations[object.getId()] = Location{key, static_cast<uint32_t>(oversized.size())};
+        oversized.push_back(Entry{&object, bounds});
+        return;
+    }
+
+    auto [it, inserted] = cells.try_emplace(key);
+
+    if (inserted)
+        it->second.coord = getCellCoord(bounds.getCenter());
+
+    locations[object.getId()] = Location{key, static_cast<uint32_t>(it->second.entries.size())};
+    it->second.entries.push_back(Entry{&object, bounds});
+}
+
+void zh::HashedGrid::erase(const Location &location)
+{
+    std::vector<Entry> &entries = location.cell == OVERSIZED_CELL ? oversized : cells.at(location.cell).entries;
+
+    // Swap with the last entry so removal stays O(1).
+    if (location.slot != entries.size() - 1)
+    {
+        entries[location.slot] = entries.back();
+        locations[entries[location.slot].object->getId()].slot = location.slot;
+    }
+
+    entries.pop_back();
+}
+
+const uint64_t zh::HashedGrid::hashCoord(const glm::ivec3 &coord)
+{
+    // Pack 21 bits per axis, which covers +-1M cells in every direction.
+    constexpr uint64_t mask = (1ull << 21) - 1;
+    constexpr int64_t bias = 1ll << 20;
+
+    return ((static_cast<uint64_t>(coord.x + bias) & mask) << 42) |
+           ((static_cast<uint64_t>(coord.y + bias) & mask) << 21) | (static_cast<uint64_t>(coord.z + bias) & mask);
+}
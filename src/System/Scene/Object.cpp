@@ -1,6 +1,65 @@
 #include "stdafx.hpp"
 #include "System/Scene/Object.hpp"
 
+glm::mat4 zh::Object::TransformComponent::mat4() const
+{
+    const float c3 = glm::cos(rotation.z);
+    const float s3 = glm::sin(rotation.z);
+    const float c2 = glm::cos(rotation.x);
+    const float s2 = glm::sin(rotation.x);
+    const float c1 = glm::cos(rotation.y);
+    const float s1 = glm::sin(rotation.y);
+
+    return glm::mat4{{
+                         scale.x * (c1 * c3 + s1 * s2 * s3),
+                         scale.x * (c2 * s3),
+                         scale.x * (c1 * s2 * s3 - c3 * s1),
+                         0.f,
+                     },
+                     {
+                         scale.y * (c3 * s1 * s2 - c1 * s3),
+                         scale.y * (c2 * c3),
+                         scale.y * (c1 * c3 * s2 + s1 * s3),
+                         0.f,
+                     },
+                     {
+                         scale.z * (c2 * s1),
+                         scale.z * (-s2),
+                         scale.z * (c1 * c2),
+                         0.f,
+                     },
+                     {translation.x, translation.y, translation.z, 1.f}};
+}
+
+glm::mat3 zh::Object::TransformComponent::normalMatrix() const
+{
+    const float c3 = glm::cos(rotation.z);
+    const float s3 = glm::sin(rotation.z);
+    const float c2 = glm::cos(rotation.x);
+    const float s2 = glm::sin(rotation.x);
+    const float c1 = glm::cos(rotation.y);
+    const float s1 = glm::sin(rotation.y);
+    const glm::vec3 inverse_scale = 1.f / scale;
+
+    return glm::mat3{
+        {
+            inverse_scale.x * (c1 * c3 + s1 * s2 * s3),
+            inverse_scale.x * (c2 * s3),
+            inverse_scale.x * (c1 * s2 * s3 - c3 * s1),
+        },
+        {
+            inverse_scale.y * (c3 * s1 * s2 - c1 * s3),
+            inverse_scale.y * (c2 * c3),
+            inverse_scale.y * (c1 * c3 * s2 + s1 * s3),
+        },
+        {
+            inverse_scale.z * (c2 * s1),
+            inverse_scale.z * (-s2),
+            inverse_scale.z * (c1 * c2),
+        },
+    };
+}
+
 zh::Object::Object(Device &device) : device(device)
 {
     id = idCounter++;
@@ -46,3 +105,26 @@ void zh::Object::setRotation(const glm::vec3 &rotation)
 {
     transform.rotation = rotation;
 }
+
+const uint32_t zh::Object::getId() const
+{
+    return id;
+}
+
+std::shared_ptr<zh::Model> &zh::Object::getModel()
+{
+    return model;
+}
+
+const zh::Object::TransformComponent &zh::Object::getTransform() const
+{
+    return transform;
+}
+
+const zh::AABB zh::Object::getBounds() const
+{
+    if (model == nullptr)
+        return AABB{};
+
+    return model->getBounds().transform(transform.mat4());
+}
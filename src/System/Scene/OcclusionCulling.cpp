@@ -0,0 +1,50 @@
+#include "stdafx.hpp"
+#include "System/Scene/OcclusionCulling.hpp"
+
+zh::OcclusionCulling::OcclusionCulling(CullingIndex &index, OcclusionRasterizer &rasterizer)
+    : index(index), rasterizer(rasterizer), occludedCount(0)
+{
+}
+
+void zh::OcclusionCulling::insert(Object &object)
+{
+    index.insert(object);
+}
+
+void zh::OcclusionCulling::remove(Object &object)
+{
+    index.remove(object);
+}
+
+void zh::OcclusionCulling::update(Object &object)
+{
+    index.update(object);
+}
+
+void zh::OcclusionCulling::query(const Frustum &frustum, std::vector<Object *> &visible) const
+{
+    const size_t first = visible.size();
+    index.query(frustum, visible);
+
+    // Filter the appended objects in place, keeping their order.
+    size_t kept = first;
+
+    for (size_t i = first; i < visible.size(); ++i)
+    {
+        if (rasterizer.isVisible(visible[i]->getBounds()))
+            visible[kept++] = visible[i];
+    }
+
+    occludedCount = visible.size() - kept;
+    visible.resize(kept);
+}
+
+const size_t zh::OcclusionCulling::getSize() const
+{
+    return index.getSize();
+}
+
+const size_t zh::OcclusionCulling::getOccludedCount() const
+{
+    return occludedCount;
+}
@@ -0,0 +1,285 @@
+#include "stdafx.hpp"
+#include "System/Scene/OcclusionRasterizer.hpp"
+
+#if defined(AZHA_ENABLE_AVX2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+zh::OcclusionRasterizer::OcclusionRasterizer(const uint32_t width, const uint32_t height)
+    : width(width), height(height), pitch((width + 7) & ~7u), useAvx2(isAvx2Supported()), viewProjection(1.f)
+{
+    assert(width > 0 && height > 0 && "zh::OcclusionRasterizer::OcclusionRasterizer: EMPTY DEPTH BUFFER");
+
+    depth.resize(static_cast<size_t>(pitch) * height, 1.f);
+}
+
+const uint32_t zh::OcclusionRasterizer::addOccluder(const std::vector<glm::vec3> &vertices,
+                                                    const std::vector<uint32_t> &indices, const glm::mat4 &transform)
+{
+    assert(indices.size() % 3 == 0 && "zh::OcclusionRasterizer::addOccluder: INDEX COUNT IS NOT A MULTIPLE OF THREE");
+
+    Occluder occluder{vertices, indices, transform, static_cast<uint32_t>(triangles.size())};
+    triangles.resize(triangles.size() + indices.size() / 3);
+    occluders.push_back(std::move(occluder));
+
+    return static_cast<uint32_t>(occluders.size() - 1);
+}
+
+void zh::OcclusionRasterizer::updateOccluder(const uint32_t occluder, const glm::mat4 &transform)
+{
+    assert(occluder < occluders.size() && "zh::OcclusionRasterizer::updateOccluder: OCCLUDER OUT OF BOUNDS");
+
+    occluders[occluder].transform = transform;
+}
+
+void zh::OcclusionRasterizer::clearOccluders()
+{
+    occluders.clear();
+    triangles.clear();
+}
+
+void zh::OcclusionRasterizer::rasterize(const glm::mat4 &view_projection, ThreadPool *thread_pool)
+{
+    viewProjection = view_projection;
+
+    // Triangles are set up per occluder, then every row band walks all of them so no two threads share a pixel.
+    if (thread_pool != nullptr)
+    {
+        thread_pool->parallelFor(static_cast<uint32_t>(occluders.size()), [this](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i)
+                setupTriangles(occluders[i]);
+        });
+
+        thread_pool->parallelFor(
+            height, [this](uint32_t begin, uint32_t end) { rasterizeRows(begin, end); }, 8);
+    }
+    else
+    {
+        for (auto &occluder : occluders)
+            setupTriangles(occluder);
+
+        rasterizeRows(0, height);
+    }
+}
+
+const bool zh::OcclusionRasterizer::isVisible(const AABB &bounds) const
+{
+    glm::vec2 screen_min(std::numeric_limits<float>::max());
+    glm::vec2 screen_max(std::numeric_limits<float>::lowest());
+    float nearest = 1.f;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        const glm::vec3 corner((i & 1) ? bounds.max.x : bounds.min.x, (i & 2) ? bounds.max.y : bounds.min.y,
+                               (i & 4) ? bounds.max.z : bounds.min.z);
+        const glm::vec4 clip = viewProjection * glm::vec4(corner, 1.f);
+
+        if (clip.w <= 0.f || clip.z < 0.f)
+            return true;
+
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        const glm::vec2 screen = (glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2(width, height);
+
+        screen_min = glm::min(screen_min, screen);
+        screen_max = glm::max(screen_max, screen);
+        nearest = std::min(nearest, ndc.z);
+    }
+
+    const int min_x = std::max(static_cast<int>(std::floor(screen_min.x)), 0);
+    const int max_x = std::min(static_cast<int>(std::floor(screen_max.x)), static_cast<int>(width) - 1);
+    const int min_y = std::max(static_cast<int>(std::floor(screen_min.y)), 0);
+    const int max_y = std::min(static_cast<int>(std::floor(screen_max.y)), static_cast<int>(height) - 1);
+
+    if (min_x > max_x || min_y > max_y)
+        return false;
+
+    return testRect(min_x, max_x, min_y, max_y, nearest);
+}
+
+const uint32_t zh::OcclusionRasterizer::getWidth() const
+{
+    return width;
+}
+
+const uint32_t zh::OcclusionRasterizer::getHeight() const
+{
+    return height;
+}
+
+const uint32_t zh::OcclusionRasterizer::getTriangleCount() const
+{
+    return static_cast<uint32_t>(triangles.size());
+}
+
+const std::vector<float> &zh::OcclusionRasterizer::getDepth() const
+{
+    return depth;
+}
+
+void zh::OcclusionRasterizer::setupTriangles(const Occluder &occluder)
+{
+    const glm::mat4 matrix = viewProjection * occluder.transform;
+    const glm::vec2 size(width, height);
+
+    for (size_t i = 0; i < occluder.indices.size(); i += 3)
+    {
+        ScreenTriangle &triangle = triangles[occluder.firstTriangle + i / 3];
+        triangle.isValid = false;
+
+        glm::vec3 points[3];
+        bool is_clipped = false;
+
+        for (int j = 0; j < 3; ++j)
+        {
+            const glm::vec4 clip = matrix * glm::vec4(occluder.vertices[occluder.indices[i + j]], 1.f);
+
+            // Dropping an occluder triangle only makes culling less aggressive, so no near plane clipping.
+            if (clip.w <= 0.f || clip.z < 0.f)
+            {
+                is_clipped = true;
+                break;
+            }
+
+            const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            points[j] = glm::vec3((glm::vec2(ndc) * 0.5f + 0.5f) * size, ndc.z);
+        }
+
+        if (is_clipped)
+            continue;
+
+        float area = (points[1].x - points[0].x) * (points[2].y - points[0].y) -
+                     (points[1].y - points[0].y) * (points[2].x - points[0].x);
+
+        // Occluders are double sided.
+        if (area < 0.f)
+        {
+            std::swap(points[1], points[2]);
+            area = -area;
+        }
+
+        if (area < 1e-6f)
+            continue;
+
+        for (int j = 0; j < 3; ++j)
+        {
+            const glm::vec3 &from = points[(j + 1) % 3];
+            const glm::vec3 &to = points[(j + 2) % 3];
+
+            triangle.a[j] = from.y - to.y;
+            triangle.b[j] = to.x - from.x;
+            triangle.c[j] = -(triangle.a[j] * from.x + triangle.b[j] * from.y);
+        }
+
+        const glm::vec3 depths(points[0].z, points[1].z, points[2].z);
+
+        triangle.depthA = glm::dot(glm::vec3(triangle.a[0], triangle.a[1], triangle.a[2]), depths) / area;
+        triangle.depthB = glm::dot(glm::vec3(triangle.b[0], triangle.b[1], triangle.b[2]), depths) / area;
+        triangle.depthC = glm::dot(glm::vec3(triangle.c[0], triangle.c[1], triangle.c[2]), depths) / area;
+
+        const float min_x = std::min({points[0].x, points[1].x, points[2].x});
+        const float max_x = std::max({points[0].x, points[1].x, points[2].x});
+        const float min_y = std::min({points[0].y, points[1].y, points[2].y});
+        const float max_y = std::max({points[0].y, points[1].y, points[2].y});
+
+        triangle.minX = std::max(static_cast<int>(std::floor(min_x)), 0);
+        triangle.maxX = std::min(static_cast<int>(std::floor(max_x)), static_cast<int>(width) - 1);
+        triangle.minY = std::max(static_cast<int>(std::floor(min_y)), 0);
+        triangle.maxY = std::min(static_cast<int>(std::floor(max_y)), static_cast<int>(height) - 1);
+        triangle.isValid = triangle.minX <= triangle.maxX && triangle.minY <= triangle.maxY;
+    }
+}
+
+void zh::OcclusionRasterizer::rasterizeRows(const int row_begin, const int row_end)
+{
+    std::fill(depth.begin() + static_cast<size_t>(row_begin) * pitch,
+              depth.begin() + static_cast<size_t>(row_end) * pitch, 1.f);
+
+    for (auto &triangle : triangles)
+    {
+        if (triangle.isValid && triangle.maxY >= row_begin && triangle.minY < row_end)
+            rasterizeTriangle(triangle, row_begin, row_end);
+    }
+}
+
+void zh::OcclusionRasterizer::rasterizeTriangle(const ScreenTriangle &triangle, const int row_begin,
+                                                const int row_end)
+{
+    const int min_y = std::max(triangle.minY, row_begin);
+    const int max_y = std::min(triangle.maxY, row_end - 1);
+
+#ifdef AZHA_ENABLE_AVX2
+    if (useAvx2)
+    {
+        OcclusionRasterizerAvx2::rasterizeTriangle(triangle, depth.data(), pitch, min_y, max_y);
+        return;
+    }
+#endif
+
+    for (int y = min_y; y <= max_y; ++y)
+    {
+        const float center_y = static_cast<float>(y) + 0.5f;
+        float *row = depth.data() + static_cast<size_t>(y) * pitch;
+
+        for (int x = triangle.minX; x <= triangle.maxX; ++x)
+        {
+            const float center_x = static_cast<float>(x) + 0.5f;
+
+            const float e0 = triangle.a[0] * center_x + triangle.b[0] * center_y + triangle.c[0];
+            const float e1 = triangle.a[1] * center_x + triangle.b[1] * center_y + triangle.c[1];
+            const float e2 = triangle.a[2] * center_x + triangle.b[2] * center_y + triangle.c[2];
+
+            if (e0 < 0.f || e1 < 0.f || e2 < 0.f)
+                continue;
+
+            const float fragment_depth = triangle.depthA * center_x + triangle.depthB * center_y + triangle.depthC;
+            row[x] = std::min(row[x], fragment_depth);
+        }
+    }
+}
+
+const bool zh::OcclusionRasterizer::testRect(const int min_x, const int max_x, const int min_y, const int max_y,
+                                             const float nearest) const
+{
+#ifdef AZHA_ENABLE_AVX2
+    if (useAvx2)
+        return OcclusionRasterizerAvx2::testRect(depth.data(), pitch, min_x, max_x, min_y, max_y, nearest);
+#endif
+
+    for (int y = min_y; y <= max_y; ++y)
+    {
+        const float *row = depth.data() + static_cast<size_t>(y) * pitch;
+
+        for (int x = min_x; x <= max_x; ++x)
+        {
+            if (row[x] >= nearest)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+const bool zh::OcclusionRasterizer::isAvx2Supported()
+{
+#if defined(AZHA_ENABLE_AVX2) && (defined(__GNUC__) || defined(__clang__))
+    // Also checks that the OS saves the AVX registers.
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#elif defined(AZHA_ENABLE_AVX2) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+
+    if (info[0] < 7)
+        return false;
+
+    // AVX, and XSAVE enabled by the OS, which must also save the XMM and YMM registers.
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
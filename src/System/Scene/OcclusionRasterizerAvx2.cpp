@@ -0,0 +1,80 @@
+// Built without the precompiled header, see OcclusionRasterizerAvx2.hpp.
+#include "System/Scene/OcclusionRasterizerAvx2.hpp"
+
+#ifdef AZHA_ENABLE_AVX2
+#include <immintrin.h>
+
+void zh::OcclusionRasterizerAvx2::rasterizeTriangle(const OcclusionTriangle &triangle, float *depth,
+                                                    const uint32_t pitch, const int min_y, const int max_y)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 lane_offsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 a0 = _mm256_set1_ps(triangle.a[0]);
+    const __m256 a1 = _mm256_set1_ps(triangle.a[1]);
+    const __m256 a2 = _mm256_set1_ps(triangle.a[2]);
+    const __m256 depth_a = _mm256_set1_ps(triangle.depthA);
+
+    // The row pitch is a multiple of eight, so starting on an aligned column never runs past the row.
+    const int first_x = triangle.minX & ~7;
+
+    for (int y = min_y; y <= max_y; ++y)
+    {
+        const float center_y = static_cast<float>(y) + 0.5f;
+        const __m256 row_e0 = _mm256_set1_ps(triangle.b[0] * center_y + triangle.c[0]);
+        const __m256 row_e1 = _mm256_set1_ps(triangle.b[1] * center_y + triangle.c[1]);
+        const __m256 row_e2 = _mm256_set1_ps(triangle.b[2] * center_y + triangle.c[2]);
+        const __m256 row_depth = _mm256_set1_ps(triangle.depthB * center_y + triangle.depthC);
+
+        float *row = depth + static_cast<size_t>(y) * pitch;
+
+        for (int x = first_x; x <= triangle.maxX; x += 8)
+        {
+            const __m256 center_x = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lane_offsets);
+
+            const __m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, center_x), row_e0);
+            const __m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, center_x), row_e1);
+            const __m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, center_x), row_e2);
+
+            const __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ),
+                                                              _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+                                                _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+
+            if (_mm256_movemask_ps(inside) == 0)
+                continue;
+
+            const __m256 fragment_depth = _mm256_add_ps(_mm256_mul_ps(depth_a, center_x), row_depth);
+            const __m256 stored_depth = _mm256_loadu_ps(row + x);
+            const __m256 nearest = _mm256_min_ps(stored_depth, fragment_depth);
+
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(stored_depth, nearest, inside));
+        }
+    }
+}
+
+const bool zh::OcclusionRasterizerAvx2::testRect(const float *depth, const uint32_t pitch, const int min_x,
+                                                 const int max_x, const int min_y, const int max_y, const float nearest)
+{
+    const __m256 lane_indices = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+    const __m256 first = _mm256_set1_ps(static_cast<float>(min_x));
+    const __m256 last = _mm256_set1_ps(static_cast<float>(max_x));
+    const __m256 bounds_depth = _mm256_set1_ps(nearest);
+
+    for (int y = min_y; y <= max_y; ++y)
+    {
+        const float *row = depth + static_cast<size_t>(y) * pitch;
+
+        for (int x = min_x & ~7; x <= max_x; x += 8)
+        {
+            const __m256 column = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lane_indices);
+            const __m256 in_rect =
+                _mm256_and_ps(_mm256_cmp_ps(column, first, _CMP_GE_OQ), _mm256_cmp_ps(column, last, _CMP_LE_OQ));
+            const __m256 behind = _mm256_cmp_ps(_mm256_loadu_ps(row + x), bounds_depth, _CMP_GE_OQ);
+
+            if (_mm256_movemask_ps(_mm256_and_ps(in_rect, behind)) != 0)
+                return true;
+        }
+    }
+
+    return false;
+}
+#endif
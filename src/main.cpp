@@ -29,8 +29,8 @@ int main()
     zh::Swapchain swapchain(device, window);
     zh::Pipeline pipeline(device, swapchain, "Assets/Shaders/vert.spv", "Assets/Shaders/frag.spv");
 
-    VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, zh::Swapchain::MAX_FRAMES_IN_FLIGHT};
-    zh::DescriptorPool global_descriptor_pool(device, zh::Swapchain::MAX_FRAMES_IN_FLIGHT, 0, {pool_size});
+    VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, swapchain.getFramesInFlight()};
+    zh::DescriptorPool global_descriptor_pool(device, swapchain.getFramesInFlight(), 0, {pool_size});
 
     zh::Object object(device);
     object.loadModelFromData(vertices, indices);